@@ -0,0 +1,82 @@
+#pragma once
+
+// Just enough of the ESP32 Arduino core and FreeRTOS to build the firmware's portable modules on a
+// desktop, for the native env (test/) and the tools. Tasks are threads and mutexes are real, so
+// code that runs on two cores on the ESP32 runs on two threads here. millis() and micros() follow
+// the host's clock plus whatever hostAdvanceMillis() has added, so timers can be skipped ahead.
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void hostAdvanceMillis(uint32_t ms);        // moves millis() and micros() forward without waiting
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buf, size_t len) {
+        size_t n = 0;
+        while (len-- && write(*buf++))
+            n++;
+        return n;
+    }
+    size_t write(const char *buf, size_t len) { return write((const uint8_t *)buf, len); }
+    size_t print(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t println(const char *text) { return print(text) + print('\n'); }
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[256];
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        return n > 0 ? write((const uint8_t *)buf, (size_t)n < sizeof(buf) ? n : sizeof(buf) - 1) : 0;
+    }
+};
+
+// Serial goes to stdout
+class HardwareSerial : public Print {
+  public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+    size_t write(const uint8_t *buf, size_t len) override { return fwrite(buf, 1, len, stdout); }
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+//----------------------------------------FREERTOS---------------------------------------
+// One tick is a millisecond. A task ends when its function returns; vTaskDelete() only marks the
+// spot. At exit every task is stopped at its next delay or wait, so none outlives the statics it uses.
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+#define portMAX_DELAY 0xffffffffUL
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+struct HostMutex;
+typedef HostMutex *SemaphoreHandle_t;
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex);
+
+struct HostTask;
+typedef HostTask *TaskHandle_t;
+BaseType_t xTaskCreatePinnedToCore(void (*code)(void *), const char *name, uint32_t stack, void *param, unsigned priority,
+                                   TaskHandle_t *handle, int core);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+void xTaskNotifyGive(TaskHandle_t task);
@@ -0,0 +1,34 @@
+#pragma once
+
+// The web server as far as the modules built on the host use it. There is no network: an event
+// source has no clients and the server never serves anything.
+
+#include <Arduino.h>
+
+class AsyncEventSourceClient {
+  public:
+    uint32_t lastId() const { return 0; }
+    void send(const char *, const char * = nullptr, uint32_t = 0, uint32_t = 0) {}
+};
+
+typedef void (*ArEventHandlerFunction)(AsyncEventSourceClient *client);
+
+class AsyncWebHandler {
+  public:
+    virtual ~AsyncWebHandler() {}
+};
+
+class AsyncEventSource : public AsyncWebHandler {
+  public:
+    explicit AsyncEventSource(const char *) {}
+    void onConnect(ArEventHandlerFunction) {}
+    void send(const char *, const char * = nullptr, uint32_t = 0, uint32_t = 0) {}
+    size_t count() const { return 0; }
+    size_t avgPacketsWaiting() const { return 0; }
+};
+
+class AsyncWebServer {
+  public:
+    explicit AsyncWebServer(uint16_t) {}
+    AsyncWebHandler &addHandler(AsyncWebHandler *handler) { return *handler; }
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+// The file system the firmware sees, backed by a directory on the host: every path is taken
+// relative to the directory the FS was made with. Opens and bytes moved are counted so tests can
+// assert how much flash traffic a piece of code causes.
+
+#include <Arduino.h>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+struct FsStats {
+    std::atomic<uint32_t> opens{ 0 };
+    std::atomic<uint64_t> bytesRead{ 0 };
+    std::atomic<uint64_t> bytesWritten{ 0 };
+
+    void reset() {
+        opens = 0;
+        bytesRead = 0;
+        bytesWritten = 0;
+    }
+};
+
+class File {
+  public:
+    size_t read(uint8_t *buf, size_t len);
+    size_t write(const uint8_t *buf, size_t len);
+    bool seek(uint32_t pos);
+    size_t size() const;
+    void close() { handle.reset(); }
+    operator bool() const { return (bool)handle; }
+
+  private:
+    friend class FS;
+    std::shared_ptr<FILE> handle;
+    FsStats *stats = nullptr;
+};
+
+class FS {
+  public:
+    explicit FS(const std::string &root) : root(root) {}
+    File open(const char *path, const char *mode = FILE_READ);
+    bool exists(const char *path);
+    bool remove(const char *path);
+    bool rename(const char *from, const char *to);
+    bool mkdir(const char *path);
+
+    FsStats stats;
+
+  private:
+    std::string root;
+};
+
+}        // namespace fs
+
+using fs::File;
+
+// Makes a new empty directory under /tmp for an FS to live in; it is removed again at exit
+std::string hostScratchDir();
@@ -0,0 +1,71 @@
+#pragma once
+
+// A HD44780 16x2 behind a PCF8574 backpack on Wire, sending the same bus traffic as the real
+// library: every byte goes out as two nibbles, each written with the enable line up and down, one
+// I2C transaction per write. What would be on the glass is kept in screen for tests to look at.
+
+#include <Arduino.h>
+#include <Wire.h>
+
+class LiquidCrystal_I2C : public Print {
+  public:
+    LiquidCrystal_I2C(uint8_t address, uint8_t, uint8_t) : address(address) { blank(); }
+
+    void init() {
+        command(0x28);        // 4 bit, 2 lines
+        command(0x0c);        // display on, no cursor
+        command(0x06);        // left to right
+        clear();
+    }
+    void backlight() { expanderWrite(0); }
+    void clear() {
+        command(0x01);
+        blank();
+    }
+    void setCursor(uint8_t col, uint8_t row) {
+        command(0x80 | ((row ? 0x40 : 0x00) + col));
+        cursorCol = col;
+        cursorRow = row ? 1 : 0;
+    }
+    size_t write(uint8_t value) override {
+        send(value, RS);
+        if (cursorCol < 16)
+            screen[cursorRow][cursorCol] = value;
+        cursorCol++;
+        return 1;
+    }
+    using Print::write;
+
+    char screen[2][17];
+
+  private:
+    static const uint8_t RS = 0x01;
+    static const uint8_t EN = 0x04;
+    static const uint8_t BACKLIGHT = 0x08;
+
+    void blank() {
+        for (auto &line : screen) {
+            memset(line, ' ', 16);
+            line[16] = '\0';
+        }
+        cursorCol = cursorRow = 0;
+    }
+    void command(uint8_t value) { send(value, 0); }
+    void send(uint8_t value, uint8_t mode) {
+        write4bits((value & 0xf0) | mode);
+        write4bits(((value << 4) & 0xf0) | mode);
+    }
+    void write4bits(uint8_t value) {
+        expanderWrite(value);
+        expanderWrite(value | EN);
+        expanderWrite(value & ~EN);
+    }
+    void expanderWrite(uint8_t data) {
+        Wire.beginTransmission(address);
+        Wire.write(data | BACKLIGHT);
+        Wire.endTransmission();
+    }
+
+    uint8_t address;
+    uint8_t cursorCol = 0, cursorRow = 0;
+};
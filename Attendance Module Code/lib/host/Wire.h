@@ -0,0 +1,28 @@
+#pragma once
+
+// An I2C bus with a DS3231 on it: register writes and burst reads at DS3231_ADDR go to a register
+// file in RAM, writes to any other address (the LCD backpack) are only counted. The counters let
+// tests assert how much bus traffic a piece of code causes.
+
+#include <Arduino.h>
+
+class TwoWire {
+  public:
+    void begin() {}
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t value);
+    uint8_t endTransmission(bool stop = true);
+    uint8_t requestFrom(uint8_t address, int count);
+    int read() { return regs[pointer++ % sizeof(regs)]; }
+
+    uint8_t regs[0x13] = {};
+    uint32_t transactions = 0;        // writes and reads, each one start condition on the bus
+    uint32_t bytes = 0;               // address bytes included, as they take bus time too
+
+  private:
+    uint8_t target = 0;
+    bool addressing = false;
+    uint8_t pointer = 0;
+};
+
+extern TwoWire Wire;
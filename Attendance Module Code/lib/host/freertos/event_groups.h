@@ -0,0 +1,14 @@
+#pragma once
+
+// FreeRTOS event groups for the host build; see Arduino.h
+
+#include <Arduino.h>
+
+typedef uint32_t EventBits_t;
+struct HostEventGroup;
+typedef HostEventGroup *EventGroupHandle_t;
+
+EventGroupHandle_t xEventGroupCreate();
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear, BaseType_t all, TickType_t ticks);
@@ -0,0 +1,303 @@
+#include "FS.h"
+#include "Wire.h"
+#include "freertos/event_groups.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ftw.h>
+#include <mutex>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+static const auto started = std::chrono::steady_clock::now();
+static std::atomic<uint64_t> skippedUs{ 0 };
+
+HardwareSerial Serial;
+TwoWire Wire;
+
+static uint64_t elapsedUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count() + skippedUs;
+}
+
+unsigned long millis() {
+    return elapsedUs() / 1000;
+}
+
+unsigned long micros() {
+    return elapsedUs();
+}
+
+void hostAdvanceMillis(uint32_t ms) {
+    skippedUs += (uint64_t)ms * 1000;
+}
+
+void delay(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    target = address;
+    addressing = true;
+    transactions++;
+    bytes++;
+}
+
+size_t TwoWire::write(uint8_t value) {
+    bytes++;
+    if (target != 0x68)
+        return 1;
+    if (addressing)
+        pointer = value;
+    else
+        regs[pointer++ % sizeof(regs)] = value;
+    addressing = false;
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t, int count) {
+    transactions++;
+    bytes += 1 + count;
+    return count;
+}
+
+namespace fs {
+
+size_t File::read(uint8_t *buf, size_t len) {
+    size_t n = handle ? fread(buf, 1, len, handle.get()) : 0;
+    if (stats)
+        stats->bytesRead += n;
+    return n;
+}
+
+size_t File::write(const uint8_t *buf, size_t len) {
+    size_t n = handle ? fwrite(buf, 1, len, handle.get()) : 0;
+    if (stats)
+        stats->bytesWritten += n;
+    return n;
+}
+
+bool File::seek(uint32_t pos) {
+    return handle && fseek(handle.get(), pos, SEEK_SET) == 0;
+}
+
+size_t File::size() const {
+    if (!handle)
+        return 0;
+    struct stat st;
+    fflush(handle.get());
+    return fstat(fileno(handle.get()), &st) == 0 ? st.st_size : 0;
+}
+
+File FS::open(const char *path, const char *mode) {
+    const char *hostMode = !strcmp(mode, "r+") ? "r+b" : mode[0] == 'r' ? "rb" : mode[0] == 'w' ? "wb" : "ab";
+    File file;
+    if (FILE *f = fopen((root + path).c_str(), hostMode)) {
+        file.handle.reset(f, fclose);
+        file.stats = &stats;
+        stats.opens++;
+    }
+    return file;
+}
+
+bool FS::exists(const char *path) {
+    struct stat st;
+    return stat((root + path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char *path) {
+    return ::remove((root + path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to) {
+    return ::rename((root + from).c_str(), (root + to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path) {
+    return ::mkdir((root + path).c_str(), 0755) == 0;
+}
+
+}        // namespace fs
+
+static int removeEntry(const char *path, const struct stat *, int, struct FTW *) {
+    return ::remove(path);
+}
+
+static std::vector<std::string> scratchDirs;
+
+static void removeScratchDirs() {
+    for (const std::string &dir : scratchDirs)
+        nftw(dir.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+std::string hostScratchDir() {
+    char dir[] = "/tmp/attendance.XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        abort();
+    }
+    if (scratchDirs.empty())
+        atexit(removeScratchDirs);
+    scratchDirs.push_back(dir);
+    return dir;
+}
+
+//----------------------------------------FREERTOS---------------------------------------
+// Waits are cut into slices so a task blocked forever still notices the exit
+static const auto SLICE = std::chrono::milliseconds(10);
+
+struct HostMutex {
+    std::timed_mutex mutex;
+};
+
+struct HostTask {
+    void (*code)(void *);
+    void *param;
+    std::thread thread;
+    std::mutex lock;
+    std::condition_variable wake;
+    uint32_t notified = 0;
+};
+
+struct HostEventGroup {
+    std::mutex lock;
+    std::condition_variable changed;
+    EventBits_t bits = 0;
+};
+
+struct TaskStopped {};
+
+static std::mutex tasksLock;
+static std::vector<HostTask *> tasks;
+static std::atomic<bool> stopping{ false };
+static thread_local HostTask *currentTask = nullptr;
+
+static std::chrono::steady_clock::time_point deadline(TickType_t ticks) {
+    return ticks == portMAX_DELAY ? std::chrono::steady_clock::time_point::max() : std::chrono::steady_clock::now() + std::chrono::milliseconds(ticks);
+}
+
+// Ends the calling task at its next wait once the program is exiting
+static void stopPoint() {
+    if (currentTask && stopping)
+        throw TaskStopped();
+}
+
+// Runs at exit, before the destructors of the statics the tasks use
+static void stopTasks() {
+    stopping = true;
+    std::lock_guard<std::mutex> guard(tasksLock);
+    for (HostTask *task : tasks) {
+        task->wake.notify_all();
+        if (task->thread.joinable())
+            task->thread.join();
+    }
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new HostMutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks) {
+    auto until = deadline(ticks);
+    for (;;) {
+        stopPoint();
+        auto slice = std::min(until, std::chrono::steady_clock::now() + SLICE);
+        if (mutex->mutex.try_lock_until(slice))
+            return pdTRUE;
+        if (std::chrono::steady_clock::now() >= until)
+            return pdFALSE;
+    }
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+    mutex->mutex.unlock();
+    return pdTRUE;
+}
+
+static void runTask(HostTask *task) {
+    currentTask = task;
+    try {
+        task->code(task->param);
+    } catch (TaskStopped &) {
+    }
+}
+
+BaseType_t xTaskCreatePinnedToCore(void (*code)(void *), const char *, uint32_t, void *param, unsigned, TaskHandle_t *handle, int) {
+    static std::once_flag registered;
+    std::call_once(registered, [] { atexit(stopTasks); });
+    HostTask *task = new HostTask;
+    task->code = code;
+    task->param = param;
+    {
+        std::lock_guard<std::mutex> guard(tasksLock);
+        tasks.push_back(task);
+        task->thread = std::thread(runTask, task);
+    }
+    if (handle)
+        *handle = task;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t) {
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (!currentTask) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+        return;
+    }
+    std::unique_lock<std::mutex> guard(currentTask->lock);
+    currentTask->wake.wait_until(guard, deadline(ticks), [] { return stopping.load(); });
+    stopPoint();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+    std::unique_lock<std::mutex> guard(currentTask->lock);
+    currentTask->wake.wait_until(guard, deadline(ticks), [] { return currentTask->notified > 0 || stopping; });
+    stopPoint();
+    uint32_t count = currentTask->notified;
+    if (count > 0)
+        currentTask->notified = clear ? 0 : count - 1;
+    return count;
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->notified++;
+    task->wake.notify_all();
+}
+
+EventGroupHandle_t xEventGroupCreate() {
+    return new HostEventGroup;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> guard(group->lock);
+    group->bits |= bits;
+    group->changed.notify_all();
+    return group->bits;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> guard(group->lock);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear, BaseType_t all, TickType_t ticks) {
+    auto until = deadline(ticks);
+    std::unique_lock<std::mutex> guard(group->lock);
+    auto done = [&] { return all ? (group->bits & bits) == bits : (group->bits & bits) != 0; };
+    while (!done() && std::chrono::steady_clock::now() < until) {
+        group->changed.wait_until(guard, std::min(until, std::chrono::steady_clock::now() + SLICE));
+        stopPoint();
+    }
+    EventBits_t seen = group->bits;
+    if (clear && done())
+        group->bits &= ~bits;
+    return seen;
+}
@@ -0,0 +1,221 @@
+#include "archive.h"
+#include "journal.h"
+#include "log.h"
+#include "rtc.h"
+
+#define ARCHIVE_TMP_PATH LOG_DIR "/archive.tmp"
+#define ARCHIVE_SWAP_TRIES 10        // seconds to wait for running exports before giving up on a swap
+
+static fs::FS *archiveFs = nullptr;
+static TaskHandle_t archiveTaskHandle = nullptr;
+
+// Writes a LEB128 varint, returns its length
+static size_t putVarint(uint8_t *out, uint32_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+// Checks the payload CRC of a freshly written archive by reading it back from flash
+static bool archiveVerify(fs::FS &fs, const char *path, const ArchiveHeader &header) {
+    File file = fs.open(path, FILE_READ);
+    if (!file)
+        return false;
+    uint8_t buf[64];
+    uint32_t crc = 0;
+    size_t n;
+    file.seek(sizeof(ArchiveHeader));
+    while ((n = file.read(buf, sizeof(buf))) > 0)
+        crc = crc32(buf, n, crc);
+    bool ok = file.size() == sizeof(ArchiveHeader) + header.payloadLen && crc == header.payloadCrc;
+    file.close();
+    return ok;
+}
+
+// Compacts the sealed segment at a manifest index. The archive is written to a temporary file with
+// its header last, checked, and only then swapped in for the raw segment under the journal lock,
+// at a moment when no export is reading. Returns false if the segment was left as it was.
+bool archiveSegment(fs::FS &fs, size_t index) {
+    SegmentInfo info;
+    if (!manifestRead(fs, index, info) || info.state != SEGMENT_SEALED)
+        return false;
+    char rawPath[32], arcPath[32];
+    segmentPath(info.day, SEGMENT_SEALED, rawPath, sizeof(rawPath));
+    segmentPath(info.day, SEGMENT_ARCHIVED, arcPath, sizeof(arcPath));
+
+    File out = fs.open(ARCHIVE_TMP_PATH, FILE_WRITE);
+    if (!out)
+        return false;
+    ArchiveHeader header = { 0, info.day, info.firstSeq, 0, 0, 0 };
+    bool ok = out.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+
+    JournalScanner raw(fs, rawPath);
+    AttendanceRecord rec;
+    uint32_t seq = info.firstSeq;
+    uint32_t timestamp = info.day * 86400UL;
+    while (ok && raw.next(rec)) {
+        uint8_t entry[15];
+        int32_t delta = (int32_t)(rec.timestamp - timestamp);
+        size_t n = putVarint(entry, rec.seq - seq);
+        n += putVarint(entry + n, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+        n += putVarint(entry + n, (uint32_t)rec.rollNum << 1 | (rec.event == EVENT_DEPARTURE));
+        ok = out.write(entry, n) == n;
+        header.payloadCrc = crc32(entry, n, header.payloadCrc);
+        header.payloadLen += n;
+        header.count++;
+        seq = rec.seq;
+        timestamp = rec.timestamp;
+    }
+    header.magic = ARCHIVE_MAGIC;
+    ok = ok && out.seek(0) && out.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+    out.close();
+    ok = ok && archiveVerify(fs, ARCHIVE_TMP_PATH, header);
+
+    bool swapped = false;
+    for (uint8_t tries = 0; ok && !swapped && tries < ARCHIVE_SWAP_TRIES; tries++) {
+        journalLock();
+        if (!journalReadersActive()) {
+            fs.remove(arcPath);        // left over from a swap cut short before the manifest was updated
+            swapped = fs.rename(ARCHIVE_TMP_PATH, arcPath);
+            if (swapped) {
+                info.state = SEGMENT_ARCHIVED;
+                info.bytes = sizeof(header) + header.payloadLen;
+                swapped = manifestWrite(fs, index, info);
+                if (swapped)
+                    fs.remove(rawPath);
+            }
+            ok = swapped;
+        }
+        journalUnlock();
+        if (ok && !swapped)
+            vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+    fs.remove(ARCHIVE_TMP_PATH);
+    if (swapped)
+        LOG_PRINTF("Archived %s: %u records in %u bytes\n", arcPath, header.count, info.bytes);
+    return swapped;
+}
+
+// Deletes the oldest segments past the retention period or over the size budget, then compacts
+// sealed segments old enough. Ages count from the newest segment rather than just the clock, so an
+// RTC that jumps ahead cannot wipe the log.
+void archiveService(fs::FS &fs, uint32_t today) {
+    size_t count = manifestCount(fs);
+    if (count < 2)
+        return;
+    SegmentInfo info;
+    if (!manifestRead(fs, count - 1, info))
+        return;
+    if (today > info.day)
+        today = info.day;
+
+    uint32_t total = 0;
+    for (size_t i = 0; i < count && manifestRead(fs, i, info); i++)
+        total += info.bytes;
+    size_t drop = 0;
+    while (drop < count - 1 && manifestRead(fs, drop, info)) {
+        bool expired = LOG_RETENTION_DAYS > 0 && info.day + LOG_RETENTION_DAYS <= today;
+        if (!expired && total <= LOG_BUDGET_BYTES)
+            break;
+        total -= info.bytes;
+        drop++;
+    }
+    if (drop > 0) {
+        journalLock();
+        if (!journalReadersActive()) {
+            // Files first: a segment missing from flash is skipped by readers, a missing manifest
+            // entry would leave its files behind for good
+            char path[32];
+            for (size_t i = 0; i < drop && manifestRead(fs, i, info); i++) {
+                segmentPath(info.day, SEGMENT_SEALED, path, sizeof(path));
+                fs.remove(path);
+                segmentPath(info.day, SEGMENT_ARCHIVED, path, sizeof(path));
+                fs.remove(path);
+            }
+            if (manifestDropFront(fs, drop))
+                LOG_PRINTF("Dropped %u old log segments\n", (unsigned)drop);
+            count -= drop;
+        }
+        journalUnlock();
+    }
+
+    for (size_t i = 0; i + 1 < count; i++) {
+        if (manifestRead(fs, i, info) && info.state == SEGMENT_SEALED && info.day + ARCHIVE_AFTER_DAYS <= today)
+            archiveSegment(fs, i);
+    }
+}
+
+static void archiveTask(void *) {
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(ARCHIVE_POLL_MS));
+        archiveService(*archiveFs, dayOf(clockNow()));
+    }
+}
+
+// Starts the archiver task; call after journalBegin()
+void archiveBegin(fs::FS &fs) {
+    archiveFs = &fs;
+    if (archiveTaskHandle == nullptr)
+        xTaskCreatePinnedToCore(archiveTask, "archive", ARCHIVE_TASK_STACK, nullptr, ARCHIVE_TASK_PRIORITY, &archiveTaskHandle, ARCHIVE_TASK_CORE);
+}
+
+//----------------------------------------ARCHIVE READER---------------------------------------
+bool ArchiveReader::open(fs::FS &fs, const char *path) {
+    bufLen = bufPos = 0;
+    remaining = 0;
+    file = fs.open(path, FILE_READ);
+    if (!file)
+        return false;
+    ArchiveHeader header;
+    if (file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || header.magic != ARCHIVE_MAGIC ||
+        file.size() != sizeof(header) + header.payloadLen) {
+        file.close();
+        return false;
+    }
+    remaining = header.count;
+    seq = header.firstSeq;
+    timestamp = header.day * 86400UL;
+    return true;
+}
+
+bool ArchiveReader::readVarint(uint32_t &value) {
+    value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (bufPos == bufLen) {
+            size_t n = file.read(buf, sizeof(buf));
+            if (n == 0)
+                return false;
+            bufLen = n;
+            bufPos = 0;
+        }
+        uint8_t b = buf[bufPos++];
+        value |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// Decodes the next record, returns false at the end of the archive
+bool ArchiveReader::next(AttendanceRecord &rec) {
+    uint32_t seqDelta, timeDelta, rollEvent;
+    if (remaining == 0 || !readVarint(seqDelta) || !readVarint(timeDelta) || !readVarint(rollEvent)) {
+        remaining = 0;
+        file.close();
+        return false;
+    }
+    remaining--;
+    seq += seqDelta;
+    timestamp += (int32_t)((timeDelta >> 1) ^ (0 - (timeDelta & 1)));
+    rec.timestamp = timestamp;
+    rec.rollNum = rollEvent >> 1;
+    rec.event = (rollEvent & 1) ? EVENT_DEPARTURE : EVENT_ARRIVAL;
+    rec.flags = 0;
+    rec.seq = seq;
+    rec.crc = crc32((const uint8_t *)&rec, offsetof(AttendanceRecord, crc));
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "FS.h"
+#include <Arduino.h>
+
+//----------------------------------------ARCHIVER---------------------------------------
+// A low priority task on core 0 that compacts sealed day segments into a denser archive form and
+// deletes the oldest segments once they pass the retention period or the log outgrows its budget.
+// The newest segment is never touched.
+//
+// Archive file: a 24 byte ArchiveHeader followed by one entry per record, each three varints:
+//   seq - previous seq, zigzag(timestamp - previous timestamp), rollNum << 1 | departure
+// The first record is relative to firstSeq and to midnight of the segment's day. A typical record
+// shrinks from 16 bytes plus its share of batch markers to 4 or 5 bytes.
+
+#define ARCHIVE_MAGIC 0x43524152UL        // "RARC"
+#define ARCHIVE_AFTER_DAYS 2               // sealed segments at least this many days old get compacted
+#define LOG_RETENTION_DAYS 365             // segments older than this are deleted, 0 keeps them forever
+#define LOG_BUDGET_BYTES (512UL * 1024)    // oldest segments are deleted while the log is bigger than this
+#define ARCHIVE_POLL_MS 60000UL
+#define ARCHIVE_TASK_CORE 0
+#define ARCHIVE_TASK_PRIORITY 0            // only runs when the storage task and the web server are idle
+#define ARCHIVE_TASK_STACK 4096
+
+struct __attribute__((packed)) ArchiveHeader {
+    uint32_t magic;            // written last, a torn archive never has it
+    uint32_t day;
+    uint32_t firstSeq;
+    uint32_t count;            // records in the payload
+    uint32_t payloadLen;
+    uint32_t payloadCrc;
+};
+
+static_assert(sizeof(ArchiveHeader) == 24, "ArchiveHeader must stay 24 bytes");
+
+void archiveBegin(fs::FS &fs);
+bool archiveSegment(fs::FS &fs, size_t index);
+void archiveService(fs::FS &fs, uint32_t today);
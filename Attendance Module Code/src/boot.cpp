@@ -0,0 +1,63 @@
+#include "boot.h"
+#include "freertos/event_groups.h"
+
+static const char *const stageNames[BOOT_STAGES] = {
+    "clock", "display", "keypad", "interactive", "storage", "roster", "journal", "presence", "network", "web"
+};
+
+static EventGroupHandle_t bootEvents = nullptr;        // bit n set once stage n has finished
+static uint32_t finishedAt[BOOT_STAGES];               // micros() since the app started
+static uint32_t failedStages = 0;
+static uint32_t deferredAt = 0;                        // when the boot task was started
+static void (*deferredWork)() = nullptr;
+
+// Created by the first bootMark(), while setup() is still the only task
+static EventGroupHandle_t events() {
+    if (bootEvents == nullptr)
+        bootEvents = xEventGroupCreate();
+    return bootEvents;
+}
+
+void bootMark(BootStage stage, bool ok) {
+    finishedAt[stage] = micros();
+    if (!ok)
+        failedStages |= 1UL << stage;
+    xEventGroupSetBits(events(), 1UL << stage);
+}
+
+bool bootWait(BootStage stage, uint32_t timeoutMs) {
+    EventBits_t bits = xEventGroupWaitBits(events(), 1UL << stage, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeoutMs));
+    return (bits & (1UL << stage)) && !(failedStages & (1UL << stage));
+}
+
+uint32_t bootMillis(BootStage stage) {
+    return (xEventGroupGetBits(events()) & (1UL << stage)) ? finishedAt[stage] / 1000 : 0;
+}
+
+static void bootTask(void *) {
+    deferredWork();
+    bootRender(Serial);
+    vTaskDelete(nullptr);
+}
+
+void bootDefer(void (*work)()) {
+    deferredWork = work;
+    deferredAt = micros();
+    xTaskCreatePinnedToCore(bootTask, "boot", BOOT_TASK_STACK, nullptr, BOOT_TASK_PRIORITY, nullptr, BOOT_TASK_CORE);
+}
+
+// One line per stage: when it finished and how long it took, both in milliseconds. A stage took
+// the time since the one before it on the same task.
+void bootRender(Print &out) {
+    EventBits_t done = xEventGroupGetBits(events());
+    out.print("stage        done_ms  took_ms\n");
+    for (uint8_t s = 0; s < BOOT_STAGES; s++) {
+        if (!(done & (1UL << s))) {
+            out.printf("%-12s pending\n", stageNames[s]);
+            continue;
+        }
+        uint32_t started = s == 0 ? 0 : s == BOOT_STORAGE ? deferredAt : finishedAt[s - 1];
+        out.printf("%-12s %7lu %8lu%s\n", stageNames[s], (unsigned long)(finishedAt[s] / 1000),
+                   (unsigned long)((finishedAt[s] - started) / 1000), (failedStages & (1UL << s)) ? "  failed" : "");
+    }
+}
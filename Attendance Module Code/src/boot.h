@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Arduino.h>
+
+//----------------------------------------BOOT---------------------------------------
+// setup() only brings up what a check-in starts with: the clock, the LCD, the keypad and the UI.
+// Everything slow (mounting storage, loading the roster, journal and presence recovery, the soft
+// AP and the web server) runs afterwards on a boot task, so the home screen is up and keys are
+// taken as soon as possible after a reset or brown-out. Code that needs a later stage waits for
+// it with bootWait(), e.g. a check-in confirmed while the journal is still being recovered.
+//
+// Each stage is timestamped as it finishes. The profile is printed over serial once the boot task
+// is done and served on GET /boot.
+
+enum BootStage {
+    // setup(), in this order
+    BOOT_CLOCK,
+    BOOT_DISPLAY,
+    BOOT_KEYPAD,
+    BOOT_INTERACTIVE,        // home screen drawn, keys are handled from here on
+    // the boot task, in this order
+    BOOT_STORAGE,
+    BOOT_ROSTER,
+    BOOT_JOURNAL,
+    BOOT_PRESENCE,           // presence rebuilt and the storage task running: check-ins can be saved
+    BOOT_NETWORK,
+    BOOT_WEB,
+    BOOT_STAGES
+};
+
+#define BOOT_TASK_CORE 0
+#define BOOT_TASK_PRIORITY 1
+#define BOOT_TASK_STACK 8192
+#define BOOT_WAIT_MS 10000           // how long bootWait() gives a stage by default
+
+void bootMark(BootStage stage, bool ok = true);        // records that a stage has finished, or failed
+bool bootWait(BootStage stage, uint32_t timeoutMs = BOOT_WAIT_MS);        // false on timeout or if it failed
+void bootDefer(void (*work)());                        // runs work on the boot task, then prints the profile
+uint32_t bootMillis(BootStage stage);                  // when a stage finished, 0 if it has not yet
+void bootRender(Print &out);
@@ -0,0 +1,355 @@
+#include "checkin_ui.h"
+#include "epoch.h"
+#include "fmt.h"
+#include "metrics.h"
+
+static char const *wdays[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+static const char rushHint[] = "Roll, # | A Done";
+static const char notFound[] = "Not Found";
+static const char inBatch[] = "In Batch";
+static const char alreadyIn[] = "Already In";
+
+CheckinUi::CheckinUi(KeypadInput &keypad, Display &lcd, Clock &clock, AttendanceStore &store, Network &network, NameLookup lookup)
+    : keypad(keypad), lcd(lcd), clock(clock), store(store), network(network), lookup(lookup) {
+}
+
+void CheckinUi::begin() {
+    showHome();
+    lcd.flush();
+}
+
+// Handles at most one keypress and the screen timer, then pushes the frame to the display
+void CheckinUi::poll() {
+    char key = keypad.getKey();
+
+    if (key != NO_KEY) {
+        handleKey(key);
+    } else if (timerLeft() == 0) {
+        if (state == UI_RUSH) {
+            commitRush();
+        } else if (state == UI_RUSH_SUMMARY && summaryTop + 2 < summaryLines()) {
+            summaryTop++;
+            messageShownAt = clock.ticks();
+            showSummary();
+        } else {
+            showHome();
+        }
+    }
+    lcd.flush();
+}
+
+// Blocks until a key may have come in or the screen is due to change by itself, so the caller can
+// loop over wait() and poll() without spinning
+void CheckinUi::wait() {
+    keypad.waitForKey(timerLeft());
+}
+
+// Milliseconds until the screen changes without a key, KEY_WAIT_FOREVER if it does not
+unsigned long CheckinUi::timerLeft() {
+    unsigned long since, period;
+    if (state == UI_MESSAGE) {
+        since = messageShownAt;
+        period = MESSAGE_MS;
+    } else if (state == UI_RUSH) {
+        since = lastKeyAt;
+        period = RUSH_IDLE_COMMIT_MS;
+    } else if (state == UI_RUSH_SUMMARY) {
+        since = messageShownAt;
+        period = summaryTop + 2 < summaryLines() ? RUSH_SCROLL_MS : MESSAGE_MS;
+    } else {
+        return KEY_WAIT_FOREVER;
+    }
+    unsigned long elapsed = clock.ticks() - since;
+    return elapsed < period ? period - elapsed : 0;
+}
+
+// Moves the state machine on by one keypress
+void CheckinUi::handleKey(char pressed) {
+    switch (state) {
+    // ----------------------------------------------------------------------- HOME, OR A TIMED SCREEN THE KEY SKIPS  ----------
+    case UI_HOME:
+    case UI_MESSAGE:
+    case UI_RUSH_SUMMARY:
+        if (pressed == '*') {
+            startEntry(EVENT_ARRIVAL);
+        } else if (pressed == 'D') {
+            startEntry(EVENT_DEPARTURE);
+        } else if (pressed == 'A') {
+            startRush();
+        } else if (state == UI_RUSH_SUMMARY && pressed >= '0' && pressed <= '9') {
+            startRush();        // typed ahead into the next batch
+            rushDigit(pressed);
+        } else if (pressed == 'B') {
+            char address[20];
+            network.address(address, sizeof(address));
+            lcd.clear();
+            lcd.setCursor(0, 0);
+            lcd.print(address);
+            showTimed();
+        } else if (state != UI_HOME) {
+            showHome();
+        }
+        break;
+
+    // ----------------------------------------------------------------------- ROLL NUMBER DIGITS  ----------
+    case UI_ENTER_ROLL:
+        if (pressed == 'C') {
+            showHome();
+        } else if (pressed >= '0' && pressed <= '9') {
+            lcd.print(pressed);
+            value = value * 10 + (pressed - '0');
+            if (++digits == ROLL_DIGITS) {
+                lcd.setCursor(0, 0);
+                lcd.print("# Confirm C Abrt");
+                state = UI_CONFIRM;
+            }
+        } else {
+            lcd.setCursor(0, 0);
+            lcd.print("Enter Valid Num:");
+            lcd.setCursor(digits, 1);
+        }
+        break;
+
+    // ----------------------------------------------------------------------- # TO MARK, C TO RETURN TO PREV MENU  ----------
+    case UI_CONFIRM:
+        if (pressed == 'C') {
+            showHome();
+        } else if (pressed == '#') {
+            confirmEntry();
+        }
+        break;
+
+    // ----------------------------------------------------------------------- RUSH: ROLL, #, ROLL, #, ... A  ----------
+    case UI_RUSH:
+        lastKeyAt = clock.ticks();
+        if (pressed >= '0' && pressed <= '9') {
+            rushDigit(pressed);
+        } else if (pressed == '#') {
+            rushAccept();
+        } else if (pressed == 'C') {
+            rushUndo();
+        } else if (pressed == 'A') {
+            commitRush();
+        }
+        break;
+    }
+}
+
+// Prompts for a roll number for an arrival or a departure
+void CheckinUi::startEntry(uint8_t entryEvent) {
+    event = entryEvent;
+    entryStartedAt = clock.ticks();
+    value = 0;
+    digits = 0;
+    lcd.clear();
+    lcd.print("Enter Your RNum");
+    lcd.setCursor(0, 1);
+    state = UI_ENTER_ROLL;
+}
+
+// Marks the entered roll number and shows the outcome until it times out or the next key is pressed
+void CheckinUi::confirmEntry() {
+    char name[32];
+    uint32_t now = clock.now();
+    metricsObserve(STAGE_KEYPAD_TO_CONFIRM, (clock.ticks() - entryStartedAt) * 1000);
+    lcd.clear();
+    lcd.setCursor(0, 0);
+    if (!lookup(value, name, sizeof(name))) {
+        metricsCount(COUNTER_ROSTER_MISSES);
+        lcd.print("Error");
+        lcd.setCursor(0, 1);
+        lcd.print("User Not Found");
+        showTimed();
+        return;
+    }
+    MarkResult result = event == EVENT_ARRIVAL ? store.markAttendance(value, now) : store.markDeparture(value, now);
+    if (result == MARK_NOT_SAVED) {
+        lcd.print("Error: Not Saved");
+        lcd.setCursor(0, 1);
+        lcd.print("Please Try Again");
+    } else if (result == MARK_DUPLICATE) {
+        lcd.print(event == EVENT_ARRIVAL ? "Already In" : "Not Checked In");
+        lcd.setCursor(0, 1);
+        lcd.print(name);
+    } else {
+        lcd.print(event == EVENT_ARRIVAL ? "Welcome Back" : "See You Soon");
+        lcd.setCursor(0, 1);
+        lcd.print(name);
+    }
+    showTimed();
+}
+
+// Keeps what is on the LCD for MESSAGE_MS, unless a key is pressed first
+void CheckinUi::showTimed() {
+    messageShownAt = clock.ticks();
+    state = UI_MESSAGE;
+}
+
+// Draws the home screen with the current date
+void CheckinUi::showHome() {
+    DateTime now;
+    fromEpoch(clock.now(), now);
+    TextBuffer<17> text;        // one LCD line
+    text.put(wdays[now.weekday]).put(' ').num(now.date).put('/').num(now.month).put('/').num(now.year % 100);
+    lcd.clear();
+    lcd.print(text.c_str());
+    lcd.setCursor(0, 1);
+    lcd.print("*In D Out A Rush");
+    lcd.setCursor(0, 0);
+    value = 0;
+    state = UI_HOME;
+}
+
+// Starts an empty rush batch
+void CheckinUi::startRush() {
+    batchCount = 0;
+    value = 0;
+    digits = 0;
+    lastKeyAt = clock.ticks();
+    lcd.clear();
+    showLine(0, rushHint);
+    showRushPrompt();
+    state = UI_RUSH;
+}
+
+// Takes a digit of the roll number; once all are in, shows whose it is or why it will be refused
+void CheckinUi::rushDigit(char pressed) {
+    if (digits == ROLL_DIGITS) {
+        value = 0;        // typing over a roll number that was not taken with #
+        digits = 0;
+    }
+    if (digits == 0)
+        entryStartedAt = clock.ticks();
+    value = value * 10 + (pressed - '0');
+    if (++digits == ROLL_DIGITS) {
+        char name[32];
+        const char *problem = rushCheck(value, name, sizeof(name));
+        rushLine(0, problem ? "x" : "", value, problem ? problem : name);
+    }
+    showRushPrompt();
+}
+
+// Adds the roll number typed to the batch, if it passes the checks
+void CheckinUi::rushAccept() {
+    if (digits < ROLL_DIGITS) {
+        TextBuffer<UI_COLS + 1> text;
+        text.put("Type ").num(ROLL_DIGITS).put(" digits");
+        showLine(0, text.c_str());
+        return;
+    }
+    char name[32];
+    const char *problem = rushCheck(value, name, sizeof(name));
+    if (problem) {
+        metricsCount(problem == notFound ? COUNTER_ROSTER_MISSES : COUNTER_DUPLICATES);
+        rushLine(0, "x", value, problem);
+    } else {
+        metricsObserve(STAGE_KEYPAD_TO_CONFIRM, (clock.ticks() - entryStartedAt) * 1000);
+        batch[batchCount++] = { value, clock.now(), MARK_SAVED };
+        rushLine(0, "+", value, name);
+    }
+    value = 0;
+    digits = 0;
+    if (batchCount == RUSH_MAX_ENTRIES)
+        commitRush();
+    else
+        showRushPrompt();
+}
+
+// C: clears the digits typed, else takes back the last entry, else leaves rush mode
+void CheckinUi::rushUndo() {
+    if (digits > 0) {
+        value = 0;
+        digits = 0;
+        showLine(0, rushHint);
+    } else if (batchCount > 0) {
+        batchCount--;
+        rushLine(0, "-", batch[batchCount].rollNum, "Taken Back");
+    } else {
+        showHome();
+        return;
+    }
+    showRushPrompt();
+}
+
+// Returns why a roll number cannot join the batch, or nullptr (and its name) if it can
+const char *CheckinUi::rushCheck(uint16_t rollNum, char *name, size_t len) {
+    if (!lookup(rollNum, name, len))
+        return notFound;
+    for (uint8_t i = 0; i < batchCount; i++) {
+        if (batch[i].rollNum == rollNum)
+            return inBatch;
+    }
+    return store.checkedIn(rollNum) ? alreadyIn : nullptr;
+}
+
+// Marks the whole batch as one group and scrolls through the outcome
+void CheckinUi::commitRush() {
+    if (batchCount == 0) {
+        showHome();
+        return;
+    }
+    store.markArrivals(batch, batchCount);
+    summaryTop = 0;
+    messageShownAt = clock.ticks();
+    state = UI_RUSH_SUMMARY;
+    showSummary();
+}
+
+// The summary is a count of what was saved, then a line per entry that was not
+uint8_t CheckinUi::summaryLines() {
+    uint8_t lines = 1;
+    for (uint8_t i = 0; i < batchCount; i++)
+        lines += batch[i].result != MARK_SAVED;
+    return lines;
+}
+
+void CheckinUi::showSummary() {
+    uint8_t saved = batchCount + 1 - summaryLines();
+    uint8_t line = 0;        // summary line of the entry looked at
+    lcd.clear();
+    for (uint8_t row = 0; row < 2; row++) {
+        uint8_t wanted = summaryTop + row;
+        if (wanted == 0) {
+            TextBuffer<UI_COLS + 1> text;
+            text.put("Saved ").num(saved).put(" of ").num(batchCount);
+            showLine(row, text.c_str());
+            continue;
+        }
+        uint8_t i = 0;
+        for (; i < batchCount; i++) {
+            if (batch[i].result != MARK_SAVED && ++line == wanted)
+                break;
+        }
+        if (i < batchCount)
+            rushLine(row, "!", batch[i].rollNum, batch[i].result == MARK_DUPLICATE ? alreadyIn : "Not Saved");
+        else
+            showLine(row, "A Rush | * Arr");
+        line = 0;
+    }
+}
+
+// Draws one line as a mark, the roll number and a name or reason, e.g. "+17 Bruce Wayne"
+void CheckinUi::rushLine(uint8_t row, const char *mark, uint16_t rollNum, const char *text) {
+    TextBuffer<UI_COLS + 1> line;
+    line.put(mark).num(rollNum, ROLL_DIGITS).put(' ').put(text);
+    showLine(row, line.c_str());
+}
+
+// Draws the batch size and the digits typed so far, e.g. "Rush 03 Roll 1_"
+void CheckinUi::showRushPrompt() {
+    TextBuffer<UI_COLS + 1> text;
+    text.put("Rush ").num(batchCount, 2).put(" Roll ");
+    if (digits > 0)
+        text.num(value, digits);
+    for (uint8_t i = digits; i < ROLL_DIGITS; i++)
+        text.put('_');
+    showLine(1, text.c_str());
+}
+
+// Writes a whole LCD line, padding the rest with spaces
+void CheckinUi::showLine(uint8_t row, const char *text) {
+    lcd.setCursor(0, row);
+    size_t n = lcd.print(text);
+    while (n++ < UI_COLS)
+        lcd.print(' ');
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "hal.h"
+#include "journal.h"
+
+//----------------------------------------CHECK-IN UI---------------------------------------
+// The keypad/LCD check-in flow as a non-blocking state machine. poll() handles at most one
+// keypress and the screen timer, then returns. Arrival and departure share the same states:
+//
+//   HOME --* or D--> ENTER_ROLL --digits--> CONFIRM --#--> MESSAGE --timeout or key--> HOME
+//                        \--C--> HOME           \--C--> HOME
+//
+// Rush mode is for the morning queue. A at home starts a batch of arrivals; roll numbers are then
+// typed back to back, each closed with #, and checked against the roster and who is already in as
+// soon as the digits are in. Nothing is marked until the batch ends (A again, a full batch or an
+// idle keypad), when the whole batch goes to storage as one group write and a summary scrolls by.
+// C clears the digits typed so far or, with none typed, takes back the last entry.
+//
+//   HOME --A--> RUSH --digits, #--> RUSH --A, full or idle--> RUSH_SUMMARY --scrolled or key--> HOME
+//                                                                  \--digit--> RUSH
+
+#define MESSAGE_MS 2000      // how long welcome/error screens stay up if no key is pressed
+#define UI_COLS 16           // characters per LCD line
+
+// A batch fits in one journal batch next to single check-ins that are still pending
+#define RUSH_MAX_ENTRIES (JOURNAL_MAX_BATCH - JOURNAL_FLUSH_THRESHOLD + 1)
+#define RUSH_IDLE_COMMIT_MS 15000        // a batch is marked once the keypad has been idle this long
+#define RUSH_SCROLL_MS 1200              // per line of the summary
+
+class CheckinUi {
+  public:
+    CheckinUi(KeypadInput &keypad, Display &lcd, Clock &clock, AttendanceStore &store, Network &network, NameLookup lookup);
+    void begin();
+    void poll();
+    void wait();
+
+  private:
+    enum State { UI_HOME, UI_ENTER_ROLL, UI_CONFIRM, UI_MESSAGE, UI_RUSH, UI_RUSH_SUMMARY };
+
+    void handleKey(char pressed);
+    void startEntry(uint8_t event);
+    void confirmEntry();
+    void showTimed();
+    void showHome();
+    void startRush();
+    void rushDigit(char pressed);
+    void rushAccept();
+    void rushUndo();
+    void commitRush();
+    const char *rushCheck(uint16_t rollNum, char *name, size_t len);
+    void rushLine(uint8_t row, const char *mark, uint16_t rollNum, const char *text);
+    void showRushPrompt();
+    void showSummary();
+    uint8_t summaryLines();
+    void showLine(uint8_t row, const char *text);
+    unsigned long timerLeft();
+
+    KeypadInput &keypad;
+    Display &lcd;
+    Clock &clock;
+    AttendanceStore &store;
+    Network &network;
+    NameLookup lookup;
+
+    State state = UI_HOME;
+    uint8_t event = EVENT_ARRIVAL;        // what the roll number being entered will be marked as
+    uint16_t value = 0;
+    uint8_t digits = 0;
+    unsigned long messageShownAt = 0;
+    unsigned long entryStartedAt = 0;
+
+    BatchEntry batch[RUSH_MAX_ENTRIES];
+    uint8_t batchCount = 0;
+    uint8_t summaryTop = 0;              // first summary line on screen
+    unsigned long lastKeyAt = 0;         // in rush mode, for the idle commit
+};
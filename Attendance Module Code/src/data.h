@@ -1,34 +1,49 @@
-#include <map>
+// Generated by tools/gen_roster.py from roster.csv - edit the CSV, not this file
+#pragma once
 
-std::map<int, String> student_data{
-    { 1, "Bruce Wayne" },
-    { 2, "Harvey Dent" },
-    { 3, "Alfred Pennyworth" },
-    { 4, "James Gordon" },
-    { 5, "Rachel Dawes" },
-    { 6, "The Joker" },
-    { 7, "Lucius Fox" },
-    { 8, "Selina Kyle" },
-    { 9, "Jonathan Crane" },
-    { 10, "Ra's al Ghul" },
-    { 11, "Carmine Falcone" },
-    { 12, "Sal Maroni" },
-    { 13, "Victor Zsasz" },
-    { 14, "Barbara Gordon" },
-    { 15, "Dick Grayson" },
-    { 16, "Jason Todd" },
-    { 17, "Tim Drake" },
-    { 18, "Damian Wayne" },
-    { 19, "Catwoman" },
-    { 20, "Two-Face" },
-    { 21, "Scarecrow" },
-    { 22, "Bane" },
-    { 23, "The Penguin" },
-    { 24, "The Riddler" },
-    { 25, "Mr. Freeze" },
-    { 26, "Poison Ivy" },
-    { 27, "Harley Quinn" },
-    { 28, "The Mad Hatter" },
-    { 29, "Ra's al Ghul" },
-    { 30, "Hush" }
-};
\ No newline at end of file
+#include <stdint.h>
+
+#define ROSTER_SIZE 30
+#define ROSTER_DENSE 1        // roll numbers run from ROSTER_IDS[0] without gaps
+
+constexpr uint16_t ROSTER_IDS[ROSTER_SIZE] = {
+    1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
+    17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30,
+};
+
+constexpr uint32_t ROSTER_NAME_OFFSETS[ROSTER_SIZE] = {
+    0, 12, 24, 42, 55, 68, 78, 89, 101, 116, 129, 145, 156, 169, 184, 197,
+    208, 218, 231, 240, 249, 259, 264, 276, 288, 299, 310, 323, 338, 351,
+};
+
+constexpr char ROSTER_NAMES[] =
+    "Bruce Wayne\0"
+    "Harvey Dent\0"
+    "Alfred Pennyworth\0"
+    "James Gordon\0"
+    "Rachel Dawes\0"
+    "The Joker\0"
+    "Lucius Fox\0"
+    "Selina Kyle\0"
+    "Jonathan Crane\0"
+    "Ra's al Ghul\0"
+    "Carmine Falcone\0"
+    "Sal Maroni\0"
+    "Victor Zsasz\0"
+    "Barbara Gordon\0"
+    "Dick Grayson\0"
+    "Jason Todd\0"
+    "Tim Drake\0"
+    "Damian Wayne\0"
+    "Catwoman\0"
+    "Two-Face\0"
+    "Scarecrow\0"
+    "Bane\0"
+    "The Penguin\0"
+    "The Riddler\0"
+    "Mr. Freeze\0"
+    "Poison Ivy\0"
+    "Harley Quinn\0"
+    "The Mad Hatter\0"
+    "Ra's al Ghul\0"
+    "Hush\0";
@@ -0,0 +1,62 @@
+#include "epoch.h"
+#include "fmt.h"
+
+// Counts the days between 1970-01-01 and the given civil date (proleptic Gregorian calendar)
+static int32_t daysFromCivil(int32_t y, uint8_t m, uint8_t d) {
+    y -= m <= 2;
+    int32_t era = (y >= 0 ? y : y - 399) / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+// Converts a calendar date and time into seconds since 1970-01-01 00:00:00
+uint32_t toEpoch(uint16_t year, uint8_t month, uint8_t date, uint8_t hours, uint8_t minutes, uint8_t seconds) {
+    return (uint32_t)daysFromCivil(year, month, date) * 86400UL + hours * 3600UL + minutes * 60UL + seconds;
+}
+
+// Converts seconds since 1970-01-01 00:00:00 back into a calendar date and time
+void fromEpoch(uint32_t epoch, DateTime &dt) {
+    int32_t z = epoch / 86400UL;
+    uint32_t secs = epoch % 86400UL;
+    dt.hours = secs / 3600;
+    dt.minutes = (secs / 60) % 60;
+    dt.seconds = secs % 60;
+    dt.weekday = (uint8_t)((z + 4) % 7);        // 1970-01-01 was a Thursday
+
+    z += 719468;
+    int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    uint32_t doe = (uint32_t)(z - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    dt.date = doy - (153 * mp + 2) / 5 + 1;
+    dt.month = mp < 10 ? mp + 3 : mp - 9;
+    dt.year = (uint16_t)(yoe + era * 400 + (dt.month <= 2));
+}
+
+// Parses a "YYYY-MM-DD" date into days since 1970-01-01, returns false if it is malformed
+bool parseIsoDate(const char *text, uint32_t &day) {
+    unsigned year, month, date;
+    char tail;
+    if (sscanf(text, "%4u-%2u-%2u%c", &year, &month, &date, &tail) != 3)
+        return false;
+    if (year < 1970 || month < 1 || month > 12 || date < 1 || date > 31)
+        return false;
+    day = (uint32_t)daysFromCivil(year, month, date);
+    return true;
+}
+
+// Formats a time as an HTTP date, e.g. "Fri, 12 May 2023 08:03:00 GMT". The RTC keeps local time
+// and has no time zone, so it is labelled GMT as HTTP requires; clients only compare it.
+size_t formatHttpDate(uint32_t epoch, char *buf, size_t len) {
+    static const char *days[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static const char *months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    DateTime dt;
+    fromEpoch(epoch, dt);
+    TextWriter text(buf, len);
+    text.put(days[dt.weekday]).put(", ").num(dt.date, 2).put(' ').put(months[dt.month - 1]).put(' ').num(dt.year, 4).put(' ');
+    text.clockTime(dt.hours, dt.minutes, dt.seconds).put(" GMT");
+    return text.length();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Broken-down calendar time, as kept by the DS3231 (year is the full year, e.g. 2023)
+struct DateTime {
+    uint16_t year;
+    uint8_t month;
+    uint8_t date;
+    uint8_t hours;
+    uint8_t minutes;
+    uint8_t seconds;
+    uint8_t weekday;        // 0 = Sunday, matches wdays[]
+};
+
+uint32_t toEpoch(uint16_t year, uint8_t month, uint8_t date, uint8_t hours, uint8_t minutes, uint8_t seconds);
+void fromEpoch(uint32_t epoch, DateTime &dt);
+bool parseIsoDate(const char *text, uint32_t &day);
+size_t formatHttpDate(uint32_t epoch, char *buf, size_t len);
@@ -0,0 +1,109 @@
+#include "fmt.h"
+#include <string.h>
+
+static const char digitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Fills a scratch buffer from its end, two digits per division
+size_t formatDecimal(uint32_t value, char *out) {
+    char scratch[10];
+    char *p = scratch + sizeof(scratch);
+    while (value >= 100) {
+        uint32_t pair = value % 100;
+        value /= 100;
+        p -= 2;
+        memcpy(p, digitPairs + pair * 2, 2);
+    }
+    if (value >= 10) {
+        p -= 2;
+        memcpy(p, digitPairs + value * 2, 2);
+    } else {
+        *--p = '0' + value;
+    }
+    size_t n = scratch + sizeof(scratch) - p;
+    memcpy(out, p, n);
+    return n;
+}
+
+TextWriter::TextWriter(char *buf, size_t size) : buf(buf), size(size) {
+    if (size > 0)
+        buf[0] = '\0';
+}
+
+void TextWriter::clear() {
+    len = 0;
+    cut = false;
+    if (size > 0)
+        buf[0] = '\0';
+}
+
+TextWriter &TextWriter::put(const char *text, size_t n) {
+    size_t room = size > len ? size - len - 1 : 0;
+    if (n > room) {
+        n = room;
+        cut = true;
+    }
+    memcpy(buf + len, text, n);
+    len += n;
+    if (size > 0)
+        buf[len] = '\0';
+    return *this;
+}
+
+TextWriter &TextWriter::put(char c) {
+    return put(&c, 1);
+}
+
+TextWriter &TextWriter::put(const char *text) {
+    return put(text, strlen(text));
+}
+
+TextWriter &TextWriter::num(uint32_t value, uint8_t width) {
+    char digits[10];
+    size_t n = formatDecimal(value, digits);
+    while (width > n) {
+        put('0');
+        width--;
+    }
+    return put(digits, n);
+}
+
+TextWriter &TextWriter::num64(uint64_t value) {
+    if (value <= UINT32_MAX)
+        return num((uint32_t)value);
+    // Top part first, then the low nine digits zero padded
+    num64(value / 1000000000);
+    return num((uint32_t)(value % 1000000000), 9);
+}
+
+TextWriter &TextWriter::hex(uint32_t value, uint8_t width) {
+    static const char hexDigits[] = "0123456789abcdef";
+    char digits[8];
+    size_t n = 0;
+    do {
+        digits[7 - n++] = hexDigits[value & 0xf];
+        value >>= 4;
+    } while (value);
+    while (width > n) {
+        put('0');
+        width--;
+    }
+    return put(digits + 8 - n, n);
+}
+
+TextWriter &TextWriter::isoDate(uint16_t year, uint8_t month, uint8_t date) {
+    return num(year, 4).put('-').num(month, 2).put('-').num(date, 2);
+}
+
+TextWriter &TextWriter::clockTime(uint8_t hours, uint8_t minutes, uint8_t seconds) {
+    return num(hours, 2).put(':').num(minutes, 2).put(':').num(seconds, 2);
+}
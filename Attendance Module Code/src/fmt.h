@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//----------------------------------------TEXT FORMATTING---------------------------------------
+// Builds text into a fixed buffer without touching the heap, for the LCD, journal and HTTP paths
+// that run on every check-in or request. Calls chain, e.g.
+//
+//   TextBuffer<16> text;
+//   text.put("Fri ").num(dt.date).put('/').num(dt.month, 2);
+//
+// Text that does not fit is cut off (truncated() tells) and the buffer always stays
+// '\0'-terminated. Integers are rendered two digits at a time from a table instead of through
+// printf. Only depends on <stdint.h> and <stddef.h>, so it builds the same on a desktop.
+
+class TextWriter {
+  public:
+    TextWriter(char *buf, size_t size);        // size includes the terminating '\0'
+
+    TextWriter &put(char c);
+    TextWriter &put(const char *text);
+    TextWriter &put(const char *text, size_t len);
+    TextWriter &num(uint32_t value, uint8_t width = 0);        // decimal, zero padded to width
+    TextWriter &num64(uint64_t value);
+    TextWriter &hex(uint32_t value, uint8_t width = 0);        // lower case, zero padded to width
+    TextWriter &isoDate(uint16_t year, uint8_t month, uint8_t date);        // 2023-05-12
+    TextWriter &clockTime(uint8_t hours, uint8_t minutes, uint8_t seconds);        // 08:03:00
+
+    const char *c_str() const { return buf; }
+    size_t length() const { return len; }
+    bool truncated() const { return cut; }
+    void clear();
+
+  private:
+    char *buf;
+    size_t size;
+    size_t len = 0;
+    bool cut = false;
+};
+
+// A TextWriter with its own buffer, sized for the longest text it is meant to hold
+template <size_t N>
+class TextBuffer : public TextWriter {
+  public:
+    TextBuffer() : TextWriter(storage, N) {}
+
+  private:
+    char storage[N];
+};
+
+// Renders value in decimal into out (at least 10 bytes), not terminated; returns the digit count
+size_t formatDecimal(uint32_t value, char *out);
@@ -0,0 +1,270 @@
+#include "gzip.h"
+
+#define GZIP_MIN_MATCH 3
+#define GZIP_MAX_MATCH 258
+#define GZIP_NIL 0xffff
+
+static const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t distBase[24] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073 };
+static const uint8_t distExtra[24] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10 };
+
+static_assert(GZIP_WINDOW <= 4096, "distBase only covers distances up to 4096");
+
+static inline uint16_t hashAt(const uint8_t *p) {
+    return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & ((1 << GZIP_HASH_BITS) - 1);
+}
+
+static uint8_t lengthCode(uint16_t length) {
+    uint8_t code = 28;
+    while (lengthBase[code] > length)
+        code--;
+    return code;
+}
+
+static uint8_t distanceCode(uint16_t distance) {
+    uint8_t code = 23;
+    while (distBase[code] > distance)
+        code--;
+    return code;
+}
+
+// Writes the gzip header; the blocks follow as the input is parsed
+GzipStream::GzipStream(JournalStream &source) : source(source) {
+    static const uint8_t header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+    memcpy(out, header, sizeof(header));
+    outLen = sizeof(header);
+    memset(head, 0xff, sizeof(head));
+    memset(prev, 0xff, sizeof(prev));
+}
+
+// Hands out compressed bytes, returns 0 once the trailer has been read
+size_t GzipStream::read(uint8_t *buffer, size_t maxLen) {
+    size_t written = 0;
+    while (written < maxLen) {
+        if (outPos == outLen) {
+            if (phase == GZIP_DONE)
+                break;
+            outPos = outLen = 0;
+            encode();
+            continue;
+        }
+        size_t n = outLen - outPos;
+        if (n > maxLen - written)
+            n = maxLen - written;
+        memcpy(buffer + written, out + outPos, n);
+        outPos += n;
+        written += n;
+    }
+    return written;
+}
+
+// Tops up the lookahead, first sliding the window down by half once it is full
+void GzipStream::refill() {
+    if (inEnd == sizeof(window) && inPos >= GZIP_WINDOW) {
+        memmove(window, window + GZIP_WINDOW, inEnd - GZIP_WINDOW);
+        inEnd -= GZIP_WINDOW;
+        inPos -= GZIP_WINDOW;
+        blockStart -= GZIP_WINDOW;
+        for (uint16_t &pos : head)
+            pos = pos != GZIP_NIL && pos >= GZIP_WINDOW ? pos - GZIP_WINDOW : GZIP_NIL;
+        for (uint16_t &pos : prev)
+            pos = pos != GZIP_NIL && pos >= GZIP_WINDOW ? pos - GZIP_WINDOW : GZIP_NIL;
+    }
+    while (inEnd < sizeof(window) && !sourceDone) {
+        size_t n = source.read(window + inEnd, sizeof(window) - inEnd);
+        if (n == 0) {
+            sourceDone = true;
+            break;
+        }
+        crc = crc32(window + inEnd, n, crc);
+        totalIn += n;
+        inEnd += n;
+    }
+}
+
+// Compresses until the output buffer is nearly full or the trailer is out
+void GzipStream::encode() {
+    while (outLen < GZIP_OUT_SIZE - 16 && phase != GZIP_DONE) {
+        if (phase == GZIP_PARSE)
+            parse();
+        else if (phase == GZIP_SEND_FIXED)
+            sendFixed();
+        else
+            sendStored();
+    }
+}
+
+// Runs LZ77 over the input into a block of symbols, costing them as it goes, then opens the block
+void GzipStream::parse() {
+    blockStart = inPos;
+    symCount = 0;
+    fixedBits = 7;        // the end of block code
+    while (symCount < GZIP_BLOCK_SYMBOLS) {
+        if (inEnd - inPos < GZIP_MAX_MATCH && !sourceDone) {
+            // Sliding the window would drop input this block may still have to send stored
+            if (inEnd == sizeof(window) && inPos >= GZIP_WINDOW && blockStart < GZIP_WINDOW)
+                break;
+            refill();
+        }
+        if (inPos == inEnd) {
+            lastBlock = true;
+            break;
+        }
+        uint16_t distance;
+        uint16_t length = longestMatch(inPos, distance);
+        if (length >= GZIP_MIN_MATCH) {
+            uint8_t code = lengthCode(length);
+            fixedBits += (257 + code < 280 ? 7 : 8) + lengthExtra[code] + 5 + distExtra[distanceCode(distance)];
+            symLength[symCount] = length - GZIP_MIN_MATCH;
+            symDistance[symCount++] = distance;
+            for (uint16_t i = 0; i < length; i++)
+                insert(inPos + i);
+            inPos += length;
+        } else {
+            fixedBits += window[inPos] < 144 ? 8 : 9;
+            symLength[symCount] = window[inPos];
+            symDistance[symCount++] = 0;
+            insert(inPos);
+            inPos++;
+        }
+    }
+    startBlock();
+}
+
+// Writes the block header, stored if the fixed Huffman codes would come out longer than the input
+void GzipStream::startBlock() {
+    uint16_t length = inPos - blockStart;
+    uint8_t pad = (8 - (bitCount + 3) % 8) % 8;
+    putBits(lastBlock, 1);        // BFINAL
+    if (pad + 32 + 8UL * length < fixedBits) {
+        putBits(0, 2);            // BTYPE = stored
+        if (bitCount > 0)
+            putBits(0, 8 - bitCount);
+        putBits(length, 16);
+        putBits((uint16_t)~length, 16);
+        storedSent = blockStart;
+        phase = GZIP_SEND_STORED;
+    } else {
+        putBits(1, 2);            // BTYPE = fixed Huffman
+        symSent = 0;
+        phase = GZIP_SEND_FIXED;
+    }
+}
+
+void GzipStream::sendFixed() {
+    while (outLen < GZIP_OUT_SIZE - 16 && symSent < symCount) {
+        if (symDistance[symSent] == 0)
+            putLiteral(symLength[symSent]);
+        else
+            putMatch(symLength[symSent] + GZIP_MIN_MATCH, symDistance[symSent]);
+        symSent++;
+    }
+    if (symSent == symCount) {
+        putLiteral(256);
+        endBlock();
+    }
+}
+
+// Copies the block's input out as it is, leaving room for the trailer
+void GzipStream::sendStored() {
+    size_t n = inPos - storedSent;
+    if (n > GZIP_OUT_SIZE - 16 - outLen)
+        n = GZIP_OUT_SIZE - 16 - outLen;
+    memcpy(out + outLen, window + storedSent, n);
+    outLen += n;
+    storedSent += n;
+    if (storedSent == inPos)
+        endBlock();
+}
+
+void GzipStream::endBlock() {
+    if (lastBlock) {
+        putTrailer();
+        phase = GZIP_DONE;
+    } else {
+        phase = GZIP_PARSE;
+    }
+}
+
+void GzipStream::insert(uint16_t pos) {
+    if (pos + GZIP_MIN_MATCH > inEnd)
+        return;
+    uint16_t h = hashAt(window + pos);
+    prev[pos & (GZIP_WINDOW - 1)] = head[h];
+    head[h] = pos;
+}
+
+// Walks the hash chain for the longest earlier string matching the one at pos
+uint16_t GzipStream::longestMatch(uint16_t pos, uint16_t &distance) {
+    uint16_t maxLength = inEnd - pos < GZIP_MAX_MATCH ? inEnd - pos : GZIP_MAX_MATCH;
+    if (maxLength < GZIP_MIN_MATCH)
+        return 0;
+    uint16_t best = 0;
+    uint16_t candidate = head[hashAt(window + pos)];
+    for (uint8_t chain = GZIP_MAX_CHAIN; chain > 0 && candidate < pos && pos - candidate <= GZIP_WINDOW; chain--) {
+        if (window[candidate + best] == window[pos + best]) {
+            uint16_t length = 0;
+            while (length < maxLength && window[candidate + length] == window[pos + length])
+                length++;
+            if (length > best) {
+                best = length;
+                distance = pos - candidate;
+                if (best == maxLength)
+                    break;
+            }
+        }
+        candidate = prev[candidate & (GZIP_WINDOW - 1)];
+    }
+    return best;
+}
+
+// Deflate packs bits starting at the least significant bit of each byte
+void GzipStream::putBits(uint32_t bits, uint8_t count) {
+    bitBuf |= bits << bitCount;
+    bitCount += count;
+    while (bitCount >= 8) {
+        out[outLen++] = bitBuf;
+        bitBuf >>= 8;
+        bitCount -= 8;
+    }
+}
+
+// Huffman codes go out most significant bit first, so they are reversed into putBits() order
+void GzipStream::putHuffman(uint16_t code, uint8_t length) {
+    uint16_t reversed = 0;
+    for (uint8_t i = 0; i < length; i++, code >>= 1)
+        reversed = (reversed << 1) | (code & 1);
+    putBits(reversed, length);
+}
+
+// Literal/length symbol with the fixed code from RFC 1951 section 3.2.6
+void GzipStream::putLiteral(uint16_t symbol) {
+    if (symbol < 144)
+        putHuffman(0x30 + symbol, 8);
+    else if (symbol < 256)
+        putHuffman(0x190 + symbol - 144, 9);
+    else if (symbol < 280)
+        putHuffman(symbol - 256, 7);
+    else
+        putHuffman(0xc0 + symbol - 280, 8);
+}
+
+void GzipStream::putMatch(uint16_t length, uint16_t distance) {
+    uint8_t code = lengthCode(length);
+    putLiteral(257 + code);
+    putBits(length - lengthBase[code], lengthExtra[code]);
+    code = distanceCode(distance);
+    putHuffman(code, 5);
+    putBits(distance - distBase[code], distExtra[code]);
+}
+
+// Ends the last block on a byte and appends the CRC-32 and length of the uncompressed data
+void GzipStream::putTrailer() {
+    if (bitCount > 0)
+        putBits(0, 8 - bitCount);
+    for (uint8_t i = 0; i < 4; i++)
+        out[outLen++] = crc >> (8 * i);
+    for (uint8_t i = 0; i < 4; i++)
+        out[outLen++] = totalIn >> (8 * i);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "journal.h"
+#include <Arduino.h>
+
+//----------------------------------------GZIP STREAM---------------------------------------
+// Compresses a JournalStream into a gzip stream as it is read, for clients that send
+// "Accept-Encoding: gzip". Memory use is fixed no matter how long the export is: a two window
+// input buffer, a hash table with chains, one block of LZ77 symbols and a small output buffer,
+// about 13 KB in all.
+//
+// The encoder is deliberately simple: LZ77 over a GZIP_WINDOW byte window with a short hash chain
+// search, coded with the fixed Huffman tables. CSV rows repeat most of their text, so this gets
+// most of what a full deflate would on the export, at a fraction of the code. Each block is parsed
+// before it is sent, and goes out stored instead whenever that is shorter, so input that does not
+// compress grows by well under 1%.
+
+#define GZIP_WINDOW 2048             // power of two, largest distance a match can reach back
+#define GZIP_HASH_BITS 9
+#define GZIP_MAX_CHAIN 16            // candidates tried per position
+#define GZIP_BLOCK_SYMBOLS 1024      // literals and matches per deflate block, 3 bytes each
+#define GZIP_OUT_SIZE 512
+
+class GzipStream {
+  public:
+    GzipStream(JournalStream &source);
+    size_t read(uint8_t *buffer, size_t maxLen);
+
+  private:
+    enum Phase { GZIP_PARSE, GZIP_SEND_FIXED, GZIP_SEND_STORED, GZIP_DONE };
+
+    void refill();
+    void encode();
+    void parse();
+    void startBlock();
+    void sendFixed();
+    void sendStored();
+    void endBlock();
+    void insert(uint16_t pos);
+    uint16_t longestMatch(uint16_t pos, uint16_t &distance);
+    void putBits(uint32_t bits, uint8_t count);
+    void putHuffman(uint16_t code, uint8_t length);
+    void putLiteral(uint16_t symbol);
+    void putMatch(uint16_t length, uint16_t distance);
+    void putTrailer();
+
+    JournalStream &source;
+    bool sourceDone = false;
+    Phase phase = GZIP_PARSE;
+    uint8_t window[2 * GZIP_WINDOW];
+    uint16_t head[1 << GZIP_HASH_BITS];
+    uint16_t prev[GZIP_WINDOW];
+    uint16_t inPos = 0;
+    uint16_t inEnd = 0;
+    uint32_t crc = 0;
+    uint32_t totalIn = 0;
+
+    // The block being parsed or sent: its input is window[blockStart, inPos)
+    uint8_t symLength[GZIP_BLOCK_SYMBOLS];          // match length - 3, or the literal byte
+    uint16_t symDistance[GZIP_BLOCK_SYMBOLS];       // 0 for a literal
+    uint16_t symCount = 0;
+    uint16_t symSent = 0;
+    uint16_t blockStart = 0;
+    uint16_t storedSent = 0;        // window position of the next byte of a stored block
+    uint32_t fixedBits = 0;         // the block's length with the fixed Huffman codes, header aside
+    bool lastBlock = false;
+
+    uint8_t out[GZIP_OUT_SIZE];
+    size_t outLen = 0;
+    size_t outPos = 0;
+    uint32_t bitBuf = 0;
+    uint8_t bitCount = 0;
+};
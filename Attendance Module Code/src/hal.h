@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Arduino.h>
+#include <limits.h>
+
+#ifndef NO_KEY
+#define NO_KEY '\0'        // same value the Keypad library uses
+#endif
+#define KEY_WAIT_FOREVER ULONG_MAX
+
+#ifndef ROLL_DIGITS
+#define ROLL_DIGITS 2        // digits typed for a roll number
+#endif
+
+// Roll numbers the keypad can enter run from 0 to ROLL_LIMIT - 1
+constexpr uint32_t rollLimit(uint8_t digits) {
+    return digits == 0 ? 1 : 10 * rollLimit(digits - 1);
+}
+#define ROLL_LIMIT rollLimit(ROLL_DIGITS)
+
+//----------------------------------------HARDWARE ABSTRACTION---------------------------------------
+// The check-in logic (checkin_ui.h) only talks to the hardware through these interfaces. The ESP32
+// implementations live in hal_esp32.h; a host build can supply its own to run the same logic off-device.
+
+class KeypadInput {
+  public:
+    virtual ~KeypadInput() {}
+    virtual char getKey() = 0;        // NO_KEY when nothing was pressed
+    virtual void waitForKey(unsigned long /*timeoutMs*/) {}        // blocks until a key may be waiting, if the keypad can
+};
+
+class Display : public Print {
+  public:
+    virtual ~Display() {}
+    virtual void clear() = 0;
+    virtual void setCursor(uint8_t col, uint8_t row) = 0;
+    virtual void flush() = 0;        // pushes everything drawn since the last flush to the screen
+};
+
+class Clock {
+  public:
+    virtual ~Clock() {}
+    virtual uint32_t now() = 0;              // seconds since 1970-01-01, local time
+    virtual unsigned long ticks() = 0;       // milliseconds, for UI timers
+};
+
+enum MarkResult {
+    MARK_SAVED,
+    MARK_NOT_SAVED,        // the event could not be recorded
+    MARK_DUPLICATE         // arrival while already in, or departure while not in
+};
+
+// One arrival of a rush batch; markArrivals() fills in the result
+struct BatchEntry {
+    uint16_t rollNum;
+    uint32_t timestamp;
+    MarkResult result;
+};
+
+class AttendanceStore {
+  public:
+    virtual ~AttendanceStore() {}
+    virtual MarkResult markAttendance(uint16_t rollNum, uint32_t timestamp) = 0;
+    virtual MarkResult markDeparture(uint16_t rollNum, uint32_t timestamp) = 0;
+    virtual void markArrivals(BatchEntry *entries, uint8_t count) = 0;        // written as one group
+    virtual bool checkedIn(uint16_t rollNum) = 0;        // arrived today and not left, as far as known yet
+};
+
+class Network {
+  public:
+    virtual ~Network() {}
+    virtual bool begin() = 0;
+    virtual void address(char *buf, size_t len) = 0;        // what to show the user to connect to
+};
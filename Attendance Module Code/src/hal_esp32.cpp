@@ -0,0 +1,74 @@
+#include "hal_esp32.h"
+#include "boot.h"
+#include "fmt.h"
+#include "journal.h"
+#include "log.h"
+#include "metrics.h"
+#include "presence.h"
+#include "rtc.h"
+#include "storage.h"
+#include <WiFi.h>
+
+uint32_t Esp32Clock::now() {
+    return clockNow();
+}
+
+// Checks an event against today's presence and hands it to the storage task through submit
+static MarkResult mark(uint16_t rollNum, uint8_t event, uint32_t timestamp, EventSink submit) {
+    const char *kind = event == EVENT_ARRIVAL ? "Arrival" : "Departure";
+    // Confirmed before the boot task got storage going: presence is not rebuilt yet
+    if (!bootWait(BOOT_PRESENCE)) {
+        metricsCount(COUNTER_FAILED_APPENDS);
+        LOG_PRINTF("− storage not available, %s for %d not recorded\r\n", kind, rollNum);
+        return MARK_NOT_SAVED;
+    }
+    MarkResult result = presenceMark(rollNum, event, timestamp, submit);
+    if (result == MARK_SAVED) {
+        metricsCount(COUNTER_EVENTS);
+        LOG_PRINTF("Attendance Marked: %d %s\r\n", rollNum, kind);
+    } else if (result == MARK_DUPLICATE) {
+        metricsCount(COUNTER_DUPLICATES);
+        LOG_PRINTF("− duplicate %s for %d rejected\r\n", kind, rollNum);
+    } else {
+        metricsCount(COUNTER_FAILED_APPENDS);
+        LOG_PRINTF("− %s, %s for %d not recorded\r\n", rollNum < PRESENCE_CAPACITY ? "storage queue full" : "roll number out of range", kind, rollNum);
+    }
+    return result;
+}
+
+// Marks the attendance with an "Arrival" event
+MarkResult Esp32Store::markAttendance(uint16_t rollNum, uint32_t timestamp) {
+    return mark(rollNum, EVENT_ARRIVAL, timestamp, storageSubmit);
+}
+
+// Marks the departure with a "Departure" event
+MarkResult Esp32Store::markDeparture(uint16_t rollNum, uint32_t timestamp) {
+    return mark(rollNum, EVENT_DEPARTURE, timestamp, storageSubmit);
+}
+
+// Marks every arrival of a rush batch, then has the storage task write them as one journal batch
+void Esp32Store::markArrivals(BatchEntry *entries, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++)
+        entries[i].result = mark(entries[i].rollNum, EVENT_ARRIVAL, entries[i].timestamp, storageSubmitGrouped);
+    storageCommitGroup();
+}
+
+// Only answers once presence has been rebuilt; until then the batch finds duplicates when it is marked
+bool Esp32Store::checkedIn(uint16_t rollNum) {
+    return bootWait(BOOT_PRESENCE, 0) && presenceIsIn(rollNum);
+}
+
+bool Esp32Network::begin() {
+    LOG_PRINT("Setting AP (Access Point)…");
+    if (!WiFi.softAP(ssid, password))
+        return false;
+    LOG_PRINT("AP IP address: ");
+    LOG_PRINTLN(WiFi.softAPIP());
+    return true;
+}
+
+void Esp32Network::address(char *buf, size_t len) {
+    IPAddress ip = WiFi.softAPIP();
+    TextWriter text(buf, len);
+    text.num(ip[0]).put('.').num(ip[1]).put('.').num(ip[2]).put('.').num(ip[3]);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "hal.h"
+#include "keypad_task.h"
+#include "lcd_frame.h"
+
+//----------------------------------------ESP32 HARDWARE---------------------------------------
+// Keys queued by the interrupt-driven keypad task in keypad_task.h
+class Esp32Keypad : public KeypadInput {
+  public:
+    char getKey() override { return keypadRead(); }
+    void waitForKey(unsigned long timeoutMs) override { keypadWait(timeoutMs); }
+};
+
+// The shadow framebuffer already is the display; this only adapts it to the Display interface
+class Esp32Display : public Display {
+  public:
+    Esp32Display(LcdFrame &frame) : frame(frame) {}
+    void clear() override { frame.clear(); }
+    void setCursor(uint8_t col, uint8_t row) override { frame.setCursor(col, row); }
+    void flush() override { frame.flush(); }
+    size_t write(uint8_t ch) override { return frame.write(ch); }
+    using Print::write;
+
+  private:
+    LcdFrame &frame;
+};
+
+// DS3231 through the cached clock service in rtc.h
+class Esp32Clock : public Clock {
+  public:
+    uint32_t now() override;
+    unsigned long ticks() override { return millis(); }
+};
+
+// Presence check (presence.h), then the journal, written by the storage task in storage.h
+class Esp32Store : public AttendanceStore {
+  public:
+    MarkResult markAttendance(uint16_t rollNum, uint32_t timestamp) override;
+    MarkResult markDeparture(uint16_t rollNum, uint32_t timestamp) override;
+    void markArrivals(BatchEntry *entries, uint8_t count) override;
+    bool checkedIn(uint16_t rollNum) override;
+};
+
+// Soft access point the web server is reached through
+class Esp32Network : public Network {
+  public:
+    Esp32Network(const char *ssid, const char *password) : ssid(ssid), password(password) {}
+    bool begin() override;
+    void address(char *buf, size_t len) override;
+
+  private:
+    const char *ssid;
+    const char *password;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "epoch.h"
+#include "hal.h"
+#include <deque>
+
+//----------------------------------------SIMULATED HARDWARE---------------------------------------
+// Host implementations of hal.h for the native env (test/) and the tools, header only so the
+// firmware never builds them. Time is virtual and only moves when the caller moves it, keys come
+// from a script and the display keeps the glass as two lines of text.
+
+class SimClock : public Clock {
+  public:
+    unsigned long ms = 0;
+    uint32_t start = toEpoch(2024, 9, 2, 8, 0, 0);        // what now() says at ms 0
+    uint32_t now() override { return start + ms / 1000; }
+    unsigned long ticks() override { return ms; }
+};
+
+class SimKeypad : public KeypadInput {
+  public:
+    std::deque<char> keys;
+    char getKey() override {
+        if (keys.empty())
+            return NO_KEY;
+        char key = keys.front();
+        keys.pop_front();
+        return key;
+    }
+};
+
+class SimDisplay : public Display {
+  public:
+    char rows[2][17];
+    uint8_t col = 0, row = 0;
+    uint32_t flushes = 0;
+    SimDisplay() { clear(); }
+    void clear() override {
+        for (auto &r : rows) {
+            memset(r, ' ', sizeof(r) - 1);
+            r[sizeof(r) - 1] = '\0';
+        }
+        col = row = 0;
+    }
+    void setCursor(uint8_t c, uint8_t r) override {
+        col = c;
+        row = r;
+    }
+    void flush() override { flushes++; }
+    size_t write(uint8_t c) override {
+        if (row < 2 && col < sizeof(rows[0]) - 1)
+            rows[row][col] = c;
+        col++;
+        return 1;
+    }
+    using Print::write;
+    bool shows(const char *text) const { return strstr(rows[0], text) || strstr(rows[1], text); }
+};
+
+class SimNetwork : public Network {
+  public:
+    bool begin() override { return true; }
+    void address(char *buf, size_t len) override { snprintf(buf, len, "192.168.4.1"); }
+};
@@ -0,0 +1,773 @@
+#include "journal.h"
+#include "epoch.h"
+#include "fmt.h"
+#include "live.h"
+#include "metrics.h"
+#include <atomic>
+
+#define NO_SEGMENT SIZE_MAX
+
+static uint32_t nextSeq = 0;
+static AttendanceRecord pending[JOURNAL_MAX_BATCH + 1];        // + 1 leaves room for the commit marker
+static uint8_t pendingCount = 0;
+static uint32_t pendingDay = 0;                                 // segment the pending batch belongs to
+static unsigned long lastAppend = 0;
+static size_t lastIndex = NO_SEGMENT;                           // manifest index of the newest segment
+static SegmentInfo lastInfo;                                    // and a copy of its entry
+static SemaphoreHandle_t journalMutex = nullptr;
+static RingLog *journalRing = nullptr;                          // set when records go to a ring log, not segments
+static uint32_t ringBegin = UINT32_MAX;                         // the ring's begin() when oldestSeq was last found
+static std::atomic<int> readers{ 0 };
+static std::atomic<uint32_t> oldestSeq{ 0 };                    // snapshot state, read by the web server task
+static std::atomic<uint64_t> committed{ 0 };                   // end seq in the high word, its last timestamp in the low
+static uint32_t committedTime = 0;                              // the storage task's copy of the low word
+
+// CRC-32 (IEEE 802.3, reflected) using a 16 entry nibble table to keep the flash footprint small
+uint32_t crc32(const uint8_t *data, size_t len, uint32_t crc) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    crc = ~crc;
+    while (len--) {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ table[crc & 0x0f];
+        crc = (crc >> 4) ^ table[crc & 0x0f];
+    }
+    return ~crc;
+}
+
+// Checks the stored CRC of a record against its contents
+bool recordValid(const AttendanceRecord &rec) {
+    return rec.crc == crc32((const uint8_t *)&rec, offsetof(AttendanceRecord, crc));
+}
+
+// Renders a record as one CSV line in the same "d/m/y,h:m:s,roll,name,Arrival" layout the old firmware wrote
+size_t formatRecordCsv(const AttendanceRecord &rec, const char *name, char *buf, size_t len) {
+    DateTime dt;
+    fromEpoch(rec.timestamp, dt);
+    TextWriter text(buf, len);
+    text.num(dt.date).put('/').num(dt.month).put('/').num(dt.year % 100).put(',');
+    text.num(dt.hours).put(':').num(dt.minutes).put(':').num(dt.seconds).put(',');
+    text.num(rec.rollNum).put(',').put(name).put(',').put(rec.event == EVENT_ARRIVAL ? "Arrival\n" : "Departure\n");
+    return text.length();
+}
+
+// Seals a record by filling in its CRC
+static void sealRecord(AttendanceRecord &rec) {
+    rec.crc = crc32((const uint8_t *)&rec, offsetof(AttendanceRecord, crc));
+}
+
+// Builds a batch marker record
+static AttendanceRecord makeMarker(uint8_t event, uint16_t count, uint32_t seq, uint32_t timestamp) {
+    AttendanceRecord rec;
+    rec.timestamp = timestamp;
+    rec.rollNum = count;
+    rec.event = event;
+    rec.flags = 0;
+    rec.seq = seq;
+    sealRecord(rec);
+    return rec;
+}
+
+//----------------------------------------SEGMENTS AND MANIFEST---------------------------------------
+// Builds a segment's file name from its day, e.g. "/log/20230512.bin", or ".arc" once archived
+void segmentPath(uint32_t day, uint8_t state, char *buf, size_t len) {
+    DateTime dt;
+    fromEpoch(day * 86400UL, dt);
+    TextWriter path(buf, len);
+    path.put(LOG_DIR "/").num(dt.year, 4).num(dt.month, 2).num(dt.date, 2).put(state == SEGMENT_ARCHIVED ? ".arc" : ".bin");
+}
+
+void journalLock() {
+    if (journalMutex)
+        xSemaphoreTake(journalMutex, portMAX_DELAY);
+}
+
+void journalUnlock() {
+    if (journalMutex)
+        xSemaphoreGive(journalMutex);
+}
+
+size_t manifestCount(fs::FS &fs) {
+    File file = fs.open(MANIFEST_PATH, FILE_READ);
+    if (!file)
+        return 0;
+    size_t count = file.size() / sizeof(SegmentInfo);
+    file.close();
+    return count;
+}
+
+bool manifestRead(fs::FS &fs, size_t index, SegmentInfo &info) {
+    File file = fs.open(MANIFEST_PATH, FILE_READ);
+    if (!file)
+        return false;
+    bool ok = file.seek(index * sizeof(SegmentInfo)) && file.read((uint8_t *)&info, sizeof(info)) == sizeof(info);
+    file.close();
+    return ok;
+}
+
+// Rewrites one entry in place
+bool manifestWrite(fs::FS &fs, size_t index, const SegmentInfo &info) {
+    File file = fs.open(MANIFEST_PATH, "r+");
+    if (!file)
+        return false;
+    bool ok = file.seek(index * sizeof(SegmentInfo)) && file.write((const uint8_t *)&info, sizeof(info)) == sizeof(info);
+    file.close();
+    return ok;
+}
+
+static bool manifestAppend(fs::FS &fs, const SegmentInfo &info) {
+    File file = fs.open(MANIFEST_PATH, FILE_APPEND);
+    if (!file)
+        return false;
+    bool ok = file.write((const uint8_t *)&info, sizeof(info)) == sizeof(info);
+    file.close();
+    return ok;
+}
+
+// Removes the oldest entries by writing the rest to a new manifest and swapping it in
+bool manifestDropFront(fs::FS &fs, size_t count) {
+    File src = fs.open(MANIFEST_PATH, FILE_READ);
+    File dst = fs.open(MANIFEST_TMP_PATH, FILE_WRITE);
+    if (!src || !dst)
+        return false;
+    SegmentInfo info;
+    bool ok = src.seek(count * sizeof(SegmentInfo));
+    while (ok && src.read((uint8_t *)&info, sizeof(info)) == sizeof(info))
+        ok = dst.write((const uint8_t *)&info, sizeof(info)) == sizeof(info);
+    src.close();
+    dst.close();
+    if (!ok) {
+        fs.remove(MANIFEST_TMP_PATH);
+        return false;
+    }
+    fs.remove(MANIFEST_PATH);
+    ok = fs.rename(MANIFEST_TMP_PATH, MANIFEST_PATH);
+    if (ok && lastIndex != NO_SEGMENT)
+        lastIndex -= count;
+    if (ok && manifestRead(fs, 0, info))
+        oldestSeq = info.firstSeq;
+    return ok;
+}
+
+// Binary searches for the first segment whose day is not before the given one; returns the
+// entry count if there is none
+size_t manifestFindDay(fs::FS &fs, uint32_t day) {
+    File file = fs.open(MANIFEST_PATH, FILE_READ);
+    if (!file)
+        return 0;
+    size_t lo = 0, hi = file.size() / sizeof(SegmentInfo);
+    SegmentInfo info;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        file.seek(mid * sizeof(SegmentInfo));
+        if (file.read((uint8_t *)&info, sizeof(info)) != sizeof(info))
+            break;
+        if (info.day < day)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    file.close();
+    return lo;
+}
+
+// Binary searches for the last segment whose first sequence number is not after the given one
+size_t manifestFindSeq(fs::FS &fs, uint32_t seq) {
+    File file = fs.open(MANIFEST_PATH, FILE_READ);
+    if (!file)
+        return 0;
+    size_t lo = 0, hi = file.size() / sizeof(SegmentInfo);
+    SegmentInfo info;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        file.seek(mid * sizeof(SegmentInfo));
+        if (file.read((uint8_t *)&info, sizeof(info)) != sizeof(info))
+            break;
+        if (info.firstSeq <= seq)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    file.close();
+    return lo > 0 ? lo - 1 : 0;
+}
+
+bool journalReadersActive() {
+    return readers.load() > 0;
+}
+
+// Returns the size of a segment file
+static uint32_t segmentBytes(fs::FS &fs, const SegmentInfo &info) {
+    char path[32];
+    segmentPath(info.day, info.state, path, sizeof(path));
+    File file = fs.open(path, FILE_READ);
+    if (!file)
+        return 0;
+    uint32_t bytes = file.size();
+    file.close();
+    return bytes;
+}
+
+// Marks the newest segment as finished so the archiver may compact it
+static bool sealActive(fs::FS &fs) {
+    if (lastIndex == NO_SEGMENT || lastInfo.state != SEGMENT_ACTIVE)
+        return true;
+    SegmentInfo sealed = lastInfo;
+    sealed.state = SEGMENT_SEALED;
+    sealed.bytes = segmentBytes(fs, sealed);
+    journalLock();
+    bool ok = manifestWrite(fs, lastIndex, sealed);
+    journalUnlock();
+    if (ok)
+        lastInfo = sealed;
+    return ok;
+}
+
+// Makes the segment for the given day the one batches are appended to, sealing the previous one
+static bool openSegment(fs::FS &fs, uint32_t day, uint32_t firstSeq) {
+    SegmentInfo info = { day, firstSeq, 0, SEGMENT_ACTIVE, { 0, 0, 0 } };
+    bool ok;
+    if (lastIndex != NO_SEGMENT && lastInfo.day == day) {
+        // Sealed a moment too early (the clock was set back); the newest segment is never archived
+        info = lastInfo;
+        info.state = SEGMENT_ACTIVE;
+        info.bytes = 0;
+        journalLock();
+        ok = manifestWrite(fs, lastIndex, info);
+        journalUnlock();
+    } else {
+        if (!sealActive(fs))
+            return false;
+        journalLock();
+        ok = manifestAppend(fs, info);
+        if (ok)
+            lastIndex = manifestCount(fs) - 1;        // under the lock, the archiver may have dropped entries
+        if (ok && lastIndex == 0)
+            oldestSeq = firstSeq;
+        journalUnlock();
+    }
+    if (ok)
+        lastInfo = info;
+    return ok;
+}
+
+//----------------------------------------RING LOG---------------------------------------
+// The same repair as repairTail() for the ring log, whose slots cannot hold a partial record
+static void repairRing() {
+    uint32_t pos = journalRing->end();
+    uint32_t scanned = 0;
+    uint16_t torn = 0;
+    bool markerFound = false;
+    AttendanceRecord rec;
+    while (pos > journalRing->begin() && scanned <= JOURNAL_MAX_BATCH) {
+        pos--;
+        scanned++;
+        uint32_t at = pos;
+        if (journalRing->read(at, &rec, 1) != 1 || !recordValid(rec))
+            continue;
+        if (rec.seq >= nextSeq)
+            nextSeq = rec.seq + 1;
+        if (rec.event == EVENT_COMMIT || rec.event == EVENT_ROLLBACK) {
+            if (rec.event == EVENT_COMMIT)
+                committedTime = rec.timestamp;
+            markerFound = true;
+            break;
+        }
+        torn++;
+    }
+    if (torn > 0 && (markerFound || pos == journalRing->begin())) {
+        rec = makeMarker(EVENT_ROLLBACK, torn, nextSeq - 1, 0);
+        journalRing->append(&rec, 1);
+    }
+}
+
+// Keeps the snapshot's first sequence number in step as the ring recycles its oldest sector
+static void ringOldest() {
+    uint32_t pos = journalRing->begin();
+    if (pos == ringBegin)
+        return;
+    ringBegin = pos;
+    AttendanceRecord rec;
+    for (uint32_t n = 0; n < journalRing->slotsPerSector() && journalRing->read(pos, &rec, 1) == 1; n++) {
+        if (recordValid(rec)) {
+            oldestSeq = rec.seq;
+            return;
+        }
+    }
+}
+
+// Binary searches the ring's sectors for the last one whose first record comes before a sequence
+// number (bySeq) or a day, and returns its position; readers start there
+static uint32_t ringSeek(uint32_t key, bool bySeq) {
+    uint32_t slots = journalRing->slotsPerSector();
+    uint32_t lo = journalRing->begin() / slots;
+    uint32_t hi = (journalRing->end() + slots - 1) / slots;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint32_t pos = mid * slots;
+        AttendanceRecord rec;
+        bool before = false;        // a sector that starts with no readable record is read, not skipped
+        for (uint8_t n = 0; n < 4 && journalRing->read(pos, &rec, 1) == 1; n++) {
+            if (recordValid(rec)) {
+                before = bySeq ? rec.seq <= key : dayOf(rec.timestamp) < key;
+                break;
+            }
+        }
+        if (before)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo * slots;
+}
+
+//----------------------------------------RECOVERY---------------------------------------
+// Finds the sequence number to continue from and repairs the tail of the newest segment after a
+// power cut: a partial record is padded out so it fails its CRC, and records of a batch that never
+// got its commit marker are voided with a rollback marker.
+static void repairTail(fs::FS &fs, const char *path) {
+    File file = fs.open(path, FILE_READ);
+    if (!file)
+        return;
+
+    size_t size = file.size();
+    size_t count = size / sizeof(AttendanceRecord);
+    size_t scanned = 0;
+    uint16_t torn = 0;
+    bool markerFound = false;
+    AttendanceRecord rec;
+    while (count > 0 && scanned <= JOURNAL_MAX_BATCH) {
+        count--;
+        scanned++;
+        file.seek(count * sizeof(AttendanceRecord));
+        if (file.read((uint8_t *)&rec, sizeof(rec)) != sizeof(rec) || !recordValid(rec))
+            continue;
+        if (rec.seq >= nextSeq)
+            nextSeq = rec.seq + 1;
+        if (rec.event == EVENT_COMMIT || rec.event == EVENT_ROLLBACK) {
+            if (rec.event == EVENT_COMMIT)
+                committedTime = rec.timestamp;
+            markerFound = true;
+            break;
+        }
+        torn++;
+    }
+    file.close();
+
+    size_t partial = size % sizeof(AttendanceRecord);
+    // A segment without any marker in reach holds nothing but one torn batch
+    bool rollback = torn > 0 && (markerFound || count == 0);
+    if (!partial && !rollback)
+        return;
+
+    file = fs.open(path, FILE_APPEND);
+    if (!file)
+        return;
+    if (partial) {
+        uint8_t pad[sizeof(AttendanceRecord)];
+        memset(pad, 0xff, sizeof(pad));
+        file.write(pad, sizeof(pad) - partial);
+    }
+    if (rollback) {
+        rec = makeMarker(EVENT_ROLLBACK, torn, nextSeq - 1, 0);
+        file.write((const uint8_t *)&rec, sizeof(rec));
+    }
+    file.close();
+}
+
+// Queues one record with a given sequence number
+static bool appendRecord(fs::FS &fs, uint32_t timestamp, uint16_t rollNum, uint8_t event, uint32_t seq, bool grouped = false) {
+    // Segments only go forward: if the clock was set back, records stay in the newest segment
+    uint32_t day = dayOf(timestamp);
+    if (lastIndex != NO_SEGMENT && lastInfo.day > day)
+        day = lastInfo.day;
+    if (pendingCount > 0 && pendingDay > day)
+        day = pendingDay;
+    if (pendingCount > 0 && (day != pendingDay || pendingCount == JOURNAL_MAX_BATCH) && !journalFlush(fs))
+        return false;
+    if (pendingCount == 0)
+        pendingDay = day;
+
+    uint32_t started = micros();
+    AttendanceRecord &rec = pending[pendingCount++];
+    rec.timestamp = timestamp;
+    rec.rollNum = rollNum;
+    rec.event = event;
+    rec.flags = 0;
+    rec.seq = seq;
+    sealRecord(rec);
+    metricsObserve(STAGE_RECORD_FORMAT, micros() - started);
+    nextSeq = seq + 1;
+    lastAppend = millis();
+
+    if (pendingCount >= JOURNAL_FLUSH_THRESHOLD && !grouped)
+        journalFlush(fs);
+    return true;
+}
+
+// Splits the single journal file of earlier firmware into day segments, keeping sequence numbers
+static void migrateLegacyJournal(fs::FS &fs) {
+    if (!fs.exists(LEGACY_JOURNAL_PATH))
+        return;
+    JournalScanner legacy(fs, LEGACY_JOURNAL_PATH);
+    AttendanceRecord rec;
+    bool ok = true;
+    while (ok && legacy.next(rec)) {
+        if (rec.seq >= nextSeq)
+            ok = appendRecord(fs, rec.timestamp, rec.rollNum, rec.event, rec.seq);
+    }
+    if (ok && journalFlush(fs)) {
+        fs.remove(LEGACY_JOURNAL_PATH);
+        fs.remove(LEGACY_INDEX_PATH);
+    }
+}
+
+// Makes endSeq the end of the committed journal for snapshots, together with committedTime: one
+// store, so the web server task never pairs a new timestamp with an old end (Last-Modified and ETag)
+static void publishCommitted(uint32_t endSeq) {
+    committed.store((uint64_t)endSeq << 32 | committedTime, std::memory_order_release);
+}
+
+// Recovers the journal state after boot; call once the file system is mounted. With a ring log the
+// records go there, otherwise into day segments on fs.
+void journalBegin(fs::FS &fs, RingLog *ring) {
+    if (journalMutex == nullptr)
+        journalMutex = xSemaphoreCreateMutex();
+    nextSeq = 0;
+    pendingCount = 0;
+    lastIndex = NO_SEGMENT;
+    oldestSeq = 0;
+    committedTime = 0;
+    journalRing = ring;
+    ringBegin = UINT32_MAX;
+
+    if (journalRing) {
+        repairRing();
+        ringOldest();
+        migrateLegacyJournal(fs);
+        publishCommitted(pendingCount > 0 ? pending[0].seq : nextSeq);
+        return;
+    }
+
+    fs.mkdir(LOG_DIR);
+    // A power cut between the two steps of manifestDropFront() leaves only the new manifest
+    if (!fs.exists(MANIFEST_PATH) && fs.exists(MANIFEST_TMP_PATH))
+        fs.rename(MANIFEST_TMP_PATH, MANIFEST_PATH);
+
+    size_t count = manifestCount(fs);
+    if (count > 0 && manifestRead(fs, count - 1, lastInfo)) {
+        lastIndex = count - 1;
+        nextSeq = lastInfo.firstSeq;
+        char path[32];
+        segmentPath(lastInfo.day, lastInfo.state, path, sizeof(path));
+        if (lastInfo.state == SEGMENT_ARCHIVED) {
+            ArchiveReader archive;
+            AttendanceRecord rec;
+            archive.open(fs, path);
+            while (archive.next(rec)) {
+                nextSeq = rec.seq + 1;
+                committedTime = rec.timestamp;
+            }
+        } else {
+            repairTail(fs, path);
+        }
+    }
+    SegmentInfo first;
+    if (count > 0 && manifestRead(fs, 0, first))
+        oldestSeq = first.firstSeq;
+    migrateLegacyJournal(fs);
+    publishCommitted(pendingCount > 0 ? pending[0].seq : nextSeq);
+}
+
+//----------------------------------------APPENDING---------------------------------------
+// Queues one record for the next batch, flushing straight away once the threshold is reached
+// unless the record is part of a group.
+// Returns false only if the record could not be queued because flash writes keep failing.
+bool journalAppend(fs::FS &fs, uint32_t timestamp, uint16_t rollNum, uint8_t event, bool grouped) {
+    return appendRecord(fs, timestamp, rollNum, event, nextSeq, grouped);
+}
+
+// Writes all pending records followed by a commit marker with a single open and write
+bool journalFlush(fs::FS &fs) {
+    if (pendingCount == 0)
+        return true;
+    if (!journalRing && (lastIndex == NO_SEGMENT || lastInfo.day != pendingDay || lastInfo.state != SEGMENT_ACTIVE) &&
+        !openSegment(fs, pendingDay, pending[0].seq))
+        return false;
+
+    const AttendanceRecord &last = pending[pendingCount - 1];
+    pending[pendingCount] = makeMarker(EVENT_COMMIT, pendingCount, last.seq, last.timestamp);
+    size_t len = (pendingCount + 1) * sizeof(AttendanceRecord);
+
+    uint32_t started = micros();
+    bool ok;
+    if (journalRing) {
+        ok = journalRing->append(pending, pendingCount + 1);
+    } else {
+        char path[32];
+        segmentPath(pendingDay, SEGMENT_ACTIVE, path, sizeof(path));
+        File file = fs.open(path, FILE_APPEND);
+        if (!file)
+            return false;
+        ok = file.write((const uint8_t *)pending, len) == len;
+        file.close();
+    }
+    metricsObserve(STAGE_FLASH_APPEND, micros() - started);
+    if (ok) {
+        liveFeedPublish(pending, pendingCount);
+        pendingCount = 0;
+        committedTime = last.timestamp;
+        publishCommitted(last.seq + 1);        // a snapshot taken from now on may include the batch
+        if (journalRing)
+            ringOldest();
+    }
+    return ok;
+}
+
+// Flushes the pending batch once the keypad has been quiet for a while and seals the day's
+// segment once the clock has passed midnight, or erases the ring log's next sector ahead of time;
+// call this regularly from the storage task
+void journalService(fs::FS &fs, uint32_t now) {
+    if (pendingCount > 0 && millis() - lastAppend >= JOURNAL_IDLE_FLUSH_MS)
+        journalFlush(fs);
+    if (journalRing && pendingCount == 0)
+        journalRing->prepare();
+    if (lastIndex != NO_SEGMENT && lastInfo.state == SEGMENT_ACTIVE && dayOf(now) > lastInfo.day && pendingCount == 0)
+        sealActive(fs);
+}
+
+uint32_t journalNextSeq() {
+    return nextSeq;
+}
+
+uint8_t journalPending() {
+    return pendingCount;
+}
+
+JournalSnapshot journalSnapshot() {
+    JournalSnapshot snap;
+    uint64_t both = committed.load(std::memory_order_acquire);
+    snap.endSeq = both >> 32;
+    snap.firstSeq = oldestSeq;
+    snap.lastTimestamp = (uint32_t)both;
+    return snap;
+}
+
+//----------------------------------------JOURNAL SCANNER---------------------------------------
+JournalScanner::JournalScanner(fs::FS &fs, const char *path) {
+    open(fs, path);
+}
+
+bool JournalScanner::open(fs::FS &fs, const char *path) {
+    batchLen = batchPos = 0;
+    ring = nullptr;
+    file = fs.open(path, FILE_READ);
+    return (bool)file;
+}
+
+bool JournalScanner::open(RingLog &log, uint32_t pos) {
+    batchLen = batchPos = 0;
+    file.close();
+    ring = &log;
+    ringPos = pos;
+    return true;
+}
+
+bool JournalScanner::readRecord(AttendanceRecord &rec) {
+    if (ring)
+        return ring->read(ringPos, &rec, 1) == 1;
+    return file.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+}
+
+// Reads the next batch up to its marker. Rolled back batches are skipped and a batch still being
+// written at the end of the file is left alone.
+bool JournalScanner::fillBatch() {
+    batchLen = 0;
+    batchPos = 0;
+    if (!file && !ring)
+        return false;
+
+    uint8_t count = 0;
+    AttendanceRecord rec;
+    while (readRecord(rec)) {
+        if (!recordValid(rec))
+            continue;
+        if (rec.event == EVENT_COMMIT) {
+            if (count == 0)
+                continue;
+            batchLen = count;
+            return true;
+        }
+        if (rec.event == EVENT_ROLLBACK) {
+            count = 0;
+            continue;
+        }
+        batch[count++] = rec;
+        if (count > JOURNAL_MAX_BATCH) {
+            // No batch is ever this long, so these come from a journal written before batching
+            batchLen = count;
+            return true;
+        }
+    }
+    file.close();
+    ring = nullptr;
+    return false;
+}
+
+// Hands out the next committed record, returns false at the end of the committed journal
+bool JournalScanner::next(AttendanceRecord &rec) {
+    if (batchPos == batchLen && !fillBatch())
+        return false;
+    rec = batch[batchPos++];
+    return true;
+}
+
+//----------------------------------------SEGMENT READER---------------------------------------
+SegmentReader::SegmentReader(fs::FS &fs, uint32_t fromDay, uint32_t toDay) : fs(fs), nextDay(fromDay), toDay(toDay) {
+    readers++;
+}
+
+SegmentReader::~SegmentReader() {
+    readers--;
+}
+
+// Skips the segments that end before a sequence number; call before the first next()
+void SegmentReader::seekSeq(uint32_t seq) {
+    if (journalRing) {
+        ringStart = ringSeek(seq, true);
+        return;
+    }
+    SegmentInfo info;
+    journalLock();
+    if (manifestRead(fs, manifestFindSeq(fs, seq), info) && info.day > nextDay)
+        nextDay = info.day;
+    journalUnlock();
+}
+
+// Opens the first segment on or after nextDay. The manifest lookup and the open happen under the
+// journal lock so the archiver cannot swap the segment's form in between.
+bool SegmentReader::openNext() {
+    if (journalRing) {
+        // The whole ring is one pass, started no earlier than needed
+        if (ringOpened)
+            return false;
+        ringOpened = true;
+        archived = false;
+        return raw.open(*journalRing, ringStart != UINT32_MAX ? ringStart : ringSeek(nextDay, false));
+    }
+    for (;;) {
+        journalLock();
+        size_t index = manifestFindDay(fs, nextDay);
+        SegmentInfo info;
+        bool found = index < manifestCount(fs) && manifestRead(fs, index, info) && info.day <= toDay;
+        bool ok = false;
+        if (found) {
+            char path[32];
+            segmentPath(info.day, info.state, path, sizeof(path));
+            archived = info.state == SEGMENT_ARCHIVED;
+            ok = archived ? packed.open(fs, path) : raw.open(fs, path);
+            nextDay = info.day + 1;
+        }
+        journalUnlock();
+        if (!found)
+            return false;
+        if (ok)
+            return true;
+    }
+}
+
+bool SegmentReader::next(AttendanceRecord &rec) {
+    for (;;) {
+        if (opened && (archived ? packed.next(rec) : raw.next(rec))) {
+            // The ring is not split by day, so its records are filtered one by one
+            if (journalRing && (dayOf(rec.timestamp) < nextDay || dayOf(rec.timestamp) > toDay))
+                continue;
+            return true;
+        }
+        opened = openNext();
+        if (!opened)
+            return false;
+    }
+}
+
+//----------------------------------------CSV EXPORT---------------------------------------
+bool JournalQuery::matches(const AttendanceRecord &rec) const {
+    uint32_t day = dayOf(rec.timestamp);
+    return day >= fromDay && day <= toDay && (rollNum < 0 || rec.rollNum == rollNum);
+}
+
+size_t JournalStream::read(uint8_t *buffer, size_t maxLen) {
+    size_t written = 0;
+    while (written < maxLen) {
+        if (linePos == lineLen && !nextLine())
+            break;
+        size_t n = lineLen - linePos;
+        if (n > maxLen - written)
+            n = maxLen - written;
+        memcpy(buffer + written, line + linePos, n);
+        linePos += n;
+        written += n;
+    }
+    return written;
+}
+
+JournalCsvReader::JournalCsvReader(fs::FS &fs, NameLookup nameOf, const JournalQuery &query, uint32_t endSeq)
+    : journal(fs, query.fromDay, query.toDay), nameOf(nameOf), query(query), endSeq(endSeq) {
+    if (!query.filtered())
+        legacy = fs.open(LEGACY_CSV_PATH, FILE_READ);
+}
+
+// Loads the next matching journal record into the line buffer, returns false at the end of the journal
+bool JournalCsvReader::nextLine() {
+    // Sequence numbers only grow along the journal, so the first record past the snapshot ends it
+    AttendanceRecord rec;
+    do {
+        if (!journal.next(rec) || rec.seq >= endSeq)
+            return false;
+    } while (!query.matches(rec));
+    char name[64];
+    nameOf(rec.rollNum, name, sizeof(name));
+    lineLen = formatRecordCsv(rec, name, line, sizeof(line));
+    linePos = 0;
+    return true;
+}
+
+size_t JournalCsvReader::read(uint8_t *buffer, size_t maxLen) {
+    if (legacy) {
+        size_t written = legacy.read(buffer, maxLen);
+        if (written > 0)
+            return written;
+        legacy.close();
+    }
+    return JournalStream::read(buffer, maxLen);
+}
+
+//----------------------------------------EVENT FEED---------------------------------------
+JournalEventReader::JournalEventReader(fs::FS &fs, NameLookup nameOf, uint32_t since, uint32_t limit, bool binary, uint32_t endSeq)
+    : journal(fs), nameOf(nameOf), since(since), remaining(limit), binary(binary), endSeq(endSeq) {
+    journal.seekSeq(since);
+}
+
+// Loads the next record from since on into the line buffer, returns false once limit are out
+bool JournalEventReader::nextLine() {
+    AttendanceRecord rec;
+    do {
+        if (remaining == 0 || !journal.next(rec) || rec.seq >= endSeq)
+            return false;
+    } while (rec.seq < since);
+    remaining--;
+    linePos = 0;
+    if (binary) {
+        memcpy(line, &rec, sizeof(rec));
+        lineLen = sizeof(rec);
+        return true;
+    }
+    char name[64];
+    nameOf(rec.rollNum, name, sizeof(name));
+    TextWriter text(line, sizeof(line));
+    size_t n = text.num(rec.seq).put(',').length();
+    lineLen = n + formatRecordCsv(rec, name, line + n, sizeof(line) - n);
+    return true;
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "FS.h"
+#include "ring_log.h"
+#include <Arduino.h>
+
+//----------------------------------------ATTENDANCE JOURNAL---------------------------------------
+// Every check-in is stored as one fixed-size binary record. Records go into one segment file per
+// day under /log, listed in a small manifest. The day's segment is sealed at midnight and older
+// segments are later compacted into a denser archive form (archive.h). The CSV the web page hands
+// out is rendered from the segments only when /csv is requested.
+//
+// Given a ring log (storage_backend.h), the records go there instead, in the same batches, and
+// readers walk the ring; there are then no segments to seal, archive or drop.
+
+#define LOG_DIR "/log"
+#define MANIFEST_PATH "/log/manifest.bin"
+#define MANIFEST_TMP_PATH "/log/manifest.tmp"
+#define LEGACY_JOURNAL_PATH "/RTR_Attendance.bin"        // single journal of earlier firmware, split into segments at boot
+#define LEGACY_INDEX_PATH "/RTR_Attendance.idx"
+#define LEGACY_CSV_PATH "/RTR_Attendance.csv"            // written by older firmware, still served by /csv
+
+#define EVENT_ARRIVAL 0x01
+#define EVENT_DEPARTURE 0x02
+#define EVENT_COMMIT 0x80            // closes a batch; rollNum holds the number of records in it
+#define EVENT_ROLLBACK 0x81          // written at boot after a torn batch; voids the records since the last commit
+
+// Records are buffered in RAM and written as one batch once JOURNAL_FLUSH_THRESHOLD are pending or
+// the keypad has been idle for JOURNAL_IDLE_FLUSH_MS. A power cut loses at most the pending window.
+// Records appended as grouped (a rush batch, see storage.h) do not trigger the threshold flush, so
+// the group goes to flash in the same batch once it is flushed.
+#define JOURNAL_MAX_BATCH 32
+#define JOURNAL_FLUSH_THRESHOLD 8
+#define JOURNAL_IDLE_FLUSH_MS 3000
+
+#define SEGMENT_ACTIVE 0             // today's segment, still being appended to
+#define SEGMENT_SEALED 1             // a finished day in the raw record format
+#define SEGMENT_ARCHIVED 2           // a finished day compacted into the archive format
+
+struct __attribute__((packed)) AttendanceRecord {
+    uint32_t timestamp;        // seconds since 1970-01-01, RTC local time
+    uint16_t rollNum;
+    uint8_t event;             // EVENT_ARRIVAL, EVENT_DEPARTURE or one of the batch markers
+    uint8_t flags;             // reserved, 0
+    uint32_t seq;              // increases by one for every record ever written
+    uint32_t crc;              // CRC-32 of all the fields above
+};
+
+static_assert(sizeof(AttendanceRecord) == 16, "AttendanceRecord must stay 16 bytes");
+
+// One manifest entry per segment, in day order
+struct __attribute__((packed)) SegmentInfo {
+    uint32_t day;              // days since 1970-01-01
+    uint32_t firstSeq;         // sequence number of the first record in the segment
+    uint32_t bytes;            // size on flash once sealed or archived, 0 while active
+    uint8_t state;             // SEGMENT_ACTIVE, SEGMENT_SEALED or SEGMENT_ARCHIVED
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(SegmentInfo) == 16, "SegmentInfo must stay 16 bytes");
+
+// Filter for exports; the defaults match every record
+struct JournalQuery {
+    uint32_t fromDay = 0;             // inclusive
+    uint32_t toDay = UINT32_MAX;      // inclusive
+    int32_t rollNum = -1;             // -1 matches every roll number
+
+    bool filtered() const { return fromDay != 0 || toDay != UINT32_MAX || rollNum >= 0; }
+    bool matches(const AttendanceRecord &rec) const;
+};
+
+typedef bool (*NameLookup)(uint16_t rollNum, char *name, size_t len);
+
+// What a download covers: every record committed to flash at the moment it starts. Kept in RAM so
+// answering a client's cache check reads no flash, and so downloads never wait on the writer.
+struct JournalSnapshot {
+    uint32_t firstSeq;             // first record of the oldest segment still kept
+    uint32_t endSeq;               // one past the last committed record
+    uint32_t lastTimestamp;        // of the last committed record, 0 if not known yet
+};
+
+uint32_t crc32(const uint8_t *data, size_t len, uint32_t crc = 0);
+bool recordValid(const AttendanceRecord &rec);
+size_t formatRecordCsv(const AttendanceRecord &rec, const char *name, char *buf, size_t len);
+inline uint32_t dayOf(uint32_t timestamp) { return timestamp / 86400UL; }
+
+void journalBegin(fs::FS &fs, RingLog *ring = nullptr);
+bool journalAppend(fs::FS &fs, uint32_t timestamp, uint16_t rollNum, uint8_t event, bool grouped = false);
+bool journalFlush(fs::FS &fs);
+void journalService(fs::FS &fs, uint32_t now);
+uint32_t journalNextSeq();
+uint8_t journalPending();
+JournalSnapshot journalSnapshot();
+
+// Segments and manifest, shared with the archiver. Manifest changes are made under journalLock().
+void segmentPath(uint32_t day, uint8_t state, char *buf, size_t len);
+void journalLock();
+void journalUnlock();
+size_t manifestCount(fs::FS &fs);
+bool manifestRead(fs::FS &fs, size_t index, SegmentInfo &info);
+bool manifestWrite(fs::FS &fs, size_t index, const SegmentInfo &info);
+bool manifestDropFront(fs::FS &fs, size_t count);
+size_t manifestFindDay(fs::FS &fs, uint32_t day);
+size_t manifestFindSeq(fs::FS &fs, uint32_t seq);
+bool journalReadersActive();
+
+// Walks one raw segment, or the ring log from a position on, and hands out only records whose
+// batch was committed
+class JournalScanner {
+  public:
+    JournalScanner() {}
+    JournalScanner(fs::FS &fs, const char *path);
+    bool open(fs::FS &fs, const char *path);
+    bool open(RingLog &log, uint32_t pos);
+    bool next(AttendanceRecord &rec);
+
+  private:
+    bool readRecord(AttendanceRecord &rec);
+    bool fillBatch();
+
+    fs::File file;
+    RingLog *ring = nullptr;
+    uint32_t ringPos = 0;
+    AttendanceRecord batch[JOURNAL_MAX_BATCH + 1];
+    uint8_t batchLen = 0;
+    uint8_t batchPos = 0;
+};
+
+// Streams records of an archived segment (archive.h)
+class ArchiveReader {
+  public:
+    bool open(fs::FS &fs, const char *path);
+    bool next(AttendanceRecord &rec);
+
+  private:
+    bool readVarint(uint32_t &value);
+
+    fs::File file;
+    uint8_t buf[64];
+    uint8_t bufLen = 0;
+    uint8_t bufPos = 0;
+    uint32_t remaining = 0;        // records left
+    uint32_t seq = 0;
+    uint32_t timestamp = 0;
+};
+
+// Walks the committed records of every segment in a day range, whatever form each segment is in
+class SegmentReader {
+  public:
+    SegmentReader(fs::FS &fs, uint32_t fromDay = 0, uint32_t toDay = UINT32_MAX);
+    ~SegmentReader();
+    void seekSeq(uint32_t seq);
+    bool next(AttendanceRecord &rec);
+
+  private:
+    bool openNext();
+
+    fs::FS &fs;
+    uint32_t nextDay;                  // with a ring log, the first day wanted
+    uint32_t toDay;
+    uint32_t ringStart = UINT32_MAX;   // where seekSeq() found the ring log should be read from
+    bool ringOpened = false;           // the ring is read in one pass
+    bool archived = false;
+    bool opened = false;
+    JournalScanner raw;
+    ArchiveReader packed;
+};
+
+// Renders records one line at a time and hands the text out a buffer at a time. Meant to back an
+// AsyncWebServer chunked response.
+class JournalStream {
+  public:
+    virtual ~JournalStream() {}
+    virtual size_t read(uint8_t *buffer, size_t maxLen);
+
+  protected:
+    virtual bool nextLine() = 0;        // fills line, returns false at the end
+
+    char line[112];
+    size_t lineLen = 0;
+    size_t linePos = 0;
+};
+
+// Streams the legacy CSV (if any) followed by the journal rendered as CSV. A filtered query opens
+// only the segments of the days it asks for and leaves out the legacy CSV, which has no dates to
+// seek by. Records from endSeq on (committed after the snapshot was taken) are left out.
+class JournalCsvReader : public JournalStream {
+  public:
+    JournalCsvReader(fs::FS &fs, NameLookup nameOf, const JournalQuery &query = JournalQuery(), uint32_t endSeq = UINT32_MAX);
+    size_t read(uint8_t *buffer, size_t maxLen) override;
+
+  private:
+    bool nextLine() override;
+
+    fs::File legacy;
+    SegmentReader journal;
+    NameLookup nameOf;
+    JournalQuery query;
+    uint32_t endSeq;
+};
+
+// Streams up to limit committed records from sequence number since on, for collectors that keep a
+// cursor. Each record is either a CSV line led by its sequence number or the raw 16 byte record,
+// CRC included. Records still buffered in RAM show up once their batch is flushed; records from
+// endSeq on are left out.
+#define EVENTS_DEFAULT_LIMIT 500
+#define EVENTS_MAX_LIMIT 5000
+
+class JournalEventReader : public JournalStream {
+  public:
+    JournalEventReader(fs::FS &fs, NameLookup nameOf, uint32_t since, uint32_t limit, bool binary, uint32_t endSeq = UINT32_MAX);
+
+  private:
+    bool nextLine() override;
+
+    SegmentReader journal;
+    NameLookup nameOf;
+    uint32_t since;
+    uint32_t remaining;
+    bool binary;
+    uint32_t endSeq;
+};
@@ -0,0 +1,35 @@
+#include "key_matrix.h"
+
+bool KeyDebouncer::ghosted(uint16_t raw) {
+    for (uint8_t a = 0; a < KEY_ROWS; a++) {
+        for (uint8_t b = a + 1; b < KEY_ROWS; b++) {
+            uint8_t shared = (raw >> (a * KEY_COLS)) & (raw >> (b * KEY_COLS)) & ((1 << KEY_COLS) - 1);
+            if (shared & (shared - 1))
+                return true;
+        }
+    }
+    return false;
+}
+
+// Each key keeps the time its raw reading last changed and takes on that reading once it has
+// held for KEY_DEBOUNCE_MS, so keys pressed together or overlapping (rollover) are tracked
+// independently
+uint16_t KeyDebouncer::update(uint16_t raw, unsigned long ms) {
+    if (ghosted(raw))
+        raw = last;        // wait for a scan that can be trusted
+    uint16_t changed = raw ^ last;
+    last = raw;
+
+    uint16_t pressed = 0;
+    for (uint8_t k = 0; k < KEY_ROWS * KEY_COLS; k++) {
+        uint16_t bit = 1 << k;
+        if (changed & bit) {
+            changedAt[k] = ms;
+        } else if ((raw ^ stable) & bit && ms - changedAt[k] >= KEY_DEBOUNCE_MS) {
+            stable ^= bit;
+            if (raw & bit)
+                pressed |= bit;
+        }
+    }
+    return pressed;
+}
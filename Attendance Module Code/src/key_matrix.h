@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+//----------------------------------------KEY MATRIX---------------------------------------
+// Debouncing and ghost rejection for the 4x4 keypad, fed one raw scan at a time. Bit r * 4 + c
+// of a scan is set while the key on row r, column c reads as closed. Only depends on <stdint.h>,
+// so it builds the same on the ESP32 and on a desktop.
+
+#define KEY_ROWS 4
+#define KEY_COLS 4
+#define KEY_DEBOUNCE_MS 20        // a key has to read the same for this long before it counts
+
+class KeyDebouncer {
+  public:
+    // Takes one scan made at ms; returns the keys that have just settled as pressed
+    uint16_t update(uint16_t raw, unsigned long ms);
+    uint16_t held() const { return stable; }
+    bool settled() const { return stable == 0 && last == 0; }        // nothing held, nothing bouncing
+
+    // The matrix has no diodes, so three closed keys on the corners of a rectangle also close the
+    // fourth. Any two rows sharing two columns make a scan ambiguous.
+    static bool ghosted(uint16_t raw);
+
+  private:
+    uint16_t stable = 0;        // debounced state
+    uint16_t last = 0;          // previous raw scan
+    unsigned long changedAt[KEY_ROWS * KEY_COLS] = {};
+};
@@ -0,0 +1,135 @@
+#include "keypad_task.h"
+#include "hal.h"
+#include "metrics.h"
+#include "spsc_queue.h"
+#include "driver/gpio.h"
+#include "hal/gpio_ll.h"
+#if KEYPAD_LIGHT_SLEEP && CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#endif
+
+static SpscQueue<char, KEYPAD_QUEUE_SIZE> keyQueue;
+static char keymap[KEY_ROWS * KEY_COLS];
+static uint8_t rows[KEY_ROWS];
+static uint8_t cols[KEY_COLS];
+static TaskHandle_t keypadTaskHandle = nullptr;
+static TaskHandle_t consumerTaskHandle = nullptr;        // whoever last waited in keypadWait()
+
+// Runs on the first row to go low; masks every row so the scan that follows does not retrigger it
+static void IRAM_ATTR rowInterrupt() {
+    for (uint8_t r = 0; r < KEY_ROWS; r++)
+        gpio_ll_intr_disable(&GPIO, (gpio_num_t)rows[r]);
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(keypadTaskHandle, &woken);
+    if (woken)
+        portYIELD_FROM_ISR();
+}
+
+// Drives every column low so any press pulls its row down, then unmasks the rows
+static void armRows() {
+    for (uint8_t c = 0; c < KEY_COLS; c++) {
+        pinMode(cols[c], OUTPUT);
+        digitalWrite(cols[c], LOW);
+    }
+    delayMicroseconds(KEYPAD_SETTLE_US);
+    for (uint8_t r = 0; r < KEY_ROWS; r++)
+        gpio_intr_enable((gpio_num_t)rows[r]);
+}
+
+// Drives one column low at a time, the others left floating, and reads which rows follow it
+static uint16_t scanMatrix() {
+    for (uint8_t c = 0; c < KEY_COLS; c++)
+        pinMode(cols[c], INPUT);
+    uint16_t raw = 0;
+    for (uint8_t c = 0; c < KEY_COLS; c++) {
+        pinMode(cols[c], OUTPUT);
+        digitalWrite(cols[c], LOW);
+        delayMicroseconds(KEYPAD_SETTLE_US);
+        for (uint8_t r = 0; r < KEY_ROWS; r++) {
+            if (digitalRead(rows[r]) == LOW)
+                raw |= 1 << (r * KEY_COLS + c);
+        }
+        pinMode(cols[c], INPUT);
+    }
+    return raw;
+}
+
+// Sleeps until a row interrupt, then scans until every key is released again. The CPU time
+// spent scanning, per key it produced, goes to the keypad_scan histogram.
+static void keypadTask(void *) {
+    KeyDebouncer debouncer;
+    for (;;) {
+        armRows();
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        uint32_t busy = 0;
+        uint32_t pressedKeys = 0;
+        do {
+            uint32_t started = micros();
+            uint16_t pressed = debouncer.update(scanMatrix(), millis());
+            for (uint8_t k = 0; pressed; k++, pressed >>= 1) {
+                if ((pressed & 1) && keyQueue.push(keymap[k])) {
+                    pressedKeys++;
+                    if (consumerTaskHandle)
+                        xTaskNotifyGive(consumerTaskHandle);
+                }
+            }
+            busy += micros() - started;
+            vTaskDelay(pdMS_TO_TICKS(KEYPAD_SCAN_MS));
+        } while (!debouncer.settled());
+        metricsObserve(STAGE_KEYPAD_SCAN, pressedKeys ? busy / pressedKeys : busy);
+    }
+}
+
+#if KEYPAD_LIGHT_SLEEP && CONFIG_PM_ENABLE
+// Lets the idle task scale the clock down and, where the SDK has tickless idle, light sleep. The
+// rows use low-level interrupts, the only kind that can also wake the chip from light sleep.
+static void enableLightSleep() {
+    esp_pm_config_esp32_t pm = {};
+    pm.max_freq_mhz = getCpuFrequencyMhz();
+    pm.min_freq_mhz = 80;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    pm.light_sleep_enable = true;
+    for (uint8_t r = 0; r < KEY_ROWS; r++)
+        gpio_wakeup_enable((gpio_num_t)rows[r], GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+#endif
+    esp_pm_configure(&pm);
+}
+#endif
+
+void keypadBegin(const char keymapIn[KEY_ROWS][KEY_COLS], const uint8_t rowPins[KEY_ROWS], const uint8_t colPins[KEY_COLS]) {
+    if (keypadTaskHandle != nullptr)
+        return;
+    for (uint8_t r = 0; r < KEY_ROWS; r++) {
+        rows[r] = rowPins[r];
+        for (uint8_t c = 0; c < KEY_COLS; c++)
+            keymap[r * KEY_COLS + c] = keymapIn[r][c];
+    }
+    for (uint8_t c = 0; c < KEY_COLS; c++)
+        cols[c] = colPins[c];
+
+    // Masked until the task's first armRows()
+    for (uint8_t r = 0; r < KEY_ROWS; r++) {
+        pinMode(rows[r], INPUT_PULLUP);
+        attachInterrupt(digitalPinToInterrupt(rows[r]), rowInterrupt, ONLOW);
+        gpio_intr_disable((gpio_num_t)rows[r]);
+    }
+#if KEYPAD_LIGHT_SLEEP && CONFIG_PM_ENABLE
+    enableLightSleep();
+#endif
+    xTaskCreatePinnedToCore(keypadTask, "keypad", KEYPAD_TASK_STACK, nullptr, KEYPAD_TASK_PRIORITY, &keypadTaskHandle, KEYPAD_TASK_CORE);
+}
+
+char keypadRead() {
+    char key;
+    return keyQueue.pop(key) ? key : NO_KEY;
+}
+
+void keypadWait(unsigned long timeoutMs) {
+    consumerTaskHandle = xTaskGetCurrentTaskHandle();
+    if (keyQueue.size() > 0)
+        return;
+    ulTaskNotifyTake(pdTRUE, timeoutMs == KEY_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs));
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "key_matrix.h"
+#include <Arduino.h>
+
+//----------------------------------------KEYPAD TASK---------------------------------------
+// The keypad is only scanned while something is happening. At rest every column is driven low
+// and the rows (pulled up) are armed for a low-level interrupt. A press wakes the keypad task,
+// which masks the row interrupts, scans every KEYPAD_SCAN_MS, debounces (key_matrix.h) and queues
+// each new keypress for the UI. Once every key is released it re-arms the rows and blocks again,
+// so nothing polls the keypad between interactions.
+//
+// With -DKEYPAD_LIGHT_SLEEP=1 (and power management in the SDK), idle time also scales the CPU
+// clock down and may light sleep, with the rows as wake sources. The soft AP keeps the radio
+// powered while it is up, which holds the chip out of light sleep, so the web server stays
+// reachable either way.
+
+#define KEYPAD_QUEUE_SIZE 16           // power of two, one slot stays free
+#define KEYPAD_SCAN_MS 5               // scan period while keys are active
+#define KEYPAD_SETTLE_US 5             // after driving a column, before reading the rows
+#define KEYPAD_TASK_CORE 1
+#define KEYPAD_TASK_PRIORITY 2
+#define KEYPAD_TASK_STACK 2048
+
+#ifndef KEYPAD_LIGHT_SLEEP
+#define KEYPAD_LIGHT_SLEEP 0
+#endif
+
+// Starts the keypad task. keymap[r][c] is the character of the key on row r, column c.
+void keypadBegin(const char keymap[KEY_ROWS][KEY_COLS], const uint8_t rowPins[KEY_ROWS], const uint8_t colPins[KEY_COLS]);
+char keypadRead();                           // next queued key, NO_KEY if there is none
+void keypadWait(unsigned long timeoutMs);    // blocks the calling task until a key is queued or the timeout passes
@@ -0,0 +1,85 @@
+#include "lcd_frame.h"
+#include "metrics.h"
+
+LcdFrame::LcdFrame(LiquidCrystal_I2C &glass) : glass(glass) {
+    memset(frame, ' ', sizeof(frame));
+    memset(shadow, ' ', sizeof(shadow));
+}
+
+// Initialises the display; the only place the (slow) hardware clear is used
+void LcdFrame::begin() {
+    glass.init();
+    glass.backlight();
+    glass.clear();
+    memset(frame, ' ', sizeof(frame));
+    memset(shadow, ' ', sizeof(shadow));
+    col = row = 0;
+    glassCol = glassRow = 0;
+    dirty = false;
+}
+
+// Blanks the back buffer and homes its cursor, nothing is sent to the display
+void LcdFrame::clear() {
+    memset(frame, ' ', sizeof(frame));
+    col = row = 0;
+    dirty = true;
+}
+
+void LcdFrame::setCursor(uint8_t c, uint8_t r) {
+    col = c;
+    row = r < LCD_ROWS ? r : LCD_ROWS - 1;
+}
+
+// Writes one character into the back buffer; anything past the end of the line is dropped
+size_t LcdFrame::write(uint8_t ch) {
+    if (col >= LCD_COLS)
+        return 0;
+    frame[row][col++] = ch;
+    dirty = true;
+    return 1;
+}
+
+// Sends the difference between the back buffer and the glass as runs of changed cells
+void LcdFrame::flush() {
+    if (!dirty)
+        return;
+    dirty = false;
+    uint32_t started = micros();
+
+    for (uint8_t r = 0; r < LCD_ROWS; r++) {
+        uint8_t c = 0;
+        while (c < LCD_COLS) {
+            if (!changed(c, r)) {
+                c++;
+                continue;
+            }
+
+            // Grow the run while the unchanged gaps inside it are cheaper to rewrite than to skip
+            uint8_t last = c;
+            uint8_t next = c + 1;
+            while (next < LCD_COLS) {
+                if (changed(next, r)) {
+                    last = next++;
+                    continue;
+                }
+                uint8_t gapEnd = next;
+                while (gapEnd < LCD_COLS && !changed(gapEnd, r))
+                    gapEnd++;
+                if (gapEnd == LCD_COLS || gapEnd - next > LCD_CURSOR_MOVE_COST)
+                    break;
+                next = gapEnd;
+            }
+
+            if (glassRow != r || glassCol != c)
+                glass.setCursor(c, r);
+            for (uint8_t i = c; i <= last; i++) {
+                glass.write(frame[r][i]);
+                shadow[r][i] = frame[r][i];
+            }
+            glassRow = r;
+            glassCol = last + 1;
+            c = last + 1;
+        }
+    }
+    metricsObserve(STAGE_LCD_UPDATE, micros() - started);
+}
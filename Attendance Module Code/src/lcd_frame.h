@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+#include <LiquidCrystal_I2C.h>
+
+//----------------------------------------LCD FRAME---------------------------------------
+// A 16x2 back buffer in front of the LiquidCrystal_I2C. The UI draws into it with the usual
+// clear()/setCursor()/print() calls and flush() sends only the cells that differ from what is on
+// the glass, so redrawing an unchanged screen costs no I2C traffic at all.
+
+#define LCD_COLS 16
+#define LCD_ROWS 2
+
+// Repositioning costs one command byte on the bus, the same as rewriting one cell, so gaps of
+// unchanged cells up to this long are rewritten rather than skipped with a cursor move
+#define LCD_CURSOR_MOVE_COST 1
+
+class LcdFrame : public Print {
+  public:
+    LcdFrame(LiquidCrystal_I2C &glass);
+    void begin();
+    void clear();
+    void setCursor(uint8_t col, uint8_t row);
+    size_t write(uint8_t ch) override;
+    using Print::write;
+    void flush();
+
+  private:
+    bool changed(uint8_t col, uint8_t row) const { return frame[row][col] != shadow[row][col]; }
+
+    LiquidCrystal_I2C &glass;
+    char frame[LCD_ROWS][LCD_COLS];         // what the UI wants on screen
+    char shadow[LCD_ROWS][LCD_COLS];        // what is on the glass
+    uint8_t col = 0, row = 0;               // back buffer cursor
+    int8_t glassCol = -1, glassRow = -1;    // hardware cursor, -1 when unknown
+    bool dirty = false;
+};
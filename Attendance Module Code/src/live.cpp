@@ -0,0 +1,130 @@
+#include "live.h"
+#include "fmt.h"
+#include <atomic>
+
+static AsyncEventSource events(LIVE_PATH);
+static NameLookup liveNameOf = nullptr;
+static AttendanceRecord history[LIVE_HISTORY];        // record seq lives in slot seq % LIVE_HISTORY
+static std::atomic<uint32_t> publishedEnd{ 0 };      // one past the newest record in the history
+static SemaphoreHandle_t liveMutex = nullptr;        // held while sending, guards sentSeq and message
+static uint32_t sentSeq = 0;                         // one past the last record broadcast
+static char message[LIVE_EVENT_RECORDS * 112];
+
+// Only called by the storage task, so slots are written by one task; readers tell a slot that
+// was overwritten (or is being) by its sequence number and CRC
+void liveFeedPublish(const AttendanceRecord *records, uint8_t count) {
+    if (count == 0)
+        return;
+    for (uint8_t i = 0; i < count; i++)
+        history[records[i].seq % LIVE_HISTORY] = records[i];
+    publishedEnd.store(records[count - 1].seq + 1, std::memory_order_release);
+}
+
+static bool historyRead(uint32_t seq, AttendanceRecord &rec) {
+    rec = history[seq % LIVE_HISTORY];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return rec.seq == seq && recordValid(rec);
+}
+
+// The oldest record before end the history still holds, end if none
+static uint32_t historyOldest(uint32_t end) {
+    AttendanceRecord rec;
+    uint32_t seq = end > LIVE_HISTORY ? end - LIVE_HISTORY : 0;
+    while (seq < end && !historyRead(seq, rec))
+        seq++;
+    return seq;
+}
+
+// Sends the records from seq up to end, at most LIVE_EVENT_RECORDS, as one event to one client or
+// to all of them. Returns where it stopped, seq itself if that record has left the history.
+// Called with liveMutex held.
+static uint32_t sendRecords(AsyncEventSourceClient *client, uint32_t seq, uint32_t end) {
+    TextWriter text(message, sizeof(message));
+    uint32_t stop = end - seq > LIVE_EVENT_RECORDS ? seq + LIVE_EVENT_RECORDS : end;
+    AttendanceRecord rec;
+    for (; seq != stop && historyRead(seq, rec); seq++) {
+        char name[64];
+        char line[112];
+        liveNameOf(rec.rollNum, name, sizeof(name));
+        size_t n = formatRecordCsv(rec, name, line, sizeof(line));
+        if (text.length() > 0)
+            text.put('\n');
+        text.num(rec.seq).put(',').put(line, n - 1);        // the event source ends each line itself
+    }
+    if (text.length() == 0)
+        return seq;
+    if (client)
+        client->send(message, "checkin", seq);
+    else
+        events.send(message, "checkin", seq);
+    return seq;
+}
+
+// Sends [from, end) in as many events as it takes, skipping over records that left the history
+static uint32_t sendRange(AsyncEventSourceClient *client, uint32_t from, uint32_t end) {
+    while (from != end) {
+        uint32_t next = sendRecords(client, from, end);
+        if (next == from) {
+            next = historyOldest(end);
+            if (next <= from)
+                next = from + 1;        // a slot being rewritten as it was read
+        }
+        from = next;
+    }
+    return from;
+}
+
+static void liveTask(void *) {
+    unsigned long lastSend = millis();
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(LIVE_BATCH_MS));
+        uint32_t end = publishedEnd.load(std::memory_order_acquire);
+        xSemaphoreTake(liveMutex, portMAX_DELAY);
+        if (end == sentSeq || events.count() == 0) {
+            sentSeq = end;
+            lastSend = millis();
+        } else if (events.avgPacketsWaiting() < LIVE_BACKLOG || end - sentSeq >= LIVE_EVENT_RECORDS ||
+                   millis() - lastSend >= LIVE_MAX_HOLD_MS) {
+            sentSeq = sendRange(nullptr, sentSeq, end);
+            lastSend = millis();
+        }
+        xSemaphoreGive(liveMutex);
+    }
+}
+
+// Runs on the web server's task as a client connects. The client is already on the broadcast list,
+// and the live task is kept out until the replay has gone, so nothing is sent twice or skipped.
+static void liveConnect(AsyncEventSourceClient *client) {
+    xSemaphoreTake(liveMutex, portMAX_DELAY);
+    uint32_t from = client->lastId();
+    if (from == 0 || from > sentSeq) {
+        // A new page, or an id from before the journal was cleared: start from now
+        TextBuffer<12> next;
+        next.num(sentSeq);
+        client->send(next.c_str(), "hello", sentSeq, LIVE_RECONNECT_MS);
+    } else {
+        sendRange(client, from, sentSeq);
+    }
+    xSemaphoreGive(liveMutex);
+}
+
+void liveBegin(AsyncWebServer &server, NameLookup nameOf) {
+    if (liveMutex != nullptr)
+        return;
+    liveNameOf = nameOf;
+    liveMutex = xSemaphoreCreateMutex();
+    // Start from what is already on flash, so the first batch after a reboot is not taken for
+    // everything since seq 0. The storage task may have published meanwhile; the newer end wins.
+    uint32_t published = publishedEnd.load(std::memory_order_acquire);
+    uint32_t committed = journalSnapshot().endSeq;
+    while (published < committed && !publishedEnd.compare_exchange_weak(published, committed, std::memory_order_acq_rel))
+        ;
+    sentSeq = publishedEnd.load(std::memory_order_acquire);
+    events.onConnect(liveConnect);
+    server.addHandler(&events);
+    xTaskCreatePinnedToCore(liveTask, "live", LIVE_TASK_STACK, nullptr, LIVE_TASK_PRIORITY, nullptr, LIVE_TASK_CORE);
+}
+
+size_t liveClients() {
+    return events.count();
+}
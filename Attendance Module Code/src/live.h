@@ -0,0 +1,37 @@
+#pragma once
+
+#include "journal.h"
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+//----------------------------------------LIVE FEED---------------------------------------
+// Pushes committed check-ins to dashboards over Server-Sent Events on /live, so a wall display no
+// longer re-downloads /csv to see what is new. The storage task only copies each committed batch
+// into a small history in RAM (liveFeedPublish(): no locks, no waiting on clients). A live task
+// wakes every LIVE_BATCH_MS and sends everything new as one "checkin" event holding one /events
+// style CSV line per record, so a burst at the door becomes a few events rather than one each.
+//
+// Each event's id is the sequence number after its last record. A browser that reconnects sends
+// it back as Last-Event-ID and is replayed what it missed, as far back as the history reaches. A
+// client that connects without one gets a "hello" event carrying the next sequence number.
+//
+// Slow clients: the web server queues a bounded number of events per client and drops what does
+// not fit, so a stalled client holds up neither the others nor the journal. While clients are
+// backed up the live task holds records back for up to LIVE_MAX_HOLD_MS to send fewer, larger
+// events. A client that finds the first sequence number of an event past the one it expected has
+// lost records, and fetches them from /events?since=.
+
+#define LIVE_PATH "/live"
+#define LIVE_HISTORY 64                // records kept for replay, power of two
+#define LIVE_EVENT_RECORDS 16          // most records in one event
+#define LIVE_BATCH_MS 250              // how often new records are sent
+#define LIVE_MAX_HOLD_MS 2000          // longest records are held back while clients are backed up
+#define LIVE_BACKLOG 4                 // events queued per client, on average, that counts as backed up
+#define LIVE_RECONNECT_MS 3000         // retry interval handed to browsers
+#define LIVE_TASK_CORE 0
+#define LIVE_TASK_PRIORITY 1
+#define LIVE_TASK_STACK 4096
+
+void liveBegin(AsyncWebServer &server, NameLookup nameOf);
+void liveFeedPublish(const AttendanceRecord *records, uint8_t count);        // from the commit path
+size_t liveClients();
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Arduino.h>
+
+//----------------------------------------SERIAL LOG---------------------------------------
+// All serial chatter goes through these macros. Build with -DATTENDANCE_SERIAL_LOG=0 (see
+// platformio.ini) and it compiles away entirely, format strings included.
+
+#ifndef ATTENDANCE_SERIAL_LOG
+#define ATTENDANCE_SERIAL_LOG 1
+#endif
+
+#if ATTENDANCE_SERIAL_LOG
+#define LOG_PRINT(...) Serial.print(__VA_ARGS__)
+#define LOG_PRINTLN(...) Serial.println(__VA_ARGS__)
+#define LOG_PRINTF(...) Serial.printf(__VA_ARGS__)
+#define LOG_WRITE(...) Serial.write(__VA_ARGS__)
+#else
+#define LOG_PRINT(...) ((void)0)
+#define LOG_PRINTLN(...) ((void)0)
+#define LOG_PRINTF(...) ((void)0)
+#define LOG_WRITE(...) ((void)0)
+#endif
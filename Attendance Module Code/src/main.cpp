@@ -74,48 +74,57 @@ Is key '*'?
 |   |
 |   |--- No
 |   |   |
-|   |   |   Is key 'B'?
+|   |   |   Is key 'A'?
 |   |   |   |
 |   |   |   |--- Yes
 |   |   |   |    |
-|   |   |   |    Display IP Address
+|   |   |   |    Rush mode: key in RollNumbers back to back, '#' adds each to the batch
+|   |   |   |    |
+|   |   |   |    'A' again, a full batch or a pause marks them all and shows who was marked
 |   |   |   |--- No
 |   |   |   |    |
-|   |   |   |    Wait for keypress on homescreen
+|   |   |   |    Is key 'B'?
+|   |   |   |    |
+|   |   |   |    |--- Yes
+|   |   |   |    |    |
+|   |   |   |    |    Display IP Address
+|   |   |   |    |--- No
+|   |   |   |    |    |
+|   |   |   |    |    Wait for keypress on homescreen
 
 End
 
 */
 
 #include "FS.h"
-#include "SPIFFS.h"
-#include "data.h"
+#include "archive.h"
+#include "boot.h"
+#include "checkin_ui.h"
+#include "epoch.h"
+#include "fmt.h"
+#include "gzip.h"
+#include "hal_esp32.h"
+#include "journal.h"
+#include "keypad_task.h"
+#include "lcd_frame.h"
+#include "live.h"
+#include "log.h"
+#include "metrics.h"
+#include "presence.h"
+#include "roster.h"
+#include "rtc.h"
+#include "storage.h"
+#include "storage_backend.h"
 #include <Arduino.h>
 #include <ESPAsyncWebServer.h>
-#include <Keypad.h>
 #include <LiquidCrystal_I2C.h>
-#include <WiFi.h>
 #include <Wire.h>
 
 // #define INIT_RTC
 
-//----------------------------------------RTC---------------------------------------
-#define DS3231_READ 0xD1
-#define DS3231_WRITE 0xD0
-#define DS3231_ADDR 0x68
-#define DS3231_SECONDS 0x00
-#define DS3231_MINUTES 0x01
-#define DS3231_HOURS 0x02
-#define DS3231_DAY 0x03
-#define DS3231_DATE 0x04
-#define DS3231_CEN_MONTH 0x05
-
-#define DS3231_DEC_YEAR 0x06
-#define DS3231_TEMP_MSB 0x11
-#define DS3231_TEMP_LSB 0x12
-const byte ROWS = 4;
-const byte COLS = 4;
-char keys[ROWS][COLS] = {
+const byte ROWS = KEY_ROWS;
+const byte COLS = KEY_COLS;
+const char keys[ROWS][COLS] = {
     { '1', '2', '3', 'A' },
     { '4', '5', '6', 'B' },
     { '7', '8', '9', 'C' },
@@ -129,483 +138,325 @@ const char *password = "password";
 
 // Objects
 AsyncWebServer server(80);
-LiquidCrystal_I2C lcd(0x27, 16, 2);
+LiquidCrystal_I2C lcdGlass(0x27, LCD_COLS, LCD_ROWS);
+LcdFrame lcd(lcdGlass);        // all drawing goes through the frame, see lcd_frame.h
 byte klock[] = { 0x00, 0x0E, 0x15, 0x15, 0x1D, 0x11, 0x11, 0x0E };
-Keypad keypad = Keypad(makeKeymap(keys), rowPins, colPins, ROWS, COLS);
-
-char key;
-uint8_t value = 0;
-char const *wdays[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
 
-uint8_t hours, minutes, seconds, datee, month, yearr, day;
+// The UI's name lookup; an uploaded roster is only there once the boot task has loaded it
+static bool uiLookup(uint16_t rollNum, char *name, size_t len) {
+    bootWait(BOOT_ROSTER);
+    return rosterLookup(rollNum, name, len);
+}
 
-String dataMessage;
-float temp;
-ulong timer_A;
+// The check-in logic only sees the hardware through these (see hal.h)
+Esp32Keypad keypadInput;
+Esp32Display display(lcd);
+Esp32Clock rtcClock;
+Esp32Store store;
+Esp32Network network(ssid, password);
+CheckinUi ui(keypadInput, display, rtcClock, store, network, uiLookup);
 
 // Function Prototypes
-void getDate();
-void getTime();
-uint8_t toBcd(uint8_t num);
-uint8_t fromBcd(uint8_t bcd);
-uint8_t readRegister(uint8_t reg);
-void writeRegister(uint8_t reg, uint8_t data);
 void listDir(fs::FS &fs, const char *dirname, uint8_t levels);
 void readFile(fs::FS &fs, const char *path);
 void writeFile(fs::FS &fs, const char *path, const char *message);
 void appendFile(fs::FS &fs, const char *path, const char *message);
 void renameFile(fs::FS &fs, const char *path1, const char *path2);
 void deleteFile(fs::FS &fs, const char *path);
-void markAttendance(int rollNum, String name);
-void markDeparture(int rollNum, String name);
-
-// --------------------------------------------------------------------------------------- SETUP ----------
-void setup() {
-    Serial.begin(115200);
-    Wire.begin();
-    Serial.print("Setting AP (Access Point)…");
-    WiFi.softAP(ssid, password);
-
-    IPAddress IP = WiFi.softAPIP();
-    Serial.print("AP IP address: ");
-    Serial.println(IP);
-
-    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) { request->send(SPIFFS, "/index.html", "text/html"); });
-    server.on("/csv", HTTP_GET, [](AsyncWebServerRequest *request) { request->send(SPIFFS, "/RTR_Attendance.csv", "text/csv"); });
-    // server.on("/plain", HTTP_GET, [](AsyncWebServerRequest *request) { request->send(200, "text/plain", "You have reached the WebServer for the RTR Attendance Module designed by Soham Karkhanis. \n Append /csv to the URL to get the csv file containing the attendance record"); });
-    server.on("/test", HTTP_GET, [](AsyncWebServerRequest *request) { request->send_P(200, "text/plain", "Hello World"); });
-    server.begin();
-
-    if (!SPIFFS.begin(true)) {
-        Serial.println("An Error has occurred while mounting SPIFFS");
-        return;
-    }
-
-    File file = SPIFFS.open("/test.txt");
-    if (!file) {
-        Serial.println("Failed to open file for reading");
-        return;
-    }
 
-    Serial.println("File Content:");
-    while (file.available()) {
-        Serial.print((char)file.read());
+// The roster upload a request is sending, 0 if its body has not started; the name lives in the
+// request's _tempObject, which the request frees
+static uint32_t rosterUploadOf(AsyncWebServerRequest *request, bool starting) {
+    if (starting) {
+        if (request->_tempObject == nullptr)
+            request->_tempObject = malloc(sizeof(uint32_t));
+        if (request->_tempObject != nullptr)
+            *(uint32_t *)request->_tempObject = rosterUploadBegin();
     }
-    file.close();
-
-#ifdef INIT_RTC
-    writeRegister(DS3231_HOURS, 16);
-    writeRegister(DS3231_MINUTES, 32);
-    writeRegister(DS3231_SECONDS, 0);
-
-    writeRegister(DS3231_DAY, 5);
-    writeRegister(DS3231_DATE, 12);
-    writeRegister(DS3231_CEN_MONTH, 5);
-    writeRegister(DS3231_DEC_YEAR, 23);
-#endif
-
-    lcd.init();
-    lcd.backlight();
-    lcd.print("Initializing...");
-    // lcd.createChar(0, klock);
-    getDate();
-    getTime();
-    delay(800);
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print(wdays[day]);
-    lcd.print(" " + (String)datee + "/" + (String)month + "/" + (String)yearr);
-    lcd.setCursor(0, 1);
-    lcd.print("* Arr | D Depart");
-    lcd.setCursor(0, 1);
-    Serial.println(" ");
+    return request->_tempObject != nullptr ? *(uint32_t *)request->_tempObject : 0;
 }
-// --------------------------------------------------------------------------------------- SETUP END ----------
-// ------------------------------------------------------------------------------------------------------------------------------ LOOP  ----------
-void loop() {
-    key = keypad.getKey();
-
-    // --------------------------------------------------------------------------------------- IF KEY * DO ARRIVE STUFF  ----------
-    if (key == '*') {
-        lcd.clear();
-        lcd.print("Enter Your RNum");
-        lcd.setCursor(0, 1);
-        key = ' ';
-        while (key == NULL || key == ' ' || key == '*' || key == 'B' || key == 'D' || key == 'A') {
-            key = keypad.getKey();
-            if (key == 'B' || key == 'D' || key == 'A') {
-                lcd.setCursor(0, 0);
-                lcd.print("Enter Valid Num:");
-            }
-        }
-        // ----------------------------------------------------------------------- C TO RETURN TO PREV MENU  ----------
-        if (key == 'C') {
-            getDate();
-            getTime();
-            lcd.clear();
-            lcd.print(wdays[day]);
-            lcd.print(" " + (String)datee + "/" + (String)month + "/" + (String)yearr);
-            lcd.setCursor(0, 1);
-            lcd.print("* Arr | D Depart");
-            lcd.setCursor(0, 0);
-            return;
-        }
-
-        lcd.setCursor(0, 1);
-        lcd.print(key);
-        value = (int)key - 48;
-        value = value * 10;
-        key = ' ';
-
-        while (key == NULL || key == ' ' || key == '*' || key == 'B' || key == 'D' || key == 'A') {
-            key = keypad.getKey();
-            if (key == 'B' || key == 'D' || key == 'A') {
-                lcd.setCursor(0, 0);
-                lcd.print("Enter Valid Num:");
-            }
-        }
-
-        if (key == 'C') {
-            getDate();
-            getTime();
-            lcd.clear();
-            lcd.print(wdays[day]);
-            lcd.print(" " + (String)datee + "/" + (String)month + "/" + (String)yearr);
-            lcd.setCursor(0, 0);
-            lcd.print("* Arr | D Depart");
-            lcd.setCursor(0, 1);
 
+// --------------------------------------------------------------------------------------- SETUP ----------
+// Registers the routes and starts serving; run by the boot task
+static void webBegin() {
+    server.on("/csv", HTTP_GET, [](AsyncWebServerRequest *request) {
+        // Optional filters: ?from=YYYY-MM-DD&to=YYYY-MM-DD&roll=N
+        JournalQuery query;
+        if (request->hasParam("from") && !parseIsoDate(request->getParam("from")->value().c_str(), query.fromDay)) {
+            request->send(400, "text/plain", "Bad 'from' date, expected YYYY-MM-DD");
             return;
         }
-
-        lcd.print(key);
-        value = value + ((int)key - 48);
-        lcd.setCursor(0, 0);
-        lcd.print("# Confirm C Abrt");
-        //  Serial.println("Press # to mark attendance or Press C to cancel");
-        while (key != 'C' && key != '#')
-            key = keypad.getKey();
-        if (key == 'C') {
-            getDate();
-            getTime();
-            lcd.clear();
-            lcd.print(wdays[day]);
-            lcd.print(" " + (String)datee + "/" + (String)month + "/" + (String)yearr);
-            lcd.setCursor(0, 1);
-            lcd.print("* Arr | D Depart");
-            value = 0;
-            // ----------------------------------------------------------------------- IF #, MARK ATTENDANCE  ----------
-        } else if (key == '#') {
-            getDate();
-            getTime();
-            if (student_data.find(value) == student_data.end()) {
-                lcd.clear();
-                lcd.setCursor(0, 0);
-                lcd.print("Error");
-                lcd.setCursor(0, 1);
-                lcd.print("User Not Found");
-                delay(2000);
-            } else {
-                auto student = student_data.find(value);
-                markAttendance(value, student->second);
-                lcd.clear();
-                lcd.setCursor(0, 0);
-                lcd.print("Welcome Back");
-                lcd.setCursor(0, 1);
-                lcd.print(student->second);
-                delay(2000);
-            }
-            getDate();
-            getTime();
-            lcd.clear();
-            lcd.print(wdays[day]);
-            lcd.print(" " + (String)datee + "/" + (String)month + "/" + (String)yearr);
-            lcd.setCursor(0, 1);
-            lcd.print("* Arr | D Depart");
-            lcd.setCursor(0, 0);
-        }
-        key = ' ';
-    }
-    // --------------------------------------------------------------------------------------- IF KEY D DO DEPART STUFF  ----------
-    else if (key == 'D') {
-        lcd.clear();
-        lcd.print("Enter Your RNum");
-        lcd.setCursor(0, 1);
-        key = ' ';
-        while (key == NULL || key == ' ' || key == '*' || key == 'B' || key == 'A' || key == 'D') {
-            key = keypad.getKey();
-            if (key == 'B' || key == '*' || key == 'A' || key == 'D') {
-                lcd.setCursor(0, 0);
-                lcd.print("Enter Valid Num:");
-            }
-        }
-        if (key == 'C') {
-            getDate();
-            getTime();
-            lcd.clear();
-            lcd.print(wdays[day]);
-            lcd.print(" " + (String)datee + "/" + (String)month + "/" + (String)yearr);
-            lcd.setCursor(0, 1);
-            lcd.print("* Arr | D Depart");
-            lcd.setCursor(0, 0);
-            value = 0;
+        if (request->hasParam("to") && !parseIsoDate(request->getParam("to")->value().c_str(), query.toDay)) {
+            request->send(400, "text/plain", "Bad 'to' date, expected YYYY-MM-DD");
             return;
         }
-        lcd.setCursor(0, 1);
-        lcd.print(key);
-        value = (int)key - 48;
-        value = value * 10;
-        key = ' ';
-        while (key == NULL || key == ' ' || key == '*' || key == 'B' || key == '*' || key == 'A') {
-            key = keypad.getKey();
-            if (key == 'B' || key == '*' || key == 'A') {
-                lcd.setCursor(0, 0);
-                lcd.print("Enter Valid Num:");
+        if (request->hasParam("roll"))
+            query.rollNum = request->getParam("roll")->value().toInt();
+
+        // The download covers what was committed when it was asked for. Its ETag names that snapshot
+        // (plus the roster that supplies the names), so a client polling an unchanged log gets a
+        // 304 before any flash is touched.
+        JournalSnapshot snap = journalSnapshot();
+        bool compress = request->hasHeader("Accept-Encoding") && request->getHeader("Accept-Encoding")->value().indexOf("gzip") >= 0;
+        TextBuffer<48> etag;
+        etag.put('"').num(snap.firstSeq).put('-').num(snap.endSeq).put('-').hex(rosterChecksum(), 8).put(compress ? "-gz\"" : "\"");
+        char lastModified[32] = "";
+        if (snap.lastTimestamp)
+            formatHttpDate(snap.lastTimestamp, lastModified, sizeof(lastModified));
+        if (request->hasHeader("If-None-Match")) {
+            const String &match = request->getHeader("If-None-Match")->value();
+            if (match == "*" || match.indexOf(etag.c_str()) >= 0) {
+                AsyncWebServerResponse *response = request->beginResponse(304);
+                response->addHeader("ETag", etag.c_str());
+                if (lastModified[0])
+                    response->addHeader("Last-Modified", lastModified);
+                request->send(response);
+                return;
             }
         }
-        if (key == 'C') {
-            getDate();
-            getTime();
-            lcd.clear();
-            lcd.print(wdays[day]);
-            lcd.print(" " + (String)datee + "/" + (String)month + "/" + (String)yearr);
-            lcd.setCursor(0, 1);
-            lcd.print("* Arr | D Depart");
-            lcd.setCursor(0, 0);
-            value = 0;
-            return;
-        }
-        lcd.print(key);
-        value = value + ((int)key - 48);
-        lcd.setCursor(0, 0);
-        lcd.print("# Confirm C Abrt");
-        // Serial.println("Press # to mark attendance or Press C to cancel");
-        while (key != 'C' && key != '#')
-            key = keypad.getKey();
-        if (key == 'C') {
-            getDate();
-            getTime();
-            lcd.clear();
-            lcd.print(wdays[day]);
-            lcd.print(" " + (String)datee + "/" + (String)month + "/" + (String)yearr);
-            lcd.setCursor(0, 1);
-            lcd.print("* Arr | D Depart");
-            lcd.setCursor(0, 0);
-            value = 0;
-        } else if (key == '#') {
-            getDate();
-            getTime();
-            if (student_data.find(value) == student_data.end()) {
-                lcd.clear();
-                lcd.setCursor(0, 0);
-                lcd.print("Error");
-                lcd.setCursor(0, 1);
-                lcd.print("User Not Found");
-                delay(2000);
-            } else {
-                auto student = student_data.find(value);
-                markDeparture(value, student->second);
-                lcd.clear();
-                lcd.setCursor(0, 0);
-                lcd.print("See You Soon");
-                lcd.setCursor(0, 1);
-                lcd.print(student->second);
-                delay(2000);
-            }
 
-            getDate();
-            getTime();
-            lcd.clear();
-            lcd.print(wdays[day]);
-            lcd.print(" " + (String)datee + "/" + (String)month + "/" + (String)yearr);
-            lcd.setCursor(0, 1);
-            lcd.print("* Arr | D Depart");
-            lcd.setCursor(0, 0);
+        // The CSV is rendered from the binary journal on the fly; the reader lives as long as the response
+        std::shared_ptr<JournalCsvReader> reader = std::make_shared<JournalCsvReader>(storageBackend().files(), rosterLookup, query, snap.endSeq);
+        AsyncWebServerResponse *response;
+        if (compress) {
+            // Compressed as it is sent, in constant memory; the soft AP link is slower than the encoder
+            std::shared_ptr<GzipStream> gzip = std::make_shared<GzipStream>(*reader);
+            response = request->beginChunkedResponse("text/csv", [reader, gzip](uint8_t *buffer, size_t maxLen, size_t index) -> size_t { return gzip->read(buffer, maxLen); });
+            response->addHeader("Content-Encoding", "gzip");
+        } else {
+            response = request->beginChunkedResponse("text/csv", [reader](uint8_t *buffer, size_t maxLen, size_t index) -> size_t { return reader->read(buffer, maxLen); });
         }
-        key = ' ';
-    }
-    // --------------------------------------------------------------------------------------- IF KEY B PRINT IP, DATE   ----------
-    if (key == 'B') {
-        lcd.clear();
-        lcd.setCursor(0, 0);
-        lcd.print(WiFi.softAPIP());
-        delay(2000);
-        lcd.clear();
-        lcd.print(wdays[day]);
-        lcd.print(" " + (String)datee + "/" + (String)month + "/" + (String)yearr);
-        lcd.setCursor(0, 1);
-        lcd.print("* Arr | D Depart");
-        lcd.setCursor(0, 0);
-    }
-}
-// ------------------------------------------------------------------------------------------------------------------------------ LOOP END  ----------
-
-//----------------------------------------RTC FUNCTIONS---------------------------------------
-
-// Reads the current date from the RTC module and stores it in variables
-void getDate() {
-    day = readRegister(DS3231_DAY);
-    hours = readRegister(DS3231_HOURS);
-    minutes = readRegister(DS3231_MINUTES);
-    seconds = readRegister(DS3231_SECONDS);
-    datee = readRegister(DS3231_DATE);
-    month = readRegister(DS3231_CEN_MONTH);
-    yearr = readRegister(DS3231_DEC_YEAR);
-    temp = ((readRegister(DS3231_TEMP_MSB) << 8 | readRegister(DS3231_TEMP_LSB)) >> 6) / 4.0f;
-}
-
-// Reads the current time from the RTC module and stores it in variables
-void getTime() {
-    hours = readRegister(DS3231_HOURS);
-    minutes = readRegister(DS3231_MINUTES);
-    seconds = readRegister(DS3231_SECONDS);
-    yearr = readRegister(DS3231_DEC_YEAR);
-    temp = ((readRegister(DS3231_TEMP_MSB) << 8 | readRegister(DS3231_TEMP_LSB)) >> 6) / 4.0f;
-}
-
-// Converts a decimal number to Binary Coded Decimal (BCD) format
-uint8_t toBcd(uint8_t num) {
-    uint8_t bcd = ((num / 10) << 4) + (num % 10);
-    return bcd;
-}
-
-// Converts a BCD number to decimal format
-uint8_t fromBcd(uint8_t bcd) {
-    uint8_t num = (10 * ((bcd & 0xf0) >> 4)) + (bcd & 0x0f);
-    return num;
-}
-
-// Reads a specific register from the RTC module using the Wire library
-uint8_t readRegister(uint8_t reg) {
-    Wire.beginTransmission(DS3231_ADDR);
-    Wire.write(reg);
-    Wire.endTransmission();
-    Wire.requestFrom(DS3231_ADDR, 1);
-    return fromBcd(Wire.read());
+        response->addHeader("Vary", "Accept-Encoding");
+        response->addHeader("ETag", etag.c_str());
+        if (lastModified[0])
+            response->addHeader("Last-Modified", lastModified);
+        request->send(response);
+    });
+    server.on("/events", HTTP_GET, [](AsyncWebServerRequest *request) {
+        // ?since=<seq>&limit=<n>&format=csv|bin - records with seq >= since, oldest first. A collector
+        // keeps the last seq it got plus one as its cursor.
+        uint32_t since = request->hasParam("since") ? strtoul(request->getParam("since")->value().c_str(), nullptr, 10) : 0;
+        uint32_t limit = request->hasParam("limit") ? strtoul(request->getParam("limit")->value().c_str(), nullptr, 10) : EVENTS_DEFAULT_LIMIT;
+        if (limit == 0 || limit > EVENTS_MAX_LIMIT)
+            limit = EVENTS_MAX_LIMIT;
+        bool binary = request->hasParam("format") && request->getParam("format")->value() == "bin";
+
+        uint32_t endSeq = journalSnapshot().endSeq;
+        std::shared_ptr<JournalEventReader> reader = std::make_shared<JournalEventReader>(storageBackend().files(), rosterLookup, since, limit, binary, endSeq);
+        AsyncWebServerResponse *response = request->beginChunkedResponse(binary ? "application/octet-stream" : "text/csv", [reader](uint8_t *buffer, size_t maxLen, size_t index) -> size_t { return reader->read(buffer, maxLen); });
+        TextBuffer<12> nextSeq;
+        nextSeq.num(endSeq);
+        response->addHeader("X-Next-Seq", nextSeq.c_str());
+        request->send(response);
+    });
+    server.on(
+        "/roster", HTTP_POST,
+        [](AsyncWebServerRequest *request) {
+            char message[80];
+            bool ok = rosterUploadResult(rosterUploadOf(request, false), message, sizeof(message));
+            request->send(ok ? 200 : 400, "text/plain", message);
+        },
+        // multipart form upload
+        [](AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final) { rosterUploadChunk(rosterUploadOf(request, index == 0), data, len, final); },
+        // raw text/csv body
+        [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) { rosterUploadChunk(rosterUploadOf(request, index == 0), data, len, index + len == total); });
+    server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+        AsyncResponseStream *response = request->beginResponseStream("text/plain; version=0.0.4");
+        metricsRender(*response);
+        metricsGauge(*response, "boot_interactive_ms", "Reset to the first key being taken", bootMillis(BOOT_INTERACTIVE));
+        metricsGauge(*response, "heap_free_bytes", "Free heap right now", ESP.getFreeHeap());
+        metricsGauge(*response, "heap_min_free_bytes", "Lowest free heap since boot", ESP.getMinFreeHeap());
+        metricsGauge(*response, "spiffs_total_bytes", "File system partition size", storageBackend().totalBytes());
+        metricsGauge(*response, "spiffs_used_bytes", "File system bytes in use", storageBackend().usedBytes());
+        if (RingLog *ring = storageBackend().journalLog()) {
+            metricsGauge(*response, "journal_ring_records", "Records and markers held by the journal partition", ring->end() - ring->begin());
+            metricsGauge(*response, "journal_ring_capacity", "Records the journal partition holds", ring->capacity());
+            metricsGauge(*response, "journal_ring_sector_erases", "Erase count of the newest journal sector", ring->wear());
+        }
+        metricsGauge(*response, "storage_queue_depth", "Check-ins waiting for the storage task", storageQueued());
+        metricsGauge(*response, "journal_pending_records", "Records buffered in RAM, not yet on flash", journalPending());
+        metricsGauge(*response, "live_clients", "Dashboards subscribed to /live", liveClients());
+        request->send(response);
+    });
+    server.on("/boot", HTTP_GET, [](AsyncWebServerRequest *request) {
+        AsyncResponseStream *response = request->beginResponseStream("text/plain");
+        bootRender(*response);
+        request->send(response);
+    });
+    server.on("/present", HTTP_GET, [](AsyncWebServerRequest *request) {
+        AsyncResponseStream *response = request->beginResponseStream("application/json");
+        presenceRenderPresent(*response, rosterLookup, dayOf(clockNow()));
+        request->send(response);
+    });
+    server.on("/summary", HTTP_GET, [](AsyncWebServerRequest *request) {
+        AsyncResponseStream *response = request->beginResponseStream("application/json");
+        presenceRenderSummary(*response, rosterLookup, dayOf(clockNow()));
+        request->send(response);
+    });
+    // server.on("/plain", HTTP_GET, [](AsyncWebServerRequest *request) { request->send(200, "text/plain", "You have reached the WebServer for the RTR Attendance Module designed by Soham Karkhanis. \n Append /csv to the URL to get the csv file containing the attendance record"); });
+    liveBegin(server, rosterLookup);        // /live, see live.h
+    server.on("/test", HTTP_GET, [](AsyncWebServerRequest *request) { request->send_P(200, "text/plain", "Hello World"); });
+    // Files from data/, staged under /www and gzipped by tools/gzip_data.py; the handler finds "x.gz"
+    // for "x" and sends it with Content-Encoding: gzip. Only /www is served, never the journal,
+    // roster or presence files. Registered last so the routes above take precedence.
+    server.serveStatic("/", storageBackend().files(), "/www/").setDefaultFile("index.html").setCacheControl("max-age=600");
+    server.begin();
 }
 
-// Writes data to a specific register of the RTC module using the Wire library
-void writeRegister(uint8_t reg, uint8_t data) {
-    Wire.beginTransmission(DS3231_ADDR);
-    Wire.write(reg);
-    Wire.write(toBcd(data));
-    Wire.endTransmission();
+// The slow half of the boot, run by the boot task (boot.h) while the keypad already takes keys
+static void deferredBoot() {
+    StorageBackend &backend = storageBackend();
+    bool mounted = backend.begin();
+    if (!mounted)
+        LOG_PRINTF("An Error has occurred while mounting %s\r\n", backend.name());
+    bootMark(BOOT_STORAGE, mounted);
+    if (mounted) {
+        fs::FS &fs = backend.files();
+        rosterBegin(fs);
+        bootMark(BOOT_ROSTER);
+        journalBegin(fs, backend.journalLog());
+        bootMark(BOOT_JOURNAL);
+        presenceBegin(fs, dayOf(clockNow()));
+        storageBegin(fs);
+        if (!backend.journalLog())
+            archiveBegin(fs);        // a ring log recycles its own sectors
+        bootMark(BOOT_PRESENCE);
+    } else {
+        // Check-ins waiting on these give up straight away; names come from the compiled roster
+        bootMark(BOOT_ROSTER, false);
+        bootMark(BOOT_JOURNAL, false);
+        bootMark(BOOT_PRESENCE, false);
+    }
+    bootMark(BOOT_NETWORK, network.begin());
+    webBegin();
+    bootMark(BOOT_WEB);
 }
 
-//----------------------------------------RTC FUNCTIONS END---------------------------------------
+// Only what the first keypress needs happens here, everything else is deferred to the boot task
+void setup() {
+    Serial.begin(115200);
+    Wire.begin();
+    clockBegin(Wire);
+#ifdef INIT_RTC
+    DateTime initTime = { 2023, 5, 12, 16, 32, 0, 5 };
+    clockSet(initTime);
+#endif
+    bootMark(BOOT_CLOCK);
 
-//----------------------------------------ATTENDANCE FUNCTIONS------------------------------------
-// Marks the attendance by creating a data message with the current date, time, roll number, name, and "Arrival" status. The message is then printed and appended to a CSV file.
-void markAttendance(int rollNum, String name) {
-    dataMessage = (String)datee + "/" + (String)month + "/" + (String)yearr + "," + (String)hours + ":" + (String)minutes + ":" + (String)seconds + "," + (String)rollNum + "," + (String)name + "," + "Arrival" + "\n";
+    lcd.begin();
+    // lcd.createChar(0, klock);
+    bootMark(BOOT_DISPLAY);
+    keypadBegin(keys, rowPins, colPins);
+    bootMark(BOOT_KEYPAD);
+    ui.begin();
+    bootMark(BOOT_INTERACTIVE);
 
-    Serial.print("Attendance Marked: ");
-    Serial.println(dataMessage);
-    appendFile(SPIFFS, "/RTR_Attendance.csv", dataMessage.c_str());
+    bootDefer(deferredBoot);
 }
-
-// Marks the departure by creating a data message with the current date, time, roll number, name, and "Departure" status. The message is then printed and appended to a CSV file.
-void markDeparture(int rollNum, String name) {
-    dataMessage = (String)datee + "/" + (String)month + "/" + (String)yearr + "," + (String)hours + ":" + (String)minutes + ":" + (String)seconds + "," + (String)rollNum + "," + (String)name + "," + "Departure" + "\n";
-
-    Serial.print("Attendance Marked: ");
-    Serial.println(dataMessage);
-    appendFile(SPIFFS, "/RTR_Attendance.csv", dataMessage.c_str());
+// --------------------------------------------------------------------------------------- SETUP END ----------
+// ------------------------------------------------------------------------------------------------------------------------------ LOOP  ----------
+// loop() never blocks: the check-in state machine (checkin_ui.h) handles at most one keypress per pass,
+// and writing to flash happens on the storage task (storage.h). The one exception is a check-in
+// confirmed in the first moments after a reset, which waits for the boot task (boot.h).
+void loop() {
+    ui.poll();
+    ui.wait();
 }
+// ------------------------------------------------------------------------------------------------------------------------------ LOOP END  ----------
 
 // --------------------------------------------------------------------------------- SPIFFS CMDS -----------------------------------------
-// Lists the contents of a directory in the SPIFFS file system recursively.
+// Lists the contents of a directory in the file system recursively.
 void listDir(fs::FS &fs, const char *dirname, uint8_t levels) {
-    Serial.printf("Listing directory: %s\r\n", dirname);
+    LOG_PRINTF("Listing directory: %s\r\n", dirname);
 
     File root = fs.open(dirname);
     if (!root) {
-        Serial.println("− failed to open directory");
+        LOG_PRINTLN("− failed to open directory");
         return;
     }
     if (!root.isDirectory()) {
-        Serial.println(" − not a directory");
+        LOG_PRINTLN(" − not a directory");
         return;
     }
 
     File file = root.openNextFile();
     while (file) {
         if (file.isDirectory()) {
-            Serial.print("  DIR : ");
-            Serial.println(file.name());
+            LOG_PRINT("  DIR : ");
+            LOG_PRINTLN(file.name());
             if (levels) {
                 listDir(fs, file.name(), levels - 1);
             }
         } else {
-            Serial.print("  FILE: ");
-            Serial.print(file.name());
-            Serial.print("\tSIZE: ");
-            Serial.println(file.size());
+            LOG_PRINT("  FILE: ");
+            LOG_PRINT(file.name());
+            LOG_PRINT("\tSIZE: ");
+            LOG_PRINTLN(file.size());
         }
         file = root.openNextFile();
     }
 }
 
-// Reads the content of a file from the SPIFFS file system
+// Reads the content of a file from the file system
 void readFile(fs::FS &fs, const char *path) {
-    Serial.printf("Reading file: %s\r\n", path);
+    LOG_PRINTF("Reading file: %s\r\n", path);
 
     File file = fs.open(path);
     if (!file || file.isDirectory()) {
-        Serial.println("− failed to open file for reading");
+        LOG_PRINTLN("− failed to open file for reading");
         return;
     }
 
-    Serial.println("− read from file:");
+    LOG_PRINTLN("− read from file:");
     while (file.available()) {
-        Serial.write(file.read());
+        LOG_WRITE(file.read());
     }
 }
 
 void writeFile(fs::FS &fs, const char *path, const char *message) {
-    Serial.printf("Writing file: %s\r\n", path);
+    LOG_PRINTF("Writing file: %s\r\n", path);
 
     File file = fs.open(path, FILE_WRITE);
     if (!file) {
-        Serial.println("− failed to open file for writing");
+        LOG_PRINTLN("− failed to open file for writing");
         return;
     }
     if (file.print(message)) {
-        Serial.println("− file written");
+        LOG_PRINTLN("− file written");
     } else {
-        Serial.println("− frite failed");
+        LOG_PRINTLN("− frite failed");
     }
 }
 
 void appendFile(fs::FS &fs, const char *path, const char *message) {
-    Serial.printf("Appending to file: %s\r\n", path);
+    LOG_PRINTF("Appending to file: %s\r\n", path);
 
     File file = fs.open(path, FILE_APPEND);
     if (!file) {
-        Serial.println("− failed to open file for appending");
+        LOG_PRINTLN("− failed to open file for appending");
         return;
     }
     if (file.print(message)) {
-        Serial.println("− message appended");
+        LOG_PRINTLN("− message appended");
     } else {
-        Serial.println("− append failed");
+        LOG_PRINTLN("− append failed");
     }
 }
 
 void renameFile(fs::FS &fs, const char *path1, const char *path2) {
-    Serial.printf("Renaming file %s to %s\r\n", path1, path2);
+    LOG_PRINTF("Renaming file %s to %s\r\n", path1, path2);
     if (fs.rename(path1, path2)) {
-        Serial.println("− file renamed");
+        LOG_PRINTLN("− file renamed");
     } else {
-        Serial.println("− rename failed");
+        LOG_PRINTLN("− rename failed");
     }
 }
 
 void deleteFile(fs::FS &fs, const char *path) {
-    Serial.printf("Deleting file: %s\r\n", path);
+    LOG_PRINTF("Deleting file: %s\r\n", path);
     if (fs.remove(path)) {
-        Serial.println("− file deleted");
+        LOG_PRINTLN("− file deleted");
     } else {
-        Serial.println("− delete failed");
+        LOG_PRINTLN("− delete failed");
     }
 }
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "metrics.h"
+#include "fmt.h"
+#include <atomic>
+
+struct Histogram {
+    uint32_t buckets[METRIC_BUCKETS + 1];
+    uint32_t count;
+    uint64_t sum;
+    uint32_t max;
+};
+
+static const uint32_t bucketBounds[METRIC_BUCKETS] = METRIC_BUCKET_BOUNDS;
+static const char *const stageNames[STAGE_COUNT] = { "keypad_to_confirm", "rtc_read", "record_format", "flash_append", "lcd_update", "keypad_scan" };
+static const char *const counterNames[COUNTER_COUNT] = { "events_total", "failed_appends_total", "roster_misses_total", "duplicates_total" };
+
+static Histogram histograms[STAGE_COUNT];
+static std::atomic<uint32_t> counters[COUNTER_COUNT];
+
+// Adds one latency observation to a stage's histogram
+void metricsObserve(MetricStage stage, uint32_t micros) {
+    Histogram &h = histograms[stage];
+    uint8_t b = 0;
+    while (b < METRIC_BUCKETS && micros > bucketBounds[b])
+        b++;
+    h.buckets[b]++;
+    h.count++;
+    h.sum += micros;
+    if (micros > h.max)
+        h.max = micros;
+}
+
+void metricsCount(MetricCounter counter, uint32_t n) {
+    counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+uint32_t metricsCounter(MetricCounter counter) {
+    return counters[counter].load(std::memory_order_relaxed);
+}
+
+// Print::printf() goes to the heap for anything past 64 characters, so lines are built on the stack
+static void writeLine(Print &out, const TextWriter &line) {
+    out.write(line.c_str(), line.length());
+}
+
+// Writes one gauge in the Prometheus text format
+void metricsGauge(Print &out, const char *name, const char *help, uint32_t value) {
+    TextBuffer<256> text;
+    text.put("# HELP attendance_").put(name).put(' ').put(help).put('\n');
+    text.put("# TYPE attendance_").put(name).put(" gauge\n");
+    text.put("attendance_").put(name).put(' ').num(value).put('\n');
+    writeLine(out, text);
+}
+
+// Writes all histograms and counters in the Prometheus text format
+void metricsRender(Print &out) {
+    for (uint8_t s = 0; s < STAGE_COUNT; s++) {
+        const Histogram &h = histograms[s];
+        const char *name = stageNames[s];
+        TextBuffer<96> text;
+        text.put("# TYPE attendance_").put(name).put("_us histogram\n");
+        writeLine(out, text);
+        uint32_t cumulative = 0;
+        for (uint8_t b = 0; b <= METRIC_BUCKETS; b++) {
+            cumulative += h.buckets[b];
+            text.clear();
+            text.put("attendance_").put(name).put("_us_bucket{le=\"");
+            if (b < METRIC_BUCKETS)
+                text.num(bucketBounds[b]);
+            else
+                text.put("+Inf");
+            text.put("\"} ").num(cumulative).put('\n');
+            writeLine(out, text);
+        }
+        text.clear();
+        text.put("attendance_").put(name).put("_us_sum ").num64(h.sum).put('\n');
+        writeLine(out, text);
+        text.clear();
+        text.put("attendance_").put(name).put("_us_count ").num(h.count).put('\n');
+        writeLine(out, text);
+        text.clear();
+        text.put("# TYPE attendance_").put(name).put("_us_max gauge\n");
+        writeLine(out, text);
+        text.clear();
+        text.put("attendance_").put(name).put("_us_max ").num(h.max).put('\n');
+        writeLine(out, text);
+    }
+    for (uint8_t c = 0; c < COUNTER_COUNT; c++) {
+        TextBuffer<96> text;
+        text.put("# TYPE attendance_").put(counterNames[c]).put(" counter\n");
+        text.put("attendance_").put(counterNames[c]).put(' ').num(metricsCounter((MetricCounter)c)).put('\n');
+        writeLine(out, text);
+    }
+}
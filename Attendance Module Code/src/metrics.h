@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+
+//----------------------------------------METRICS---------------------------------------
+// In-memory latency histograms and event counters, served as text on /metrics. Counters are bumped
+// from the UI and storage tasks alike, so they are atomic. A histogram is a few plain integer adds:
+// each stage is recorded by one task at a time (the keypad, UI or storage task that owns it;
+// rtc_read under the clock's lock), and a reader on the web server may at worst see a histogram
+// that is one observation behind.
+
+enum MetricStage {
+    STAGE_KEYPAD_TO_CONFIRM,        // first key of a check-in to '#'
+    STAGE_RTC_READ,                 // DS3231 burst read
+    STAGE_RECORD_FORMAT,            // building and sealing a journal record
+    STAGE_FLASH_APPEND,             // writing one batch to the journal
+    STAGE_LCD_UPDATE,               // sending a changed frame to the LCD
+    STAGE_KEYPAD_SCAN,              // CPU time the keypad task spent scanning, per keypress
+    STAGE_COUNT
+};
+
+enum MetricCounter {
+    COUNTER_EVENTS,                 // check-ins handed to storage
+    COUNTER_FAILED_APPENDS,         // check-ins that could not be queued or written
+    COUNTER_ROSTER_MISSES,          // roll numbers not in the roster
+    COUNTER_DUPLICATES,             // arrivals while in or departures while out, turned away
+    COUNTER_COUNT
+};
+
+// Upper bounds of the histogram buckets in microseconds; one more bucket catches everything above
+#define METRIC_BUCKETS 12
+#define METRIC_BUCKET_BOUNDS { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000, 1000000, 5000000 }
+
+void metricsObserve(MetricStage stage, uint32_t micros);
+void metricsCount(MetricCounter counter, uint32_t n = 1);
+uint32_t metricsCounter(MetricCounter counter);
+void metricsRender(Print &out);
+void metricsGauge(Print &out, const char *name, const char *help, uint32_t value);
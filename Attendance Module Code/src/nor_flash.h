@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//----------------------------------------NOR FLASH---------------------------------------
+// A raw region of NOR flash as the ring log (ring_log.h) sees it. Erasing a sector sets every bit
+// to 1; programming can only clear bits, so a byte is written once per erase. Implemented over an
+// ESP32 partition (storage_backend.h) and over a simulated chip by the host benchmark
+// (tools/flashbench).
+
+class NorFlash {
+  public:
+    virtual ~NorFlash() {}
+    virtual uint32_t sectorSize() const = 0;
+    virtual uint32_t sectorCount() const = 0;
+    virtual bool read(uint32_t addr, void *buf, size_t len) = 0;
+    virtual bool program(uint32_t addr, const void *buf, size_t len) = 0;
+    virtual bool erase(uint32_t sector) = 0;
+};
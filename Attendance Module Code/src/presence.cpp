@@ -0,0 +1,272 @@
+#include "presence.h"
+#include "epoch.h"
+#include "fmt.h"
+#include <memory>
+
+#define PRESENCE_MAGIC 0x53455250UL        // "PRES"
+#define PRESENCE_WORDS ((PRESENCE_CAPACITY + 31) / 32)
+
+// Kept in RAM and written to flash as-is
+struct PresenceState {
+    uint32_t magic;
+    uint32_t day;                          // days since 1970-01-01
+    uint32_t seq;                          // journal records from this sequence number on are not reflected
+    uint16_t present;                      // students in right now
+    uint16_t arrived;                      // students with at least one arrival today
+    uint32_t in[PRESENCE_WORDS];           // bit per roll number: in the building
+    uint32_t seen[PRESENCE_WORDS];         // bit per roll number: arrived today
+    uint32_t firstIn[PRESENCE_CAPACITY];
+    uint32_t lastOut[PRESENCE_CAPACITY];   // 0 until the first departure
+    uint32_t crc;
+};
+
+static PresenceState state;
+static SemaphoreHandle_t presenceLock = nullptr;
+static bool dirty = false;
+static unsigned long lastCheckpoint = 0;
+
+// Only does anything once presenceBegin() has run, so the routes are safe if SPIFFS never mounted
+static void lock() {
+    if (presenceLock)
+        xSemaphoreTake(presenceLock, portMAX_DELAY);
+}
+
+static void unlock() {
+    if (presenceLock)
+        xSemaphoreGive(presenceLock);
+}
+
+static inline bool testBit(const uint32_t *bits, uint16_t n) {
+    return bits[n / 32] & (1UL << (n % 32));
+}
+
+static inline void setBit(uint32_t *bits, uint16_t n) {
+    bits[n / 32] |= 1UL << (n % 32);
+}
+
+static inline void clearBit(uint32_t *bits, uint16_t n) {
+    bits[n / 32] &= ~(1UL << (n % 32));
+}
+
+static void resetDay(PresenceState &s, uint32_t day) {
+    memset(&s, 0, sizeof(s));
+    s.day = day;
+}
+
+// Arrivals are only allowed while out and departures only while in. A roll number beyond
+// PRESENCE_CAPACITY cannot be checked for duplicates, so it is turned away, not let through.
+static bool allowed(uint16_t rollNum, uint8_t event) {
+    if (rollNum >= PRESENCE_CAPACITY)
+        return false;
+    return testBit(state.in, rollNum) == (event == EVENT_DEPARTURE);
+}
+
+static void apply(uint16_t rollNum, uint8_t event, uint32_t timestamp) {
+    if (event == EVENT_ARRIVAL) {
+        setBit(state.in, rollNum);
+        state.present++;
+        if (!testBit(state.seen, rollNum)) {
+            setBit(state.seen, rollNum);
+            state.firstIn[rollNum] = timestamp;
+            state.arrived++;
+        }
+    } else {
+        clearBit(state.in, rollNum);
+        state.present--;
+        state.lastOut[rollNum] = timestamp;
+    }
+}
+
+// Loads the checkpoint if it is from today and replays the records of today's segment written
+// after it; call after journalBegin()
+void presenceBegin(fs::FS &fs, uint32_t today) {
+    if (presenceLock == nullptr)
+        presenceLock = xSemaphoreCreateMutex();
+
+    File file = fs.open(PRESENCE_PATH, FILE_READ);
+    bool valid = file && file.read((uint8_t *)&state, sizeof(state)) == sizeof(state) && state.magic == PRESENCE_MAGIC &&
+                 state.crc == crc32((const uint8_t *)&state, offsetof(PresenceState, crc)) && state.day == today;
+    if (file)
+        file.close();
+    if (!valid)
+        resetDay(state, today);
+
+    SegmentReader segment(fs, today, today);
+    AttendanceRecord rec;
+    while (segment.next(rec)) {
+        if (rec.seq >= state.seq && dayOf(rec.timestamp) == today && allowed(rec.rollNum, rec.event)) {
+            apply(rec.rollNum, rec.event, rec.timestamp);
+            dirty = true;
+        }
+    }
+}
+
+// Checks the event against today's presence, hands it to submit and, if that took it, records it.
+// The check, the hand-off and the update happen under one lock so a checkpoint never sees an event
+// the journal will not get.
+MarkResult presenceMark(uint16_t rollNum, uint8_t event, uint32_t timestamp, EventSink submit) {
+    lock();
+    if (dayOf(timestamp) != state.day)
+        resetDay(state, dayOf(timestamp));
+    MarkResult result = rollNum < PRESENCE_CAPACITY ? MARK_DUPLICATE : MARK_NOT_SAVED;
+    if (allowed(rollNum, event)) {
+        result = submit(timestamp, rollNum, event) ? MARK_SAVED : MARK_NOT_SAVED;
+        if (result == MARK_SAVED) {
+            apply(rollNum, event, timestamp);
+            dirty = true;
+        }
+    }
+    unlock();
+    return result;
+}
+
+bool presenceIsIn(uint16_t rollNum) {
+    return rollNum < PRESENCE_CAPACITY && testBit(state.in, rollNum);
+}
+
+uint16_t presenceCount() {
+    return state.present;
+}
+
+bool presenceCheckpointDue() {
+    return dirty && millis() - lastCheckpoint >= PRESENCE_CHECKPOINT_MS;
+}
+
+// Writes the state to flash. Call from the task that writes the journal, after flushing it: the
+// state is only taken once settled() confirms, under the lock presenceMark() hands events over
+// with, that everything it reflects is committed, so a checkpoint never covers a record a power cut
+// could still lose. The copy is written after the lock is released.
+void presenceCheckpoint(fs::FS &fs, SettledCheck settled) {
+    static PresenceState written;        // only the storage task checkpoints; kept off its stack
+    lock();
+    if (!settled()) {
+        unlock();
+        return;
+    }
+    written = state;
+    written.seq = journalSnapshot().endSeq;
+    dirty = false;
+    unlock();
+    lastCheckpoint = millis();
+
+    written.magic = PRESENCE_MAGIC;
+    written.crc = crc32((const uint8_t *)&written, offsetof(PresenceState, crc));
+    File file = fs.open(PRESENCE_PATH, FILE_WRITE);
+    bool ok = file && file.write((const uint8_t *)&written, sizeof(written)) == sizeof(written);
+    if (file)
+        file.close();
+    if (!ok) {
+        lock();
+        dirty = true;
+        unlock();
+    }
+}
+
+//----------------------------------------JSON---------------------------------------
+// Copies the state so names can be looked up without holding the lock
+static std::unique_ptr<PresenceState> snapshot(uint32_t today) {
+    std::unique_ptr<PresenceState> copy(new PresenceState);
+    lock();
+    if (state.day == today)
+        *copy = state;
+    else
+        resetDay(*copy, today);
+    unlock();
+    return copy;
+}
+
+static void printJsonString(Print &out, const char *text) {
+    out.print('"');
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\')
+            out.print('\\');
+        if ((uint8_t)*text < 0x20) {
+            TextBuffer<7> escape;
+            escape.put("\\u").hex((uint8_t)*text, 4);
+            out.print(escape.c_str());
+        }
+        else
+            out.print(*text);
+    }
+    out.print('"');
+}
+
+static void printJsonTime(Print &out, uint32_t timestamp) {
+    DateTime dt;
+    fromEpoch(timestamp, dt);
+    TextBuffer<11> text;
+    text.put('"').clockTime(dt.hours, dt.minutes, dt.seconds).put('"');
+    out.print(text.c_str());
+}
+
+static void printJsonName(Print &out, NameLookup nameOf, uint16_t rollNum) {
+    char name[64];
+    if (!nameOf(rollNum, name, sizeof(name)))
+        name[0] = '\0';
+    printJsonString(out, name);
+}
+
+// Opens a student's object with the roll field, up to the name
+static void printJsonRoll(Print &out, uint16_t rollNum, bool first) {
+    TextBuffer<24> text;
+    text.put(first ? "{\"roll\":" : ",{\"roll\":").num(rollNum).put(",\"name\":");
+    out.print(text.c_str());
+}
+
+// Opens the object with the date field
+static void printJsonOpen(Print &out, uint32_t day) {
+    DateTime dt;
+    fromEpoch(day * 86400UL, dt);
+    TextBuffer<24> text;
+    text.put("{\"date\":\"").isoDate(dt.year, dt.month, dt.date).put('"');
+    out.print(text.c_str());
+}
+
+// {"date":"2023-05-12","count":2,"present":[{"roll":4,"name":"...","firstIn":"08:01:02"},...]}
+void presenceRenderPresent(Print &out, NameLookup nameOf, uint32_t today) {
+    std::unique_ptr<PresenceState> s = snapshot(today);
+    printJsonOpen(out, today);
+    TextBuffer<32> text;
+    text.put(",\"count\":").num(s->present).put(",\"present\":[");
+    out.print(text.c_str());
+    bool first = true;
+    for (uint16_t roll = 0; roll < PRESENCE_CAPACITY; roll++) {
+        if (!testBit(s->in, roll))
+            continue;
+        printJsonRoll(out, roll, first);
+        printJsonName(out, nameOf, roll);
+        out.print(",\"firstIn\":");
+        printJsonTime(out, s->firstIn[roll]);
+        out.print('}');
+        first = false;
+    }
+    out.print("]}");
+}
+
+// {"date":"2023-05-12","present":2,"arrived":3,"left":1,"students":[{"roll":4,"name":"...",
+// "present":false,"firstIn":"08:01:02","lastOut":"16:30:00"},...]} listing everyone who came today
+void presenceRenderSummary(Print &out, NameLookup nameOf, uint32_t today) {
+    std::unique_ptr<PresenceState> s = snapshot(today);
+    printJsonOpen(out, today);
+    TextBuffer<64> text;
+    text.put(",\"present\":").num(s->present).put(",\"arrived\":").num(s->arrived).put(",\"left\":").num(s->arrived - s->present);
+    text.put(",\"students\":[");
+    out.print(text.c_str());
+    bool first = true;
+    for (uint16_t roll = 0; roll < PRESENCE_CAPACITY; roll++) {
+        if (!testBit(s->seen, roll))
+            continue;
+        printJsonRoll(out, roll, first);
+        printJsonName(out, nameOf, roll);
+        out.print(testBit(s->in, roll) ? ",\"present\":true,\"firstIn\":" : ",\"present\":false,\"firstIn\":");
+        printJsonTime(out, s->firstIn[roll]);
+        out.print(",\"lastOut\":");
+        if (s->lastOut[roll])
+            printJsonTime(out, s->lastOut[roll]);
+        else
+            out.print("null");
+        out.print('}');
+        first = false;
+    }
+    out.print("]}");
+}
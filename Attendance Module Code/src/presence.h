@@ -0,0 +1,30 @@
+#pragma once
+
+#include "FS.h"
+#include "hal.h"
+#include "journal.h"
+#include <Arduino.h>
+
+//----------------------------------------PRESENCE---------------------------------------
+// Who is in the building today: a bit per roll number plus the first arrival and last departure
+// times. Every check-in updates it in O(1) before it is handed to storage, which is also where
+// duplicate arrivals and departures are turned away. The storage task checkpoints it to flash and
+// at boot it is rebuilt from the checkpoint plus the records of today's segment written after it.
+
+#define PRESENCE_PATH "/presence.bin"
+#define PRESENCE_CAPACITY ROLL_LIMIT        // roll numbers tracked: every one the keypad can enter
+#define PRESENCE_CHECKPOINT_MS 30000UL      // at most one checkpoint per interval while check-ins come in
+
+static_assert(PRESENCE_CAPACITY <= 1000, "presence keeps 8 bytes of times per roll number in RAM");
+
+typedef bool (*EventSink)(uint32_t timestamp, uint16_t rollNum, uint8_t event);
+typedef bool (*SettledCheck)();        // true once every event handed to the sink is committed to the journal
+
+void presenceBegin(fs::FS &fs, uint32_t today);
+MarkResult presenceMark(uint16_t rollNum, uint8_t event, uint32_t timestamp, EventSink submit);
+bool presenceIsIn(uint16_t rollNum);
+uint16_t presenceCount();
+bool presenceCheckpointDue();
+void presenceCheckpoint(fs::FS &fs, SettledCheck settled);
+void presenceRenderPresent(Print &out, NameLookup nameOf, uint32_t today);
+void presenceRenderSummary(Print &out, NameLookup nameOf, uint32_t today);
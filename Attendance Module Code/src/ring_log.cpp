@@ -0,0 +1,181 @@
+#include "ring_log.h"
+
+static bool headerValid(const RingSectorHeader &header) {
+    return header.magic == RING_MAGIC && header.check == ~header.epoch;
+}
+
+static bool headerBlank(const RingSectorHeader &header) {
+    return header.magic == 0xffffffff && header.epoch == 0xffffffff && header.eraseCount == 0xffffffff && header.check == 0xffffffff;
+}
+
+RingLog::RingLog(NorFlash &flash) : flash(flash) {}
+
+bool RingLog::readHeader(uint32_t sector, RingSectorHeader &header) {
+    probes++;
+    return flash.read(sector * flash.sectorSize(), &header, sizeof(header));
+}
+
+bool RingLog::slotBlank(uint32_t sector, uint32_t slot) {
+    uint8_t unit[RING_UNIT];
+    probes++;
+    if (!flash.read(address(sector, slot), unit, sizeof(unit)))
+        return false;
+    for (uint8_t b : unit) {
+        if (b != 0xff)
+            return false;
+    }
+    return true;
+}
+
+// Erases the sector for an epoch. The sector leaves the log (begin() moves past it) before the
+// erase starts, which is what readers check against.
+bool RingLog::eraseSector(uint32_t epoch) {
+    uint32_t sector = epoch % sectors;
+    RingSectorHeader old;
+    // A sector whose header was lost takes its neighbour's count, which is at most one off
+    uint32_t erases = headErases;
+    if (readHeader(sector, old) && headerValid(old))
+        erases = old.eraseCount;
+    preparedErases = erases + 1;
+
+    if (epoch + 1 >= sectors)
+        first = (epoch + 1 - sectors) * slots;
+    return flash.erase(sector);
+}
+
+// Gives the sector for an epoch its header, making it the newest
+bool RingLog::startSector(uint32_t epoch) {
+    if (!(prepared && epoch == headEpoch + 1) && !eraseSector(epoch))
+        return false;
+    prepared = false;
+    RingSectorHeader header = { RING_MAGIC, epoch, preparedErases, ~epoch };
+    if (!flash.program((epoch % sectors) * flash.sectorSize(), &header, sizeof(header)))
+        return false;
+    headEpoch = epoch;
+    headErases = preparedErases;
+    return true;
+}
+
+bool RingLog::prepare() {
+    if (prepared || sectors == 0)
+        return true;
+    prepared = eraseSector(headEpoch + 1);
+    return prepared;
+}
+
+bool RingLog::mount() {
+    probes = 0;
+    prepared = false;        // a blank sector may be left from an erase that was cut short
+    sectors = flash.sectorCount();
+    slots = flash.sectorSize() / RING_UNIT - 1;
+    if (sectors < 2 || slots == 0)
+        return false;
+
+    RingSectorHeader header;
+    uint32_t base = 0;
+    if (!readHeader(0, header))
+        return false;
+    if (!headerValid(header)) {
+        // A blank sector 0 next to a valid sector 1 means a power cut came between erasing sector 0
+        // and writing its header as the log wrapped; the previous lap carries on from sector 1.
+        // Anything else is not a log yet.
+        base = 1;
+        if (!headerBlank(header) || !readHeader(1, header) || !headerValid(header)) {
+            headEpoch = 0;
+            headErases = 0;
+            first = last = 0;
+            return startSector(0);
+        }
+    }
+
+    // Epochs rise by one from the base sector up to the newest; past it they drop back to the
+    // previous lap, or the sectors are blank
+    uint32_t baseEpoch = header.epoch;
+    RingSectorHeader newest = header;
+    uint32_t lo = base, hi = sectors;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (!readHeader(mid, header))
+            return false;
+        if (headerValid(header) && header.epoch == baseEpoch + (mid - base)) {
+            lo = mid;
+            newest = header;
+        } else {
+            hi = mid;
+        }
+    }
+    uint32_t head = lo;
+    headEpoch = newest.epoch;
+    headErases = newest.eraseCount;
+
+    // Slots fill in order, so the used ones come first
+    uint32_t slotLo = 0, slotHi = slots;
+    while (slotLo < slotHi) {
+        uint32_t mid = (slotLo + slotHi) / 2;
+        if (slotBlank(head, mid))
+            slotHi = mid;
+        else
+            slotLo = mid + 1;
+    }
+    last = headEpoch * slots + slotLo;
+
+    // The oldest sector is the one after the newest, unless it is still blank from a cut-short wrap
+    uint32_t oldest = 0;
+    if (headEpoch + 1 >= sectors) {
+        oldest = headEpoch + 1 - sectors;
+        if (!readHeader((head + 1) % sectors, header) || !headerValid(header) || header.epoch != oldest)
+            oldest++;
+    }
+    first = oldest * slots;
+    return true;
+}
+
+bool RingLog::append(const void *units, size_t count) {
+    const uint8_t *src = (const uint8_t *)units;
+    while (count > 0) {
+        uint32_t pos = last.load();
+        uint32_t slot = pos - headEpoch * slots;
+        if (slot == slots) {
+            if (!startSector(headEpoch + 1))
+                return false;
+            slot = 0;
+        }
+        size_t n = slots - slot;
+        if (n > count)
+            n = count;
+        bool ok = flash.program(address(headEpoch % sectors, slot), src, n * RING_UNIT);
+        last = pos + n;        // slots a failed program touched cannot be programmed again anyway
+        if (!ok)
+            return false;
+        src += n * RING_UNIT;
+        count -= n;
+    }
+    return true;
+}
+
+size_t RingLog::read(uint32_t &pos, void *units, size_t count) {
+    uint8_t *dst = (uint8_t *)units;
+    size_t done = 0;
+    while (done < count) {
+        uint32_t oldest = first.load();
+        if (pos < oldest)
+            pos = oldest;
+        uint32_t newest = last.load();
+        if (pos >= newest)
+            break;
+        uint32_t slot = pos % slots;
+        size_t n = count - done;
+        if (n > slots - slot)
+            n = slots - slot;
+        if (n > newest - pos)
+            n = newest - pos;
+        if (!flash.read(address((pos / slots) % sectors, slot), dst + done * RING_UNIT, n * RING_UNIT))
+            break;
+        // Recycled while being read: what came back may already be newer units
+        if (first.load() > pos)
+            continue;
+        done += n;
+        pos += n;
+    }
+    return done;
+}
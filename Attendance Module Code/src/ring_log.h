@@ -0,0 +1,72 @@
+#pragma once
+
+#include "nor_flash.h"
+#include <atomic>
+
+//----------------------------------------RING LOG---------------------------------------
+// A circular log of fixed 16 byte units (one journal record each) over a raw flash partition.
+// Every sector starts with a header holding its epoch, the number of sectors started before it
+// since the log was formatted, so a unit's position (epoch * RING_SLOTS + slot) only ever grows.
+// Sectors are used strictly in turn and the oldest one is erased when the log wraps, which
+// spreads erases evenly over the partition; each header also keeps the sector's erase count.
+//
+// At mount the epochs read along the partition rise by one up to the newest sector, so it is
+// found by binary search over the headers, and its first blank slot by binary search over its
+// slots: log2(sectors) + log2(slots) reads, whatever the fill level.
+//
+// One task appends; any task may read. Only depends on <atomic> and nor_flash.h, so it builds
+// the same on the ESP32 and on a desktop.
+
+#define RING_UNIT 16                     // bytes per slot
+#define RING_MAGIC 0x474c5452            // "RTLG"
+
+struct RingSectorHeader {
+    uint32_t magic;
+    uint32_t epoch;
+    uint32_t eraseCount;        // times this sector has been erased
+    uint32_t check;             // ~epoch, so a header cut short by a power loss reads as invalid
+};
+
+static_assert(sizeof(RingSectorHeader) == RING_UNIT, "RingSectorHeader takes exactly one slot");
+
+class RingLog {
+  public:
+    explicit RingLog(NorFlash &flash);
+
+    // Finds the newest unit; flash that holds no log is formatted. Call before anything else,
+    // once the flash is ready.
+    bool mount();
+    // Appends count units. Units whose programming failed are skipped over, not retried in place.
+    bool append(const void *units, size_t count);
+    // Erases the sector the log moves on to next, so no append has to wait for an erase. Its units
+    // leave the log a lap early. Call from the appending task when it is idle.
+    bool prepare();
+    // Copies up to count units from pos on and advances pos past them. Units overwritten before
+    // or while they were read are skipped; stops at end().
+    size_t read(uint32_t &pos, void *units, size_t count);
+
+    uint32_t begin() const { return first.load(); }        // position of the oldest unit still on flash
+    uint32_t end() const { return last.load(); }           // one past the newest unit
+    uint32_t slotsPerSector() const { return slots; }
+    uint32_t capacity() const { return slots * sectors; }
+    uint32_t wear() const { return headErases; }           // erase count of the newest sector
+    uint32_t mountReads() const { return probes; }         // flash reads the last mount() made
+
+  private:
+    bool readHeader(uint32_t sector, RingSectorHeader &header);
+    bool slotBlank(uint32_t sector, uint32_t slot);
+    bool eraseSector(uint32_t epoch);
+    bool startSector(uint32_t epoch);
+    uint32_t address(uint32_t sector, uint32_t slot) const { return sector * flash.sectorSize() + (slot + 1) * RING_UNIT; }
+
+    NorFlash &flash;
+    uint32_t sectors = 0;
+    uint32_t slots = 0;                  // data slots per sector, the header takes the first
+    uint32_t headEpoch = 0;
+    uint32_t headErases = 0;
+    uint32_t probes = 0;
+    bool prepared = false;               // the sector after the newest is erased
+    uint32_t preparedErases = 0;         // and the erase count its header will get
+    std::atomic<uint32_t> first{ 0 };
+    std::atomic<uint32_t> last{ 0 };
+};
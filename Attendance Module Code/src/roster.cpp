@@ -0,0 +1,319 @@
+#include "roster.h"
+#include "data.h"
+#include "journal.h"
+
+struct RosterPage {
+    int32_t page = -1;
+    uint32_t lastUsed = 0;
+    uint8_t count = 0;
+    RosterEntry entries[ROSTER_PAGE_ENTRIES];
+};
+
+static fs::FS *rosterFs = nullptr;
+static File rosterFile;
+static uint32_t rosterCount = 0;        // entries in ROSTER_PATH, 0 means the compiled roster is in use
+static uint32_t rosterCrc = 0;
+static RosterPage cache[ROSTER_CACHE_PAGES];
+static uint32_t cacheClock = 0;
+static SemaphoreHandle_t rosterLock = nullptr;
+
+// Returns the number of entries in a roster file, or 0 if it is not a complete roster
+static uint32_t validRoster(File &file, uint32_t *crc = nullptr) {
+    RosterHeader header;
+    if (!file || file.read((uint8_t *)&header, sizeof(header)) != sizeof(header))
+        return 0;
+    if (header.magic != ROSTER_MAGIC || file.size() != sizeof(header) + header.count * sizeof(RosterEntry))
+        return 0;
+    if (crc)
+        *crc = header.crc;
+    return header.count;
+}
+
+// Opens ROSTER_PATH for lookups and empties the page cache; caller holds rosterLock
+static void openRoster() {
+    if (rosterFile)
+        rosterFile.close();
+    for (uint8_t i = 0; i < ROSTER_CACHE_PAGES; i++)
+        cache[i].page = -1;
+    rosterFile = rosterFs->open(ROSTER_PATH, FILE_READ);
+    rosterCrc = 0;
+    rosterCount = validRoster(rosterFile, &rosterCrc);
+    if (rosterCount == 0 && rosterFile)
+        rosterFile.close();
+}
+
+// Replaces ROSTER_PATH with a finished ROSTER_TMP_PATH; caller holds rosterLock
+static void swapInRoster() {
+    if (rosterFile)
+        rosterFile.close();
+    rosterFs->remove(ROSTER_PATH);
+    rosterFs->rename(ROSTER_TMP_PATH, ROSTER_PATH);
+    openRoster();
+}
+
+// Loads the roster from SPIFFS, finishing a swap that a power cut interrupted
+void rosterBegin(fs::FS &fs) {
+    rosterFs = &fs;
+    if (rosterLock == nullptr)
+        rosterLock = xSemaphoreCreateMutex();
+
+    xSemaphoreTake(rosterLock, portMAX_DELAY);
+    if (!fs.exists(ROSTER_PATH) && fs.exists(ROSTER_TMP_PATH)) {
+        File tmp = fs.open(ROSTER_TMP_PATH, FILE_READ);
+        bool complete = validRoster(tmp) > 0;
+        tmp.close();
+        if (complete)
+            swapInRoster();
+    }
+    openRoster();
+    xSemaphoreGive(rosterLock);
+}
+
+// Returns a page of the roster file through the LRU cache; caller holds rosterLock
+static RosterPage *loadPage(uint32_t page) {
+    RosterPage *victim = &cache[0];
+    for (uint8_t i = 0; i < ROSTER_CACHE_PAGES; i++) {
+        if (cache[i].page == (int32_t)page) {
+            cache[i].lastUsed = ++cacheClock;
+            return &cache[i];
+        }
+        if (cache[i].lastUsed < victim->lastUsed)
+            victim = &cache[i];
+    }
+
+    uint32_t first = page * ROSTER_PAGE_ENTRIES;
+    uint32_t count = rosterCount - first < ROSTER_PAGE_ENTRIES ? rosterCount - first : ROSTER_PAGE_ENTRIES;
+    rosterFile.seek(sizeof(RosterHeader) + first * sizeof(RosterEntry));
+    if (rosterFile.read((uint8_t *)victim->entries, count * sizeof(RosterEntry)) != count * sizeof(RosterEntry)) {
+        victim->page = -1;
+        return nullptr;
+    }
+    victim->page = page;
+    victim->count = count;
+    victim->lastUsed = ++cacheClock;
+    return victim;
+}
+
+// Binary searches the roster file page by page; caller holds rosterLock
+static const RosterEntry *findInFile(uint16_t rollNum) {
+    uint32_t lo = 0, hi = (rosterCount + ROSTER_PAGE_ENTRIES - 1) / ROSTER_PAGE_ENTRIES;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        RosterPage *page = loadPage(mid);
+        if (page == nullptr)
+            return nullptr;
+        if (rollNum < page->entries[0].rollNum) {
+            hi = mid;
+        } else if (rollNum > page->entries[page->count - 1].rollNum) {
+            lo = mid + 1;
+        } else {
+            for (uint8_t i = 0; i < page->count; i++) {
+                if (page->entries[i].rollNum == rollNum)
+                    return &page->entries[i];
+            }
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+// Looks a roll number up in the compiled roster (data.h)
+static const char *findCompiled(uint16_t rollNum) {
+    return rosterTableFind(ROSTER_IDS, ROSTER_NAME_OFFSETS, ROSTER_NAMES, ROSTER_SIZE, ROSTER_DENSE, rollNum);
+}
+
+// Copies the name registered for a roll number into name. Returns false (and an empty name)
+// if nobody has that roll number. Safe to call from the web server and loop() at once.
+bool rosterLookup(uint16_t rollNum, char *name, size_t len) {
+    const char *found = nullptr;
+    if (rosterLock)
+        xSemaphoreTake(rosterLock, portMAX_DELAY);
+    if (rosterCount > 0) {
+        const RosterEntry *entry = findInFile(rollNum);
+        if (entry)
+            found = entry->name;
+    } else {
+        found = findCompiled(rollNum);
+    }
+    if (len > 0) {
+        strncpy(name, found ? found : "", len - 1);
+        name[len - 1] = '\0';
+    }
+    if (rosterLock)
+        xSemaphoreGive(rosterLock);
+    return found != nullptr;
+}
+
+uint32_t rosterSize() {
+    return rosterCount > 0 ? rosterCount : ROSTER_SIZE;
+}
+
+uint32_t rosterChecksum() {
+    return rosterCount > 0 ? rosterCrc : 0;
+}
+
+//----------------------------------------ROSTER UPLOAD---------------------------------------
+struct RosterUpload {
+    uint32_t id = 0;
+    File file;
+    char line[96];
+    uint8_t lineLen = 0;
+    uint32_t lineNum = 0;
+    uint32_t count = 0;
+    uint32_t crc = 0;
+    int32_t lastRoll = -1;
+    RosterEntry page[ROSTER_PAGE_ENTRIES];
+    uint8_t pageLen = 0;
+    bool done = false;             // the final chunk was handled
+    char error[64] = "";
+};
+
+static RosterUpload upload;
+
+// Records the first error of an upload and drops the partial file
+static void failUpload(const char *message) {
+    if (upload.error[0] == '\0')
+        snprintf(upload.error, sizeof(upload.error), "Line %u: %s", upload.lineNum, message);
+    if (upload.file) {
+        upload.file.close();
+        rosterFs->remove(ROSTER_TMP_PATH);
+    }
+}
+
+static bool flushUploadPage() {
+    size_t len = upload.pageLen * sizeof(RosterEntry);
+    if (upload.file.write((const uint8_t *)upload.page, len) != len) {
+        failUpload("flash write failed");
+        return false;
+    }
+    upload.crc = crc32((const uint8_t *)upload.page, len, upload.crc);
+    upload.pageLen = 0;
+    return true;
+}
+
+// Parses one "roll,name" line into the page buffer
+static void parseUploadLine() {
+    upload.lineNum++;
+    char *line = upload.line;
+    while (upload.lineLen > 0 && (line[upload.lineLen - 1] == '\r' || line[upload.lineLen - 1] == ' '))
+        upload.lineLen--;
+    line[upload.lineLen] = '\0';
+    if (upload.lineLen == 0 || line[0] == '#')
+        return;
+    if (line[0] < '0' || line[0] > '9') {
+        if (upload.lineNum == 1)
+            return;        // header row
+        failUpload("expected a roll number");
+        return;
+    }
+
+    char *comma = strchr(line, ',');
+    long roll = strtol(line, nullptr, 10);
+    if (comma == nullptr || roll > 65535) {
+        failUpload("expected 'roll,name'");
+        return;
+    }
+    if (roll <= upload.lastRoll) {
+        failUpload("roll numbers must be unique and in ascending order");
+        return;
+    }
+    char *name = comma + 1;
+    while (*name == ' ')
+        name++;
+    size_t nameLen = strlen(name);
+    if (nameLen >= 2 && name[0] == '"' && name[nameLen - 1] == '"') {
+        name[nameLen - 1] = '\0';
+        name++;
+    }
+
+    RosterEntry &entry = upload.page[upload.pageLen++];
+    entry.rollNum = roll;
+    strncpy(entry.name, name, ROSTER_NAME_LEN - 1);
+    entry.name[ROSTER_NAME_LEN - 1] = '\0';
+    upload.lastRoll = roll;
+    upload.count++;
+    if (upload.pageLen == ROSTER_PAGE_ENTRIES)
+        flushUploadPage();
+}
+
+// Starts an upload, dropping one still running, and returns its name
+uint32_t rosterUploadBegin() {
+    uint32_t id = upload.id + 1 ? upload.id + 1 : 1;
+    if (upload.file)
+        upload.file.close();
+    upload = RosterUpload();
+    upload.id = id;
+    upload.file = rosterFs->open(ROSTER_TMP_PATH, FILE_WRITE);
+    RosterHeader header = { ROSTER_MAGIC, 0, 0, 0 };
+    if (!upload.file || upload.file.write((const uint8_t *)&header, sizeof(header)) != sizeof(header))
+        failUpload("cannot create roster file");
+    return id;
+}
+
+// Feeds the next piece of the uploaded CSV; pieces of an upload that was replaced are ignored
+void rosterUploadChunk(uint32_t id, const uint8_t *data, size_t len, bool final) {
+    if (id != upload.id || !upload.file)
+        return;
+
+    for (size_t i = 0; i < len && upload.file; i++) {
+        if (data[i] == '\n') {
+            parseUploadLine();
+            upload.lineLen = 0;
+        } else if (upload.lineLen < sizeof(upload.line) - 1) {
+            upload.line[upload.lineLen++] = data[i];
+        } else {
+            failUpload("line too long");
+        }
+    }
+    if (!final || !upload.file)
+        return;
+
+    if (upload.lineLen > 0)
+        parseUploadLine();
+    if (upload.file && upload.pageLen > 0)
+        flushUploadPage();
+    if (!upload.file)
+        return;
+    upload.file.close();
+    if (upload.count == 0) {
+        failUpload("roster is empty");
+        rosterFs->remove(ROSTER_TMP_PATH);
+        return;
+    }
+
+    // Only now does the header get its count, which is what marks the file as complete
+    upload.file = rosterFs->open(ROSTER_TMP_PATH, "r+");
+    RosterHeader header = { ROSTER_MAGIC, upload.count, upload.crc, 0 };
+    if (!upload.file || upload.file.write((const uint8_t *)&header, sizeof(header)) != sizeof(header)) {
+        failUpload("flash write failed");
+        return;
+    }
+    upload.file.close();
+
+    xSemaphoreTake(rosterLock, portMAX_DELAY);
+    swapInRoster();
+    xSemaphoreGive(rosterLock);
+    upload.done = true;
+}
+
+// Describes how an upload went, returns true if its roster is now in use
+bool rosterUploadResult(uint32_t id, char *message, size_t len) {
+    if (id == 0) {
+        snprintf(message, len, "No roster data received");
+        return false;
+    }
+    if (id != upload.id) {
+        snprintf(message, len, "Replaced by a later upload");
+        return false;
+    }
+    if (upload.error[0] != '\0') {
+        snprintf(message, len, "%s", upload.error);
+        return false;
+    }
+    if (!upload.done) {
+        snprintf(message, len, "Upload incomplete");
+        return false;
+    }
+    snprintf(message, len, "Roster updated: %u students", upload.count);
+    return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "FS.h"
+#include <Arduino.h>
+
+//----------------------------------------ROSTER---------------------------------------
+// The default roster is compiled into flash from roster.csv (see tools/gen_roster.py). A roster
+// uploaded to POST /roster replaces it at runtime: it is kept on SPIFFS as a file of fixed-size
+// entries sorted by roll number and searched a page at a time through a small LRU page cache,
+// so RAM use stays the same however many students there are.
+
+#define ROSTER_PATH "/roster.bin"
+#define ROSTER_TMP_PATH "/roster.tmp"
+#define ROSTER_MAGIC 0x52545352        // "RSTR"
+#define ROSTER_NAME_LEN 30             // including the terminating '\0'
+#define ROSTER_PAGE_ENTRIES 16
+#define ROSTER_CACHE_PAGES 4
+
+struct __attribute__((packed)) RosterHeader {
+    uint32_t magic;
+    uint32_t count;            // written last, so a half-written file is never mistaken for a roster
+    uint32_t crc;              // CRC-32 of the entries; 0 in files from earlier firmware
+    uint32_t reserved;
+};
+
+struct __attribute__((packed)) RosterEntry {
+    uint16_t rollNum;
+    char name[ROSTER_NAME_LEN];
+};
+
+static_assert(sizeof(RosterEntry) == 32, "RosterEntry must stay 32 bytes");
+
+// Looks a roll number up in a table laid out like the compiled roster (data.h): sorted roll
+// numbers, each name's offset into one block of names. Gapless tables are indexed directly,
+// anything else is binary searched.
+inline const char *rosterTableFind(const uint16_t *ids, const uint32_t *offsets, const char *names, size_t size, bool dense,
+                                   uint16_t rollNum) {
+    if (dense) {
+        if (size == 0 || rollNum < ids[0] || rollNum >= ids[0] + size)
+            return nullptr;
+        return names + offsets[rollNum - ids[0]];
+    }
+    size_t lo = 0, hi = size;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (ids[mid] < rollNum) {
+            lo = mid + 1;
+        } else if (ids[mid] > rollNum) {
+            hi = mid;
+        } else {
+            return names + offsets[mid];
+        }
+    }
+    return nullptr;
+}
+
+void rosterBegin(fs::FS &fs);
+bool rosterLookup(uint16_t rollNum, char *name, size_t len);
+uint32_t rosterSize();
+uint32_t rosterChecksum();        // changes with every uploaded roster, 0 for the compiled one
+
+// Streaming upload of a "roll,name" CSV sorted by roll number, fed from an AsyncWebServer
+// upload handler. Only the current line and a page of entries are buffered; the new roster is
+// swapped in at the end, so an upload that stops short leaves the old one in use. Uploads share
+// ROSTER_TMP_PATH, so a new one replaces any still running. rosterUploadBegin() names the upload,
+// and chunks and the result are asked for by that name: a request that sent no body (name 0) or
+// was replaced never reports another upload's outcome.
+uint32_t rosterUploadBegin();
+void rosterUploadChunk(uint32_t upload, const uint8_t *data, size_t len, bool final);
+bool rosterUploadResult(uint32_t upload, char *message, size_t len);
@@ -0,0 +1,108 @@
+#include "rtc.h"
+#include "metrics.h"
+
+static TwoWire *rtcWire = nullptr;
+static uint32_t syncEpoch = 0;           // RTC time at the last burst read
+static unsigned long syncMillis = 0;     // millis() at the last burst read
+static bool synced = false;
+static SemaphoreHandle_t rtcLock = nullptr;      // the UI, storage and archive tasks all read the clock
+
+// Converts a decimal number to Binary Coded Decimal (BCD) format
+uint8_t toBcd(uint8_t num) {
+    uint8_t bcd = ((num / 10) << 4) + (num % 10);
+    return bcd;
+}
+
+// Converts a BCD number to decimal format
+uint8_t fromBcd(uint8_t bcd) {
+    uint8_t num = (10 * ((bcd & 0xf0) >> 4)) + (bcd & 0x0f);
+    return num;
+}
+
+void clockBegin(TwoWire &wire) {
+    if (rtcLock == nullptr)
+        rtcLock = xSemaphoreCreateMutex();
+    rtcWire = &wire;
+    synced = false;
+    clockSync();
+}
+
+// Reads seconds through year (registers 0x00-0x06) in a single I2C transaction and restarts interpolation
+static bool readRegisters() {
+    uint32_t started = micros();
+    uint8_t regs[7];
+    rtcWire->beginTransmission(DS3231_ADDR);
+    rtcWire->write((uint8_t)DS3231_SECONDS);
+    if (rtcWire->endTransmission(false) != 0)
+        return false;
+    if (rtcWire->requestFrom(DS3231_ADDR, (int)sizeof(regs)) != sizeof(regs))
+        return false;
+    for (uint8_t i = 0; i < sizeof(regs); i++)
+        regs[i] = rtcWire->read();
+
+    syncEpoch = toEpoch(2000 + fromBcd(regs[DS3231_DEC_YEAR]), fromBcd(regs[DS3231_CEN_MONTH] & 0x1f), fromBcd(regs[DS3231_DATE] & 0x3f),
+                        fromBcd(regs[DS3231_HOURS] & 0x3f), fromBcd(regs[DS3231_MINUTES] & 0x7f), fromBcd(regs[DS3231_SECONDS] & 0x7f));
+    syncMillis = millis();
+    synced = true;
+    metricsObserve(STAGE_RTC_READ, micros() - started);
+    return true;
+}
+
+bool clockSync() {
+    xSemaphoreTake(rtcLock, portMAX_DELAY);
+    bool ok = readRegisters();
+    xSemaphoreGive(rtcLock);
+    return ok;
+}
+
+// Returns the current time as seconds since 1970-01-01, touching the I2C bus only when a resync is due
+uint32_t clockNow() {
+    xSemaphoreTake(rtcLock, portMAX_DELAY);
+    unsigned long elapsed = millis() - syncMillis;
+    if (!synced || elapsed >= CLOCK_RESYNC_MS) {
+        if (readRegisters())
+            elapsed = 0;
+    }
+    uint32_t now = syncEpoch + elapsed / 1000;
+    xSemaphoreGive(rtcLock);
+    return now;
+}
+
+// Fills in the current date and time
+void clockFields(DateTime &dt) {
+    fromEpoch(clockNow(), dt);
+}
+
+// Sets the RTC in one burst write and resyncs the service to it
+void clockSet(const DateTime &dt) {
+    xSemaphoreTake(rtcLock, portMAX_DELAY);
+    rtcWire->beginTransmission(DS3231_ADDR);
+    rtcWire->write((uint8_t)DS3231_SECONDS);
+    rtcWire->write(toBcd(dt.seconds));
+    rtcWire->write(toBcd(dt.minutes));
+    rtcWire->write(toBcd(dt.hours));
+    rtcWire->write(toBcd(dt.weekday));
+    rtcWire->write(toBcd(dt.date));
+    rtcWire->write(toBcd(dt.month));
+    rtcWire->write(toBcd(dt.year % 100));
+    rtcWire->endTransmission();
+    synced = readRegisters();
+    xSemaphoreGive(rtcLock);
+}
+
+// Reads the DS3231's on-chip temperature sensor, in degrees Celsius
+float clockTemperature() {
+    xSemaphoreTake(rtcLock, portMAX_DELAY);
+    rtcWire->beginTransmission(DS3231_ADDR);
+    rtcWire->write((uint8_t)DS3231_TEMP_MSB);
+    rtcWire->endTransmission(false);
+    float celsius = NAN;
+    if (rtcWire->requestFrom(DS3231_ADDR, 2) == 2) {
+        // Two statements, as the operands of | may be read in either order
+        uint8_t msb = rtcWire->read();
+        uint8_t lsb = rtcWire->read();
+        celsius = (int8_t)msb + (lsb >> 6) / 4.0f;
+    }
+    xSemaphoreGive(rtcLock);
+    return celsius;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "epoch.h"
+#include <Arduino.h>
+#include <Wire.h>
+
+//----------------------------------------RTC---------------------------------------
+#define DS3231_ADDR 0x68
+#define DS3231_SECONDS 0x00
+#define DS3231_MINUTES 0x01
+#define DS3231_HOURS 0x02
+#define DS3231_DAY 0x03
+#define DS3231_DATE 0x04
+#define DS3231_CEN_MONTH 0x05
+#define DS3231_DEC_YEAR 0x06
+#define DS3231_TEMP_MSB 0x11
+#define DS3231_TEMP_LSB 0x12
+
+// The clock service reads the seven time registers in one I2C burst and then runs off millis(),
+// going back to the DS3231 only every CLOCK_RESYNC_MS to correct for drift.
+#define CLOCK_RESYNC_MS 60000UL
+
+void clockBegin(TwoWire &wire);
+bool clockSync();
+uint32_t clockNow();
+void clockFields(DateTime &dt);
+void clockSet(const DateTime &dt);
+float clockTemperature();
+
+uint8_t toBcd(uint8_t num);
+uint8_t fromBcd(uint8_t bcd);
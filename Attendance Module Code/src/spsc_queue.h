@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+//----------------------------------------SPSC QUEUE---------------------------------------
+// Lock-free bounded queue for exactly one producer and one consumer, which may run on different
+// cores. Capacity must be a power of two; one slot is never used so full and empty can be told
+// apart. Only depends on <atomic>, so it builds the same on the ESP32 and on a desktop.
+
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+  public:
+    // Producer side. Returns false without blocking if the queue is full.
+    bool push(const T &item) {
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        size_t next = (head + 1) & (N - 1);
+        if (next == tailIndex.load(std::memory_order_acquire))
+            return false;
+        items[head] = item;
+        headIndex.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false without blocking if the queue is empty.
+    bool pop(T &item) {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail == headIndex.load(std::memory_order_acquire))
+            return false;
+        item = items[tail];
+        tailIndex.store((tail + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called from a third thread, exact from either end
+    size_t size() const {
+        return (headIndex.load(std::memory_order_acquire) - tailIndex.load(std::memory_order_acquire)) & (N - 1);
+    }
+
+    bool empty() const { return size() == 0; }
+    static constexpr size_t capacity() { return N - 1; }
+
+  private:
+    T items[N];
+    // Kept on separate cache lines so the two cores do not keep stealing each other's line
+    alignas(32) std::atomic<size_t> headIndex{ 0 };        // written by the producer
+    alignas(32) std::atomic<size_t> tailIndex{ 0 };        // written by the consumer
+};
@@ -0,0 +1,75 @@
+#include "storage.h"
+#include "journal.h"
+#include "log.h"
+#include "metrics.h"
+#include "presence.h"
+#include "rtc.h"
+#include "spsc_queue.h"
+
+static SpscQueue<CheckinEvent, STORAGE_QUEUE_SIZE> checkins;
+static fs::FS *storageFs = nullptr;
+static TaskHandle_t storageTaskHandle = nullptr;
+
+// Nothing queued and nothing waiting in the journal's batch; only meaningful on the storage task
+static bool settled() {
+    return checkins.empty() && journalPending() == 0;
+}
+
+// Drains the queue into the journal, then sleeps until woken by storageSubmit() or the poll interval
+static void storageTask(void *) {
+    CheckinEvent ev;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(STORAGE_POLL_MS));
+        while (checkins.pop(ev)) {
+            if (ev.event == STORAGE_COMMIT) {
+                journalFlush(*storageFs);
+                continue;
+            }
+            if (!journalAppend(*storageFs, ev.timestamp, ev.rollNum, ev.event, ev.grouped)) {
+                LOG_PRINTLN("− failed to append to journal");
+                metricsCount(COUNTER_FAILED_APPENDS);
+            }
+        }
+        journalService(*storageFs, clockNow());
+        if (presenceCheckpointDue() && journalFlush(*storageFs))
+            presenceCheckpoint(*storageFs, settled);
+    }
+}
+
+// Starts the storage task; call after journalBegin()
+void storageBegin(fs::FS &fs) {
+    storageFs = &fs;
+    if (storageTaskHandle == nullptr)
+        xTaskCreatePinnedToCore(storageTask, "storage", STORAGE_TASK_STACK, nullptr, STORAGE_TASK_PRIORITY, &storageTaskHandle, STORAGE_TASK_CORE);
+}
+
+static bool submit(uint32_t timestamp, uint16_t rollNum, uint8_t event, bool grouped) {
+    if (storageTaskHandle == nullptr)
+        return false;
+    CheckinEvent ev = { timestamp, rollNum, event, grouped };
+    if (!checkins.push(ev))
+        return false;
+    xTaskNotifyGive(storageTaskHandle);
+    return true;
+}
+
+// Queues a check-in for the storage task. Returns false if the queue is full (or storage never
+// started), in which case the check-in was not recorded.
+bool storageSubmit(uint32_t timestamp, uint16_t rollNum, uint8_t event) {
+    return submit(timestamp, rollNum, event, false);
+}
+
+// As storageSubmit(), but the check-in waits in the journal's batch for the rest of its group
+bool storageSubmitGrouped(uint32_t timestamp, uint16_t rollNum, uint8_t event) {
+    return submit(timestamp, rollNum, event, true);
+}
+
+// Closes a group: the storage task flushes it as one batch. If this cannot be queued the group is
+// still written, by the journal's idle flush.
+bool storageCommitGroup() {
+    return submit(0, 0, STORAGE_COMMIT, false);
+}
+
+size_t storageQueued() {
+    return checkins.size();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "FS.h"
+#include <Arduino.h>
+
+//----------------------------------------STORAGE TASK---------------------------------------
+// Confirmed check-ins are handed from the UI (Arduino loop task, core 1) to a storage task pinned
+// to core 0 through a lock-free queue. The storage task owns the journal: it appends, batches and
+// flushes, so the keypad never waits for flash.
+//
+// A rush batch (checkin_ui.h) is handed over as a group: storageSubmitGrouped() for each check-in,
+// then storageCommitGroup(), which has the storage task write the group as one journal batch.
+
+#define STORAGE_QUEUE_SIZE 64          // power of two, one slot stays free
+#define STORAGE_TASK_CORE 0
+#define STORAGE_TASK_PRIORITY 1
+#define STORAGE_TASK_STACK 4096
+#define STORAGE_POLL_MS 250            // how often an idle storage task checks for a due flush
+#define STORAGE_COMMIT 0               // event of the queue entry that closes a group
+
+struct CheckinEvent {
+    uint32_t timestamp;
+    uint16_t rollNum;
+    uint8_t event;             // EVENT_ARRIVAL, EVENT_DEPARTURE or STORAGE_COMMIT
+    bool grouped;
+};
+
+void storageBegin(fs::FS &fs);
+bool storageSubmit(uint32_t timestamp, uint16_t rollNum, uint8_t event);
+bool storageSubmitGrouped(uint32_t timestamp, uint16_t rollNum, uint8_t event);
+bool storageCommitGroup();
+size_t storageQueued();
@@ -0,0 +1,72 @@
+#include "storage_backend.h"
+#include "LittleFS.h"
+#include "SPIFFS.h"
+#include "esp_partition.h"
+#include "log.h"
+
+//----------------------------------------FILE SYSTEMS---------------------------------------
+class SpiffsBackend : public StorageBackend {
+  public:
+    const char *name() override { return "spiffs"; }
+    bool begin() override { return SPIFFS.begin(true); }
+    fs::FS &files() override { return SPIFFS; }
+    size_t totalBytes() override { return SPIFFS.totalBytes(); }
+    size_t usedBytes() override { return SPIFFS.usedBytes(); }
+};
+
+class LittleFsBackend : public StorageBackend {
+  public:
+    const char *name() override { return "littlefs"; }
+    bool begin() override { return LittleFS.begin(true); }
+    fs::FS &files() override { return LittleFS; }
+    size_t totalBytes() override { return LittleFS.totalBytes(); }
+    size_t usedBytes() override { return LittleFS.usedBytes(); }
+};
+
+//----------------------------------------RAW PARTITION---------------------------------------
+// The journal partition as NOR flash, through the partition API so writes stay inside it
+class PartitionFlash : public NorFlash {
+  public:
+    bool begin() {
+        part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)JOURNAL_PARTITION_SUBTYPE, JOURNAL_PARTITION_LABEL);
+        return part != nullptr;
+    }
+    uint32_t sectorSize() const override { return SPI_FLASH_SEC_SIZE; }
+    uint32_t sectorCount() const override { return part ? part->size / SPI_FLASH_SEC_SIZE : 0; }
+    bool read(uint32_t addr, void *buf, size_t len) override { return esp_partition_read(part, addr, buf, len) == ESP_OK; }
+    bool program(uint32_t addr, const void *buf, size_t len) override { return esp_partition_write(part, addr, buf, len) == ESP_OK; }
+    bool erase(uint32_t sector) override { return esp_partition_erase_range(part, sector * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE) == ESP_OK; }
+
+  private:
+    const esp_partition_t *part = nullptr;
+};
+
+class RawLogBackend : public SpiffsBackend {
+  public:
+    RawLogBackend() : ring(flash) {}
+    const char *name() override { return "rawlog"; }
+    // Without the partition (an image flashed with the default table) the journal stays on SPIFFS
+    bool begin() override {
+        mounted = flash.begin() && ring.mount();
+        if (!mounted)
+            LOG_PRINTLN("− no journal partition, keeping the journal on SPIFFS");
+        return SpiffsBackend::begin();
+    }
+    RingLog *journalLog() override { return mounted ? &ring : nullptr; }
+
+  private:
+    PartitionFlash flash;
+    RingLog ring;
+    bool mounted = false;
+};
+
+StorageBackend &storageBackend() {
+#if STORAGE_BACKEND == STORAGE_LITTLEFS
+    static LittleFsBackend backend;
+#elif STORAGE_BACKEND == STORAGE_RAWLOG
+    static RawLogBackend backend;
+#else
+    static SpiffsBackend backend;
+#endif
+    return backend;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "FS.h"
+#include "ring_log.h"
+#include <Arduino.h>
+
+//----------------------------------------STORAGE BACKEND---------------------------------------
+// Where the module keeps its data, picked at build time with -DSTORAGE_BACKEND=...:
+//   STORAGE_SPIFFS     everything on SPIFFS, the journal as day segments (the default)
+//   STORAGE_LITTLEFS   the same on LittleFS, which holds up better under constant appends
+//   STORAGE_RAWLOG     the journal as a ring log (ring_log.h) on its own raw partition, "journal"
+//                      in partitions.csv; roster, presence and web files stay on SPIFFS. The ring
+//                      replaces sealing, archiving and retention: the oldest sector is recycled.
+// platformio.ini has an environment for each.
+
+#define STORAGE_SPIFFS 0
+#define STORAGE_LITTLEFS 1
+#define STORAGE_RAWLOG 2
+
+#ifndef STORAGE_BACKEND
+#define STORAGE_BACKEND STORAGE_SPIFFS
+#endif
+
+#define JOURNAL_PARTITION_LABEL "journal"
+#define JOURNAL_PARTITION_SUBTYPE 0x40
+
+class StorageBackend {
+  public:
+    virtual ~StorageBackend() {}
+    virtual const char *name() = 0;
+    virtual bool begin() = 0;                                 // mounts; call once at boot
+    virtual fs::FS &files() = 0;                              // file system for everything but a raw journal
+    virtual RingLog *journalLog() { return nullptr; }         // set when the journal has its own partition
+    virtual size_t totalBytes() = 0;
+    virtual size_t usedBytes() = 0;
+};
+
+StorageBackend &storageBackend();        // the one selected by STORAGE_BACKEND
@@ -0,0 +1,210 @@
+// The archive format (archive.h). A sealed day is compacted and read back through ArchiveReader,
+// which must hand out exactly the records the raw segment held, including the awkward ones: a
+// clock set back, check-ins stamped before the segment's midnight, roll numbers at both ends and
+// a gap in the sequence left by a torn batch. A typical day must shrink to the size the format
+// promises. Then a year of school days is written with the archiver running nightly, and appending
+// on day 365 must cost what it cost on day 1: the same opens, the same bytes and about the same time.
+
+#include "archive.h"
+#include "epoch.h"
+#include "journal.h"
+#include <FS.h>
+#include <algorithm>
+#include <chrono>
+#include <unity.h>
+#include <vector>
+
+static const uint32_t PER_DAY = 200;
+static const uint32_t SAMPLE_DAYS = 10;                // averaged at each end of the year
+static const double MAX_RECORD_BYTES = 5.0;            // "4 or 5 bytes" a typical record
+static const double MAX_SLOWDOWN = 2.0;                // day 365 appends against day 1
+
+static uint32_t firstDay;
+
+static double nowNs() {
+    using namespace std::chrono;
+    return duration<double, std::nano>(steady_clock::now().time_since_epoch()).count();
+}
+
+static std::vector<AttendanceRecord> readRaw(fs::FS &fs, uint32_t day) {
+    char path[32];
+    segmentPath(day, SEGMENT_SEALED, path, sizeof(path));
+    JournalScanner scanner(fs, path);
+    std::vector<AttendanceRecord> records;
+    AttendanceRecord rec;
+    while (scanner.next(rec))
+        records.push_back(rec);
+    return records;
+}
+
+static std::vector<AttendanceRecord> readArchive(fs::FS &fs, uint32_t day) {
+    char path[32];
+    segmentPath(day, SEGMENT_ARCHIVED, path, sizeof(path));
+    ArchiveReader reader;
+    std::vector<AttendanceRecord> records;
+    TEST_ASSERT_TRUE(reader.open(fs, path));
+    AttendanceRecord rec;
+    while (reader.next(rec))
+        records.push_back(rec);
+    return records;
+}
+
+static SegmentInfo segmentOf(fs::FS &fs, uint32_t day) {
+    SegmentInfo info;
+    TEST_ASSERT_TRUE(manifestRead(fs, manifestFindDay(fs, day), info));
+    TEST_ASSERT_EQUAL_UINT32(day, info.day);
+    return info;
+}
+
+// Seals the day's segment, archives it and checks that it reads back unchanged
+static void archiveAndCompare(fs::FS &fs, uint32_t day) {
+    journalFlush(fs);
+    journalService(fs, (day + 1) * 86400UL);
+    std::vector<AttendanceRecord> raw = readRaw(fs, day);
+    TEST_ASSERT_TRUE(raw.size() > 0);
+    TEST_ASSERT_TRUE(archiveSegment(fs, manifestFindDay(fs, day)));
+    TEST_ASSERT_EQUAL(SEGMENT_ARCHIVED, segmentOf(fs, day).state);
+
+    std::vector<AttendanceRecord> archived = readArchive(fs, day);
+    TEST_ASSERT_EQUAL(raw.size(), archived.size());
+    for (size_t i = 0; i < raw.size(); i++) {
+        TEST_ASSERT_TRUE(recordValid(archived[i]));
+        TEST_ASSERT_EQUAL_UINT32(raw[i].seq, archived[i].seq);
+        TEST_ASSERT_EQUAL_UINT32(raw[i].timestamp, archived[i].timestamp);
+        TEST_ASSERT_EQUAL_UINT16(raw[i].rollNum, archived[i].rollNum);
+        TEST_ASSERT_EQUAL_UINT8(raw[i].event, archived[i].event);
+    }
+}
+
+// Appends records of a batch that never got its commit marker, the last one cut short
+static void tearBatch(fs::FS &fs, uint32_t day, uint8_t count) {
+    char path[32];
+    segmentPath(day, SEGMENT_ACTIVE, path, sizeof(path));
+    File file = fs.open(path, FILE_APPEND);
+    TEST_ASSERT_TRUE(file);
+    for (uint8_t i = 0; i < count; i++) {
+        AttendanceRecord rec;
+        rec.timestamp = day * 86400UL + 12 * 3600UL;
+        rec.rollNum = 900 + i;
+        rec.event = EVENT_ARRIVAL;
+        rec.flags = 0;
+        rec.seq = journalNextSeq() + i;
+        rec.crc = crc32((const uint8_t *)&rec, offsetof(AttendanceRecord, crc));
+        file.write((const uint8_t *)&rec, i + 1 < count ? sizeof(rec) : 7);
+    }
+    file.close();
+}
+
+void setUp(void) {
+    firstDay = dayOf(toEpoch(2024, 1, 1, 0, 0, 0));
+}
+
+void tearDown(void) {}
+
+void test_round_trip_of_awkward_records(void) {
+    fs::FS fs(hostScratchDir());
+    journalBegin(fs);
+    uint32_t day = firstDay + 1;
+    uint32_t midnight = day * 86400UL;
+    journalAppend(fs, midnight + 8 * 3600UL, 1, EVENT_ARRIVAL);
+    journalAppend(fs, midnight + 8 * 3600UL, 65535, EVENT_ARRIVAL);         // same second, widest roll number
+    journalAppend(fs, midnight + 7 * 3600UL, 0, EVENT_DEPARTURE);           // clock set back an hour
+    journalAppend(fs, midnight - 5, 42, EVENT_ARRIVAL);                     // before the segment's midnight
+    journalAppend(fs, midnight + 86399, 43, EVENT_DEPARTURE);               // a day's worth forward
+    journalFlush(fs);
+
+    tearBatch(fs, day, 4);
+    journalBegin(fs);        // the reboot rolls the torn batch back, leaving a gap in seq
+    uint32_t resumed = journalNextSeq();
+    journalAppend(fs, midnight + 9 * 3600UL, 128, EVENT_ARRIVAL);
+    journalAppend(fs, midnight + 9 * 3600UL + 1, 16383, EVENT_DEPARTURE);
+    journalAppend(fs, midnight + 9 * 3600UL + 2, 16384, EVENT_ARRIVAL);    // varint length steps
+    archiveAndCompare(fs, day);
+
+    std::vector<AttendanceRecord> archived = readArchive(fs, day);
+    TEST_ASSERT_EQUAL(8, archived.size());
+    TEST_ASSERT_EQUAL_UINT32(resumed, archived[5].seq);
+    TEST_ASSERT_TRUE(archived[5].seq > archived[4].seq + 1);
+    TEST_ASSERT_EQUAL_UINT32(midnight - 5, archived[3].timestamp);
+}
+
+void test_archive_size_of_a_school_day(void) {
+    fs::FS fs(hostScratchDir());
+    journalBegin(fs);
+    uint32_t day = firstDay + 1;
+    for (uint32_t i = 0; i < PER_DAY; i++)
+        journalAppend(fs, day * 86400UL + 8 * 3600UL + i * 20, i % 180 + 1, i < 150 ? EVENT_ARRIVAL : EVENT_DEPARTURE);
+    journalFlush(fs);
+    journalService(fs, (day + 1) * 86400UL);
+    uint32_t rawBytes = segmentOf(fs, day).bytes;
+    archiveAndCompare(fs, day);
+    uint32_t archiveBytes = segmentOf(fs, day).bytes;
+
+    double perRecord = (double)(archiveBytes - sizeof(ArchiveHeader)) / PER_DAY;
+    char summary[120];
+    snprintf(summary, sizeof(summary), "%u records: raw segment %u B, archive %u B, %.2f B per record", PER_DAY, rawBytes,
+             archiveBytes, perRecord);
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_TRUE_MESSAGE(perRecord <= MAX_RECORD_BYTES, "archive larger than the format promises");
+    TEST_ASSERT_TRUE(archiveBytes * 3 < rawBytes);
+}
+
+struct DayCost {
+    double nsPerRecord;
+    uint32_t opens;
+    uint64_t bytesWritten;
+};
+
+// One school day appended and flushed, then midnight seals it and the archiver runs; only the
+// appending is measured
+static DayCost writeDay(fs::FS &fs, uint32_t day) {
+    fs.stats.reset();
+    double started = nowNs();
+    for (uint32_t i = 0; i < PER_DAY; i++)
+        journalAppend(fs, day * 86400UL + 8 * 3600UL + i * 30, i % 180 + 1, i < 150 ? EVENT_ARRIVAL : EVENT_DEPARTURE);
+    journalFlush(fs);
+    DayCost cost = { (nowNs() - started) / PER_DAY, fs.stats.opens, fs.stats.bytesWritten };
+    journalService(fs, (day + 1) * 86400UL);
+    archiveService(fs, day + 1);
+    return cost;
+}
+
+static double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+void test_append_cost_over_a_year(void) {
+    fs::FS fs(hostScratchDir());
+    journalBegin(fs);
+    std::vector<double> early, late;
+    DayCost first = { 0, 0, 0 }, last = { 0, 0, 0 };
+    for (uint32_t day = 0; day < 365; day++) {
+        DayCost cost = writeDay(fs, firstDay + day);
+        if (day == 0)
+            first = cost;
+        last = cost;
+        if (day < SAMPLE_DAYS)
+            early.push_back(cost.nsPerRecord);
+        else if (day >= 365 - SAMPLE_DAYS)
+            late.push_back(cost.nsPerRecord);
+    }
+    TEST_ASSERT_TRUE(segmentOf(fs, firstDay).state == SEGMENT_ARCHIVED);
+
+    char summary[160];
+    snprintf(summary, sizeof(summary), "append: day 1 %.0f ns/record, %u opens, %llu B; day 365 %.0f ns/record, %u opens, %llu B",
+             median(early), first.opens, (unsigned long long)first.bytesWritten, median(late), last.opens,
+             (unsigned long long)last.bytesWritten);
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_EQUAL_UINT32(first.opens, last.opens);
+    TEST_ASSERT_EQUAL_UINT64(first.bytesWritten, last.bytesWritten);
+    TEST_ASSERT_TRUE_MESSAGE(median(late) <= median(early) * MAX_SLOWDOWN, "appending slows down as the log grows");
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_of_awkward_records);
+    RUN_TEST(test_archive_size_of_a_school_day);
+    RUN_TEST(test_append_cost_over_a_year);
+    return UNITY_END();
+}
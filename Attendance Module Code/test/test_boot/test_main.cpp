@@ -0,0 +1,169 @@
+// The staged boot (boot.h) with its slow half stalled. setup() is replayed on the simulated
+// keypad, display and clock, and the boot task is started as main.cpp starts it, except that
+// mounting storage and bringing up WiFi each hang until the test lets them go. The keypad must be
+// live within INTERACTIVE_BUDGET_MS of the reset and answer every key within KEY_BUDGET_US while
+// both are stalled; a check-in confirmed meanwhile waits for storage and is saved, not lost; once
+// storage is up, check-ins are saved at full speed while WiFi is still down.
+//
+// The tests run in order through one boot.
+
+#include "boot.h"
+#include "checkin_ui.h"
+#include "hal_sim.h"
+#include "journal.h"
+#include "presence.h"
+#include "rtc.h"
+#include "storage.h"
+#include <FS.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unity.h>
+
+static const uint32_t INTERACTIVE_BUDGET_MS = 100;
+static const uint32_t KEY_BUDGET_US = 2000;
+static const uint32_t STALL_MS = 300;
+
+static std::atomic<bool> storageReady{ false };
+static std::atomic<bool> networkReady{ false };
+static fs::FS *storageFs;
+static uint32_t resetMs;
+
+static double wallUs() {
+    using namespace std::chrono;
+    return duration<double, std::micro>(steady_clock::now().time_since_epoch()).count();
+}
+
+// As main.cpp's: names only once the boot task has loaded the roster
+static bool uiLookup(uint16_t rollNum, char *name, size_t len) {
+    bootWait(BOOT_ROSTER);
+    snprintf(name, len, "Student %u", rollNum);
+    return rollNum >= 1 && rollNum <= 99;
+}
+
+// Esp32Store's rules: nothing is marked before presence is rebuilt
+class BootStore : public AttendanceStore {
+  public:
+    MarkResult markAttendance(uint16_t rollNum, uint32_t timestamp) override { return mark(rollNum, EVENT_ARRIVAL, timestamp); }
+    MarkResult markDeparture(uint16_t rollNum, uint32_t timestamp) override { return mark(rollNum, EVENT_DEPARTURE, timestamp); }
+    void markArrivals(BatchEntry *entries, uint8_t count) override {
+        for (uint8_t i = 0; i < count; i++)
+            entries[i].result = mark(entries[i].rollNum, EVENT_ARRIVAL, entries[i].timestamp);
+    }
+    bool checkedIn(uint16_t rollNum) override { return bootWait(BOOT_PRESENCE, 0) && presenceIsIn(rollNum); }
+
+  private:
+    MarkResult mark(uint16_t rollNum, uint8_t event, uint32_t timestamp) {
+        if (!bootWait(BOOT_PRESENCE))
+            return MARK_NOT_SAVED;
+        return presenceMark(rollNum, event, timestamp, storageSubmit);
+    }
+};
+
+static SimClock uiClock;
+static SimKeypad keypad;
+static SimDisplay lcd;
+static BootStore store;
+static SimNetwork network;
+static CheckinUi ui(keypad, lcd, uiClock, store, network, uiLookup);
+
+// main.cpp's deferredBoot(), with a mount and a WiFi start that hang
+static void stalledBoot() {
+    while (!storageReady)
+        delay(1);
+    bootMark(BOOT_STORAGE);
+    bootMark(BOOT_ROSTER);
+    journalBegin(*storageFs);
+    bootMark(BOOT_JOURNAL);
+    presenceBegin(*storageFs, dayOf(clockNow()));
+    storageBegin(*storageFs);
+    bootMark(BOOT_PRESENCE);
+    while (!networkReady)
+        delay(1);
+    bootMark(BOOT_NETWORK, network.begin());
+    bootMark(BOOT_WEB);
+}
+
+// One key through the UI; returns how long the poll took
+static double press(char key) {
+    uiClock.ms += 300;
+    keypad.keys.push_back(key);
+    double started = wallUs();
+    ui.poll();
+    return wallUs() - started;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_keypad_live_while_storage_stalls(void) {
+    resetMs = millis();
+    storageFs = new fs::FS(hostScratchDir());
+    // main.cpp's setup()
+    Wire.regs[DS3231_HOURS] = toBcd(7);
+    Wire.regs[DS3231_DATE] = toBcd(2);
+    Wire.regs[DS3231_CEN_MONTH] = toBcd(9);
+    Wire.regs[DS3231_DEC_YEAR] = toBcd(24);
+    clockBegin(Wire);
+    bootMark(BOOT_CLOCK);
+    bootMark(BOOT_DISPLAY);
+    bootMark(BOOT_KEYPAD);
+    uiClock.start = clockNow();
+    ui.begin();
+    bootMark(BOOT_INTERACTIVE);
+    bootDefer(stalledBoot);
+
+    uint32_t interactiveMs = bootMillis(BOOT_INTERACTIVE) - resetMs;
+    double slowest = 0;
+    slowest = std::max(slowest, press('*'));
+    TEST_ASSERT_TRUE(lcd.shows("Enter Your RNum"));
+    slowest = std::max(slowest, press('4'));
+    slowest = std::max(slowest, press('2'));
+    TEST_ASSERT_TRUE(lcd.shows("42"));
+    TEST_ASSERT_EQUAL_UINT32(0, bootMillis(BOOT_STORAGE));
+
+    char summary[100];
+    snprintf(summary, sizeof(summary), "interactive %u ms after reset, slowest key %.0f us with storage stalled", interactiveMs, slowest);
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_TRUE_MESSAGE(interactiveMs <= INTERACTIVE_BUDGET_MS, "keypad not live within budget");
+    TEST_ASSERT_TRUE_MESSAGE(slowest <= KEY_BUDGET_US, "keys slow while storage is stalled");
+}
+
+void test_checkin_confirmed_during_stall_waits_and_is_saved(void) {
+    std::thread mount([] {
+        delay(STALL_MS);
+        storageReady = true;
+    });
+    double waited = press('#');
+    mount.join();
+    TEST_ASSERT_TRUE(lcd.shows("Welcome Back"));
+    TEST_ASSERT_TRUE(presenceIsIn(42));
+    TEST_ASSERT_TRUE(waited >= STALL_MS * 1000 / 2);        // it did wait for the boot task
+}
+
+void test_checkins_run_at_full_speed_while_wifi_stalls(void) {
+    double slowest = 0;
+    for (uint16_t roll = 10; roll < 20; roll++) {
+        slowest = std::max(slowest, press('*'));
+        slowest = std::max(slowest, press('0' + roll / 10));
+        slowest = std::max(slowest, press('0' + roll % 10));
+        slowest = std::max(slowest, press('#'));
+        TEST_ASSERT_TRUE(lcd.shows("Welcome Back"));
+        TEST_ASSERT_TRUE(presenceIsIn(roll));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, bootMillis(BOOT_NETWORK));
+    TEST_ASSERT_TRUE_MESSAGE(slowest <= KEY_BUDGET_US, "check-ins slow while WiFi is stalled");
+
+    networkReady = true;
+    TEST_ASSERT_TRUE(bootWait(BOOT_WEB, 1000));
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_keypad_live_while_storage_stalls);
+    RUN_TEST(test_checkin_confirmed_during_stall_waits_and_is_saved);
+    RUN_TEST(test_checkins_run_at_full_speed_while_wifi_stalls);
+    return UNITY_END();
+}
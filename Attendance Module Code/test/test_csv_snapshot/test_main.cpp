@@ -0,0 +1,197 @@
+// /csv downloads during check-ins (journal.h). A writer thread appends and flushes batches the way
+// the storage task does, day after day with segments sealed at midnight and the archiver compacting
+// them on its own thread, while reader threads export the log over and over, each from the snapshot
+// it took when it started, in small odd-sized chunks like a chunked response. Every row of every
+// export must parse and agree with itself, the rows must run without a gap or a repeat, and each
+// export must hold exactly the records its snapshot covered. A snapshot's end and its last
+// timestamp (the download's ETag and Last-Modified) must always belong to the same batch.
+
+#include "archive.h"
+#include "epoch.h"
+#include "journal.h"
+#include <FS.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+static const uint32_t DAYS = 12;
+static const uint32_t PER_DAY = 300;
+static const uint32_t START_SECONDS = 8 * 3600UL;
+static const uint32_t READERS = 2;
+
+static uint32_t firstDay;
+
+static bool nameOf(uint16_t rollNum, char *name, size_t len) {
+    snprintf(name, len, "Student %u", rollNum);
+    return true;
+}
+
+// The i-th check-in of a day: roll number, time and event all follow from i, so a row can be checked on its own
+static void writeCheckin(fs::FS &fs, uint32_t day, uint32_t i) {
+    uint16_t roll = i + 1;
+    journalAppend(fs, day * 86400UL + START_SECONDS + i * 10, roll, roll % 2 ? EVENT_ARRIVAL : EVENT_DEPARTURE);
+}
+
+struct ExportResult {
+    uint32_t rows = 0;
+    uint32_t torn = 0;             // rows that do not parse or disagree with themselves
+    uint32_t outOfOrder = 0;       // a gap or a repeat
+};
+
+// Checks one row and that it follows the previous one; day and i are the position of the last row
+static bool checkRow(const std::string &row, int64_t &day, int64_t &i, ExportResult &result) {
+    unsigned date, month, year, hours, minutes, seconds, roll;
+    char name[32], event[16];
+    int used = 0;
+    if (sscanf(row.c_str(), "%u/%u/%u,%u:%u:%u,%u,%31[^,],%15s%n", &date, &month, &year, &hours, &minutes, &seconds, &roll,
+               name, event, &used) != 9 ||
+        used != (int)row.size())
+        return false;
+    char expectedName[32];
+    nameOf(roll, expectedName, sizeof(expectedName));
+    uint32_t rowDay = dayOf(toEpoch(2000 + year, month, date, 0, 0, 0));
+    uint32_t rowI = roll - 1;
+    if (strcmp(name, expectedName) != 0 || strcmp(event, roll % 2 ? "Arrival" : "Departure") != 0 ||
+        hours * 3600 + minutes * 60 + seconds != START_SECONDS + rowI * 10)
+        return false;
+    bool follows = day < 0 ? rowDay == firstDay && rowI == 0
+                           : (rowDay == day && rowI == i + 1) || (rowDay == day + 1 && rowI == 0 && i + 1 == PER_DAY);
+    result.outOfOrder += !follows;
+    day = rowDay;
+    i = rowI;
+    return true;
+}
+
+// One download: a snapshot, then the CSV read out in chunks and checked row by row
+static ExportResult exportOnce(fs::FS &fs, size_t chunk) {
+    JournalSnapshot snap = journalSnapshot();
+    JournalCsvReader csv(fs, nameOf, JournalQuery(), snap.endSeq);
+    ExportResult result;
+    std::string pending;
+    int64_t day = -1, i = -1;
+    uint8_t buf[256];
+    size_t n;
+    while ((n = csv.read(buf, chunk)) > 0) {
+        pending.append((const char *)buf, n);
+        size_t end;
+        while ((end = pending.find('\n')) != std::string::npos) {
+            result.torn += !checkRow(pending.substr(0, end), day, i, result);
+            result.rows++;
+            pending.erase(0, end + 1);
+        }
+    }
+    result.torn += !pending.empty();        // a row cut short at the end
+    result.outOfOrder += result.rows != snap.endSeq - snap.firstSeq;
+    return result;
+}
+
+void setUp(void) {
+    firstDay = dayOf(toEpoch(2024, 9, 2, 0, 0, 0));
+}
+
+void tearDown(void) {}
+
+void test_exports_during_check_ins_have_no_torn_rows(void) {
+    fs::FS fs(hostScratchDir());
+    journalBegin(fs);
+    std::atomic<bool> done{ false };
+    std::atomic<uint32_t> lastDay{ firstDay };
+
+    std::thread writer([&] {
+        for (uint32_t d = 0; d < DAYS; d++) {
+            for (uint32_t i = 0; i < PER_DAY; i++) {
+                writeCheckin(fs, firstDay + d, i);
+                if (i % 64 == 0)
+                    std::this_thread::yield();        // let the readers interleave mid-day
+            }
+            journalFlush(fs);
+            journalService(fs, (firstDay + d + 1) * 86400UL);
+            lastDay = firstDay + d + 1;
+        }
+        done = true;
+    });
+    std::thread archiver([&] {
+        while (!done) {
+            archiveService(fs, lastDay);
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> readers;
+    std::vector<ExportResult> totals(READERS);
+    std::vector<uint32_t> exports(READERS, 0);
+    for (uint32_t r = 0; r < READERS; r++) {
+        readers.emplace_back([&, r] {
+            // Odd chunk sizes split rows at every possible point
+            size_t chunks[] = { 37, 113, 256 };
+            do {
+                ExportResult one = exportOnce(fs, chunks[exports[r] % 3]);
+                totals[r].rows += one.rows;
+                totals[r].torn += one.torn;
+                totals[r].outOfOrder += one.outOfOrder;
+                exports[r]++;
+            } while (!done);
+        });
+    }
+    writer.join();
+    archiver.join();
+    for (std::thread &reader : readers)
+        reader.join();
+
+    uint32_t rows = 0, torn = 0, outOfOrder = 0, count = 0;
+    for (uint32_t r = 0; r < READERS; r++) {
+        rows += totals[r].rows;
+        torn += totals[r].torn;
+        outOfOrder += totals[r].outOfOrder;
+        count += exports[r];
+    }
+    char summary[120];
+    snprintf(summary, sizeof(summary), "%u exports of %u rows in all during %u check-ins", count, rows, DAYS * PER_DAY);
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+    TEST_ASSERT_TRUE(count >= READERS);
+
+    // Once the writer has stopped, an export holds everything
+    ExportResult last = exportOnce(fs, 256);
+    TEST_ASSERT_EQUAL_UINT32(DAYS * PER_DAY, last.rows);
+    TEST_ASSERT_EQUAL_UINT32(0, last.torn + last.outOfOrder);
+}
+
+void test_snapshot_end_and_time_agree(void) {
+    fs::FS fs(hostScratchDir());
+    journalBegin(fs);
+    uint32_t start = firstDay * 86400UL + START_SECONDS;
+    std::atomic<bool> done{ false };
+
+    // Batches of one, record seq stamped start + seq
+    std::thread writer([&] {
+        for (uint32_t seq = 0; seq < 20000; seq++) {
+            journalAppend(fs, start + seq, seq % 200 + 1, EVENT_ARRIVAL);
+            journalFlush(fs);
+        }
+        done = true;
+    });
+    uint32_t snapshots = 0, mismatched = 0;
+    do {
+        JournalSnapshot snap = journalSnapshot();
+        mismatched += snap.endSeq == 0 ? snap.lastTimestamp != 0 : snap.lastTimestamp != start + snap.endSeq - 1;
+        snapshots++;
+    } while (!done);
+    writer.join();
+
+    char summary[80];
+    snprintf(summary, sizeof(summary), "%u snapshots during 20000 flushes", snapshots);
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_EQUAL_UINT32(0, mismatched);
+    TEST_ASSERT_EQUAL_UINT32(20000, journalSnapshot().endSeq);
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_exports_during_check_ins_have_no_torn_rows);
+    RUN_TEST(test_snapshot_end_and_time_agree);
+    return UNITY_END();
+}
@@ -0,0 +1,179 @@
+// The /csv gzip stream (gzip.h) against zlib. A 100k-row journal is exported through
+// JournalCsvReader twice, once plain and once through GzipStream read in random sized pieces like
+// a chunked response, and the compressed export must inflate to exactly the plain one. The
+// benchmark reports the bytes on the wire and the time spent encoding, host CPU standing in for
+// the device's. Input that does not compress must leave in stored blocks, barely larger than it
+// came in.
+
+#include "archive.h"
+#include "epoch.h"
+#include "gzip.h"
+#include "journal.h"
+#include <FS.h>
+#include <chrono>
+#include <string>
+#include <unity.h>
+#include <zlib.h>
+
+static const uint32_t ROWS = 100000;
+static const uint32_t PER_DAY = 400;
+
+static uint32_t seed;
+
+static uint32_t nextRandom(uint32_t range) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % range;
+}
+
+static double wallMs() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+static bool nameOf(uint16_t rollNum, char *name, size_t len) {
+    snprintf(name, len, "Student %u", rollNum);
+    return true;
+}
+
+// Hands out fixed bytes a line at a time, for input that is not a journal
+class BytesStream : public JournalStream {
+  public:
+    BytesStream(const std::string &bytes) : bytes(bytes) {}
+
+  private:
+    bool nextLine() override {
+        lineLen = bytes.size() - pos < sizeof(line) ? bytes.size() - pos : sizeof(line);
+        memcpy(line, bytes.data() + pos, lineLen);
+        pos += lineLen;
+        linePos = 0;
+        return lineLen > 0;
+    }
+
+    const std::string &bytes;
+    size_t pos = 0;
+};
+
+static std::string readAll(JournalStream &stream) {
+    std::string all;
+    uint8_t buf[512];
+    size_t n;
+    while ((n = stream.read(buf, sizeof(buf))) > 0)
+        all.append((const char *)buf, n);
+    return all;
+}
+
+// Reads the gzip stream the way the web server does, in pieces of any size
+static std::string gzipAll(JournalStream &source) {
+    GzipStream gzip(source);
+    std::string all;
+    uint8_t buf[1500];
+    size_t n;
+    while ((n = gzip.read(buf, 1 + nextRandom(sizeof(buf)))) > 0)
+        all.append((const char *)buf, n);
+    return all;
+}
+
+static bool inflateGzip(const std::string &compressed, std::string &plain) {
+    z_stream z = {};
+    if (inflateInit2(&z, 16 + MAX_WBITS) != Z_OK)
+        return false;
+    z.next_in = (Bytef *)compressed.data();
+    z.avail_in = compressed.size();
+    uint8_t buf[4096];
+    int rc;
+    do {
+        z.next_out = buf;
+        z.avail_out = sizeof(buf);
+        rc = inflate(&z, Z_NO_FLUSH);
+        plain.append((const char *)buf, sizeof(buf) - z.avail_out);
+    } while (rc == Z_OK);
+    bool whole = rc == Z_STREAM_END && z.avail_in == 0;
+    inflateEnd(&z);
+    return whole;
+}
+
+// Compresses bytes and checks they come back; returns the compressed size
+static size_t roundTrip(const std::string &bytes) {
+    BytesStream source(bytes);
+    std::string compressed = gzipAll(source);
+    std::string inflated;
+    TEST_ASSERT_TRUE(inflateGzip(compressed, inflated));
+    TEST_ASSERT_TRUE(inflated == bytes);
+    return compressed.size();
+}
+
+void setUp(void) {
+    seed = 1;
+}
+
+void tearDown(void) {}
+
+void test_export_of_100k_rows_round_trips_through_zlib(void) {
+    fs::FS fs(hostScratchDir());
+    journalBegin(fs);
+    uint32_t firstDay = dayOf(toEpoch(2024, 1, 1, 0, 0, 0));
+    for (uint32_t i = 0; i < ROWS; i++) {
+        uint32_t day = firstDay + i / PER_DAY;
+        uint32_t n = i % PER_DAY;
+        journalAppend(fs, day * 86400UL + 8 * 3600UL + n * 20 + nextRandom(20), n % 200 + 1, n < 200 ? EVENT_ARRIVAL : EVENT_DEPARTURE);
+        if (n == PER_DAY - 1) {
+            journalFlush(fs);
+            journalService(fs, (day + 1) * 86400UL);
+            archiveService(fs, day + 1);
+        }
+    }
+    journalFlush(fs);
+
+    double started = wallMs();
+    JournalCsvReader plainCsv(fs, nameOf);
+    std::string plain = readAll(plainCsv);
+    double plainMs = wallMs() - started;
+
+    started = wallMs();
+    JournalCsvReader gzipCsv(fs, nameOf);
+    std::string compressed = gzipAll(gzipCsv);
+    double gzipMs = wallMs() - started;
+
+    std::string inflated;
+    TEST_ASSERT_TRUE(inflateGzip(compressed, inflated));
+    TEST_ASSERT_EQUAL(plain.size(), inflated.size());
+    TEST_ASSERT_TRUE(inflated == plain);
+
+    char summary[200];
+    snprintf(summary, sizeof(summary), "%u rows: %zu B plain in %.0f ms, %zu B gzip (%.1f%%) in %.0f ms, %.0f ms of it encoding", ROWS,
+             plain.size(), plainMs, compressed.size(), 100.0 * compressed.size() / plain.size(), gzipMs, gzipMs - plainMs);
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_TRUE_MESSAGE(compressed.size() * 10 < plain.size() * 3, "export gzips to more than 30%");
+}
+
+void test_incompressible_input_is_stored(void) {
+    std::string bytes;
+    for (uint32_t i = 0; i < 1 << 20; i++)
+        bytes += (char)nextRandom(256);
+    size_t compressed = roundTrip(bytes);
+    char summary[100];
+    snprintf(summary, sizeof(summary), "%zu random bytes: %zu B gzip", bytes.size(), compressed);
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_TRUE_MESSAGE(compressed <= bytes.size() + bytes.size() / 100 + 18, "random input grew by more than 1%");
+}
+
+void test_runs_mixed_and_empty_input_round_trip(void) {
+    TEST_ASSERT_EQUAL(20, roundTrip(""));        // header, one empty block, trailer
+    TEST_ASSERT_TRUE(roundTrip(std::string(100000, 'x')) < 1000);
+
+    // Text and noise alternating, so block after block switches between fixed and stored
+    std::string mixed;
+    for (uint32_t part = 0; part < 40; part++) {
+        for (uint32_t i = 0, size = 1 + nextRandom(9000); i < size; i++)
+            mixed += part % 2 ? (char)nextRandom(256) : "02/09/24,08:00:00,42,Student 42,Arrival\n"[i % 40];
+    }
+    TEST_ASSERT_TRUE(roundTrip(mixed) < mixed.size());
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_export_of_100k_rows_round_trips_through_zlib);
+    RUN_TEST(test_incompressible_input_is_stored);
+    RUN_TEST(test_runs_mixed_and_empty_input_round_trip);
+    return UNITY_END();
+}
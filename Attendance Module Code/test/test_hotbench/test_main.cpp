@@ -0,0 +1,33 @@
+// The hot path benchmarks of tools/hotbench (hotbench.h) held to tools/hotbench/budget.txt, so
+// pio test -e native fails when a change slows one of them past its budget, not only a run by hand.
+// The budget file is found next to this test's source. Each benchmark prints its JSON line as it
+// would from the tool; the fastest of five runs of about 100 ms counts.
+
+#include "../../tools/hotbench/hotbench.h"
+#include <FS.h>
+#include <string>
+#include <unity.h>
+
+// tools/hotbench/budget.txt, found from where this file was compiled
+static std::string budgetPath() {
+    std::string path = __FILE__;
+    size_t at = path.rfind("test/test_hotbench/");
+    return (at == std::string::npos ? std::string() : path.substr(0, at)) + "tools/hotbench/budget.txt";
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_hot_paths_within_budget(void) {
+    std::map<std::string, double> budget = readBudget(budgetPath().c_str());
+    TEST_ASSERT_TRUE_MESSAGE(!budget.empty(), "no budgets read from tools/hotbench/budget.txt");
+    fs::FS files(hostScratchDir());
+    TEST_ASSERT_TRUE_MESSAGE(runBenches(files, budget, {}), "a benchmark failed or went over budget, see \"ok\":false");
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_hot_paths_within_budget);
+    return UNITY_END();
+}
@@ -0,0 +1,163 @@
+// Batched commits (journal.h): what writing a batch per JOURNAL_FLUSH_THRESHOLD check-ins saves
+// over opening the segment for every one, and what recovery makes of a batch a power cut tore
+// in half. A torn batch is written the way a cut leaves it: valid records with no commit marker,
+// then a record cut short.
+
+#include "epoch.h"
+#include "journal.h"
+#include <FS.h>
+#include <chrono>
+#include <unity.h>
+
+static const uint32_t EVENTS = 20000;
+
+static uint32_t morning;
+
+static double nowNs() {
+    using namespace std::chrono;
+    return duration<double, std::nano>(steady_clock::now().time_since_epoch()).count();
+}
+
+static AttendanceRecord sealed(uint32_t timestamp, uint16_t rollNum, uint32_t seq) {
+    AttendanceRecord rec;
+    rec.timestamp = timestamp;
+    rec.rollNum = rollNum;
+    rec.event = EVENT_ARRIVAL;
+    rec.flags = 0;
+    rec.seq = seq;
+    rec.crc = crc32((const uint8_t *)&rec, offsetof(AttendanceRecord, crc));
+    return rec;
+}
+
+// Appends records of a batch that never got its commit marker, the last one cut short
+static void tearBatch(fs::FS &fs, uint32_t day, uint32_t firstSeq, uint8_t count) {
+    char path[32];
+    segmentPath(day, SEGMENT_ACTIVE, path, sizeof(path));
+    File file = fs.open(path, FILE_APPEND);
+    TEST_ASSERT_TRUE(file);
+    for (uint8_t i = 0; i < count; i++) {
+        AttendanceRecord rec = sealed(day * 86400UL + 9 * 3600UL + i, 500 + i, firstSeq + i);
+        file.write((const uint8_t *)&rec, i + 1 < count ? sizeof(rec) : 7);
+    }
+    file.close();
+}
+
+static uint32_t readAll(fs::FS &fs, uint32_t &lastSeq) {
+    SegmentReader reader(fs);
+    AttendanceRecord rec;
+    uint32_t count = 0;
+    while (reader.next(rec)) {
+        TEST_ASSERT_TRUE(rec.rollNum < 500);
+        if (count > 0)
+            TEST_ASSERT_TRUE(rec.seq > lastSeq);
+        lastSeq = rec.seq;
+        count++;
+    }
+    return count;
+}
+
+void setUp(void) {
+    morning = toEpoch(2024, 9, 2, 8, 0, 0);
+}
+
+void tearDown(void) {}
+
+void test_batched_commits_against_per_event_opens(void) {
+    fs::FS single(hostScratchDir());
+    journalBegin(single);
+    single.stats.reset();
+    double started = nowNs();
+    for (uint32_t i = 0; i < EVENTS; i++) {
+        journalAppend(single, morning + i, i % 400 + 1, EVENT_ARRIVAL);
+        TEST_ASSERT_TRUE(journalFlush(single));
+    }
+    double singleNs = (nowNs() - started) / EVENTS;
+    double singleOpens = (double)single.stats.opens / EVENTS;
+
+    fs::FS batched(hostScratchDir());
+    journalBegin(batched);
+    batched.stats.reset();
+    started = nowNs();
+    for (uint32_t i = 0; i < EVENTS; i++)
+        journalAppend(batched, morning + i, i % 400 + 1, EVENT_ARRIVAL);
+    TEST_ASSERT_TRUE(journalFlush(batched));
+    double batchedNs = (nowNs() - started) / EVENTS;
+    double batchedOpens = (double)batched.stats.opens / EVENTS;
+
+    char summary[160];
+    snprintf(summary, sizeof(summary), "per event %.2f opens %.0f B %.0f ns, batched %.3f opens %.0f B %.0f ns", singleOpens,
+             (double)single.stats.bytesWritten / EVENTS, singleNs, batchedOpens, (double)batched.stats.bytesWritten / EVENTS, batchedNs);
+    TEST_MESSAGE(summary);
+
+    uint32_t lastSeq = 0;
+    TEST_ASSERT_EQUAL_UINT32(EVENTS, readAll(batched, lastSeq));
+    TEST_ASSERT_TRUE_MESSAGE(batchedOpens <= 1.0 / JOURNAL_FLUSH_THRESHOLD + 0.01, "more than one open per batch");
+    TEST_ASSERT_TRUE_MESSAGE(singleOpens >= 1.0, "per event path did not open per event");
+    TEST_ASSERT_TRUE_MESSAGE(batchedNs * 2 < singleNs, "batching saves less than half the append time");
+}
+
+void test_torn_batch_is_rolled_back(void) {
+    fs::FS fs(hostScratchDir());
+    journalBegin(fs);
+    for (uint32_t i = 0; i < 3 * JOURNAL_FLUSH_THRESHOLD; i++)
+        journalAppend(fs, morning + i, i + 1, EVENT_ARRIVAL);
+    TEST_ASSERT_EQUAL(0, journalPending());
+    uint32_t committed = journalNextSeq();
+    tearBatch(fs, dayOf(morning), committed, 5);
+
+    // Power comes back
+    journalBegin(fs);
+    TEST_ASSERT_EQUAL_UINT32(committed + 4, journalNextSeq());        // torn sequence numbers are not reused
+    uint32_t lastSeq = 0;
+    TEST_ASSERT_EQUAL_UINT32(3 * JOURNAL_FLUSH_THRESHOLD, readAll(fs, lastSeq));
+    TEST_ASSERT_EQUAL_UINT32(committed - 1, lastSeq);
+
+    char path[32];
+    segmentPath(dayOf(morning), SEGMENT_ACTIVE, path, sizeof(path));
+    File file = fs.open(path, FILE_READ);
+    TEST_ASSERT_EQUAL(0, file.size() % sizeof(AttendanceRecord));
+    file.close();
+
+    // The journal carries on after the rollback marker
+    journalAppend(fs, morning + 100, 42, EVENT_ARRIVAL);
+    TEST_ASSERT_TRUE(journalFlush(fs));
+    TEST_ASSERT_EQUAL_UINT32(3 * JOURNAL_FLUSH_THRESHOLD + 1, readAll(fs, lastSeq));
+    TEST_ASSERT_EQUAL_UINT32(committed + 4, lastSeq);
+
+    // A second boot finds nothing left to repair
+    journalBegin(fs);
+    TEST_ASSERT_EQUAL_UINT32(committed + 5, journalNextSeq());
+    TEST_ASSERT_EQUAL_UINT32(3 * JOURNAL_FLUSH_THRESHOLD + 1, readAll(fs, lastSeq));
+}
+
+void test_segment_holding_only_a_torn_batch(void) {
+    fs::FS fs(hostScratchDir());
+    journalBegin(fs);
+    for (uint32_t i = 0; i < JOURNAL_FLUSH_THRESHOLD; i++)
+        journalAppend(fs, morning + i, i + 1, EVENT_ARRIVAL);
+    uint32_t committed = journalNextSeq();
+
+    // The cut hits the first batch of the next day: its segment is in the manifest, but only
+    // part of the batch reached the file
+    uint32_t nextDay = dayOf(morning) + 1;
+    journalAppend(fs, nextDay * 86400UL + 8 * 3600UL, 1, EVENT_ARRIVAL);
+    TEST_ASSERT_TRUE(journalFlush(fs));
+    char path[32];
+    segmentPath(nextDay, SEGMENT_ACTIVE, path, sizeof(path));
+    File file = fs.open(path, FILE_WRITE);
+    file.close();
+    tearBatch(fs, nextDay, committed, 3);
+
+    journalBegin(fs);
+    uint32_t lastSeq = 0;
+    TEST_ASSERT_EQUAL_UINT32(JOURNAL_FLUSH_THRESHOLD, readAll(fs, lastSeq));
+    TEST_ASSERT_EQUAL_UINT32(committed + 2, journalNextSeq());
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_batched_commits_against_per_event_opens);
+    RUN_TEST(test_torn_batch_is_rolled_back);
+    RUN_TEST(test_segment_holding_only_a_torn_batch);
+    return UNITY_END();
+}
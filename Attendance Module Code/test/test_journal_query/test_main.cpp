@@ -0,0 +1,95 @@
+// Day queries against a growing log (journal.h, archive.h). A year of synthetic check-ins is
+// written a day at a time, with segments sealed at midnight and compacted by the archiver as on the
+// device. Every so often the same one-day /csv query is run and the bytes it reads from flash are
+// counted: they may only grow by the manifest's binary search, however long the log gets. A query
+// for the whole log is measured alongside for contrast.
+
+#include "archive.h"
+#include "epoch.h"
+#include "journal.h"
+#include <FS.h>
+#include <unity.h>
+
+static const uint32_t PER_DAY = 200;
+static const uint32_t QUERY_DAY = 5;        // days into the log
+
+static uint32_t firstDay;
+
+static bool nameOf(uint16_t rollNum, char *name, size_t len) {
+    snprintf(name, len, "Student %u", rollNum);
+    return true;
+}
+
+struct QueryCost {
+    uint64_t bytesRead;
+    uint32_t opens;
+    size_t csvBytes;
+};
+
+// Runs a /csv query to the end and counts the flash it read
+static QueryCost runQuery(fs::FS &fs, const JournalQuery &query) {
+    fs.stats.reset();
+    JournalCsvReader csv(fs, nameOf, query);
+    uint8_t buf[512];
+    size_t total = 0, n;
+    while ((n = csv.read(buf, sizeof(buf))) > 0)
+        total += n;
+    return { fs.stats.bytesRead, fs.stats.opens, total };
+}
+
+// One school day: check-ins from 08:00 on, then midnight seals the segment and the archiver runs
+static void writeDay(fs::FS &fs, uint32_t day) {
+    for (uint32_t i = 0; i < PER_DAY; i++)
+        journalAppend(fs, day * 86400UL + 8 * 3600UL + i * 30, i % 180 + 1, i < 150 ? EVENT_ARRIVAL : EVENT_DEPARTURE);
+    journalFlush(fs);
+    journalService(fs, (day + 1) * 86400UL);
+    archiveService(fs, day + 1);
+}
+
+void setUp(void) {
+    firstDay = dayOf(toEpoch(2024, 1, 1, 0, 0, 0));
+}
+
+void tearDown(void) {}
+
+void test_one_day_query_reads_constant_bytes(void) {
+    static const uint32_t checkpoints[] = { 10, 30, 90, 180, 270, 364 };
+    fs::FS fs(hostScratchDir());
+    journalBegin(fs);
+    JournalQuery oneDay;
+    oneDay.fromDay = oneDay.toDay = firstDay + QUERY_DAY;
+
+    uint32_t day = 0;
+    QueryCost first = { 0, 0, 0 };
+    for (uint32_t until : checkpoints) {
+        for (; day < until; day++)
+            writeDay(fs, firstDay + day);
+        QueryCost cost = runQuery(fs, oneDay);
+        QueryCost all = runQuery(fs, JournalQuery());
+        char summary[160];
+        snprintf(summary, sizeof(summary), "%3u days: one day %llu B read in %u opens, whole log %llu B read", until,
+                 (unsigned long long)cost.bytesRead, cost.opens, (unsigned long long)all.bytesRead);
+        TEST_MESSAGE(summary);
+
+        if (first.bytesRead == 0) {
+            first = cost;
+            TEST_ASSERT_TRUE(first.csvBytes > 0);
+        }
+        TEST_ASSERT_EQUAL(first.csvBytes, cost.csvBytes);
+        TEST_ASSERT_EQUAL_UINT32(first.opens, cost.opens);
+        // Each doubling of the manifest costs each of the query's few binary searches one more
+        // 16 byte entry; nothing else may grow
+        uint32_t doublings = 0;
+        while ((checkpoints[0] << doublings) < until)
+            doublings++;
+        TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(first.bytesRead + 4 * doublings * sizeof(SegmentInfo), cost.bytesRead,
+                                          "one-day query reads grow with the log");
+        TEST_ASSERT_TRUE(all.bytesRead > cost.bytesRead * (until / 2));
+    }
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_one_day_query_reads_constant_bytes);
+    return UNITY_END();
+}
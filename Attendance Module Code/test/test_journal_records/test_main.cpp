@@ -0,0 +1,126 @@
+// The binary journal (journal.h) against the text log it replaced. A few hundred thousand check-ins
+// over most of a year are appended and read back field by field, the CSV rendered from them must
+// match what the old firmware would have written line for line, and the flash traffic and append
+// cost of both paths are compared. The text path is the old firmware's: open the CSV for appending,
+// print one line, close, for every check-in.
+
+#include "epoch.h"
+#include "journal.h"
+#include <FS.h>
+#include <chrono>
+#include <string>
+#include <unity.h>
+
+static const uint32_t DAYS = 300;
+static const uint32_t PER_DAY = 1000;
+static const uint32_t RECORDS = DAYS * PER_DAY;
+
+static uint32_t firstDay;
+
+static bool nameOf(uint16_t, char *name, size_t len) {
+    snprintf(name, len, "Aarav Sharma");
+    return true;
+}
+
+// The i-th synthetic check-in: a thousand a day, 20 s apart from 08:00, every third a departure
+static AttendanceRecord synthetic(uint32_t i) {
+    AttendanceRecord rec;
+    rec.timestamp = (firstDay + i / PER_DAY) * 86400UL + 8 * 3600UL + (i % PER_DAY) * 20;
+    rec.rollNum = (i * 7919) % 600 + 1;
+    rec.event = i % 3 == 0 ? EVENT_DEPARTURE : EVENT_ARRIVAL;
+    rec.flags = 0;
+    rec.seq = i;
+    return rec;
+}
+
+static double nowNs() {
+    using namespace std::chrono;
+    return duration<double, std::nano>(steady_clock::now().time_since_epoch()).count();
+}
+
+void setUp(void) {
+    firstDay = dayOf(toEpoch(2024, 1, 1, 0, 0, 0));
+}
+
+void tearDown(void) {}
+
+void test_round_trip_and_cost_against_text(void) {
+    fs::FS binary(hostScratchDir());
+    journalBegin(binary);
+    binary.stats.reset();
+    double started = nowNs();
+    for (uint32_t i = 0; i < RECORDS; i++) {
+        AttendanceRecord rec = synthetic(i);
+        TEST_ASSERT_TRUE(journalAppend(binary, rec.timestamp, rec.rollNum, rec.event));
+    }
+    TEST_ASSERT_TRUE(journalFlush(binary));
+    double binaryNs = (nowNs() - started) / RECORDS;
+    double binaryBytes = (double)binary.stats.bytesWritten / RECORDS;
+    double binaryOpens = (double)binary.stats.opens / RECORDS;
+
+    // Every record comes back as it went in, in order
+    SegmentReader reader(binary);
+    AttendanceRecord rec;
+    uint32_t count = 0;
+    while (reader.next(rec)) {
+        AttendanceRecord want = synthetic(count);
+        TEST_ASSERT_TRUE(recordValid(rec));
+        TEST_ASSERT_EQUAL_UINT32(want.seq, rec.seq);
+        TEST_ASSERT_EQUAL_UINT32(want.timestamp, rec.timestamp);
+        TEST_ASSERT_EQUAL_UINT16(want.rollNum, rec.rollNum);
+        TEST_ASSERT_EQUAL_UINT8(want.event, rec.event);
+        count++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(RECORDS, count);
+    TEST_ASSERT_EQUAL_UINT32(RECORDS, journalSnapshot().endSeq);
+
+    // The old firmware's text log, one open per check-in
+    fs::FS text(hostScratchDir());
+    started = nowNs();
+    for (uint32_t i = 0; i < RECORDS; i++) {
+        char name[64];
+        char line[112];
+        AttendanceRecord rec = synthetic(i);
+        nameOf(rec.rollNum, name, sizeof(name));
+        size_t len = formatRecordCsv(rec, name, line, sizeof(line));
+        File file = text.open(LEGACY_CSV_PATH, FILE_APPEND);
+        TEST_ASSERT_TRUE(file);
+        TEST_ASSERT_EQUAL(len, file.write((const uint8_t *)line, len));
+        file.close();
+    }
+    double textNs = (nowNs() - started) / RECORDS;
+    double textBytes = (double)text.stats.bytesWritten / RECORDS;
+
+    // /csv renders exactly the text the old firmware stored
+    File legacy = text.open(LEGACY_CSV_PATH, FILE_READ);
+    JournalCsvReader csv(binary, nameOf);
+    uint8_t want[512], got[512];
+    size_t total = 0;
+    for (;;) {
+        size_t n = csv.read(got, sizeof(got));
+        TEST_ASSERT_EQUAL(n, legacy.read(want, n));
+        TEST_ASSERT_EQUAL_MEMORY(want, got, n);
+        total += n;
+        if (n < sizeof(got))
+            break;
+    }
+    TEST_ASSERT_EQUAL(0, legacy.read(want, 1));
+    TEST_ASSERT_EQUAL(legacy.size(), total);
+
+    char summary[200];
+    snprintf(summary, sizeof(summary), "binary %.1f B/record %.3f opens/record %.0f ns/record, text %.1f B/record 1 open/record %.0f ns/record",
+             binaryBytes, binaryOpens, binaryNs, textBytes, textNs);
+    TEST_MESSAGE(summary);
+
+    // 16 bytes a record plus a commit marker per JOURNAL_FLUSH_THRESHOLD and the manifest
+    TEST_ASSERT_TRUE_MESSAGE(binaryBytes <= 16 + 16.0 / JOURNAL_FLUSH_THRESHOLD + 0.5, "binary journal writes more than its records");
+    TEST_ASSERT_TRUE_MESSAGE(binaryBytes < textBytes, "binary journal is not smaller than the text log");
+    TEST_ASSERT_TRUE_MESSAGE(binaryOpens <= 1.0 / JOURNAL_FLUSH_THRESHOLD + 0.01, "binary journal opens a file for too many records");
+    TEST_ASSERT_TRUE_MESSAGE(binaryNs < textNs, "binary append is not cheaper than the text append");
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_and_cost_against_text);
+    return UNITY_END();
+}
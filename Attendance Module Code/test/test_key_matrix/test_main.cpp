@@ -0,0 +1,184 @@
+// Debouncing and ghost rejection (key_matrix.h) against a simulated keypad. The simulated matrix
+// has no diodes, like the real one: a column driven low pulls down every row it reaches through
+// closed keys, so three keys on the corners of a rectangle read as four. Contacts chatter for a
+// few milliseconds after every press and release. The debouncer is fed a scan every
+// KEYPAD_SCAN_MS, as the keypad task does, and must report each press once, in order, within a
+// bounded delay, and never a key that is not there.
+
+#include "key_matrix.h"
+#include <unity.h>
+#include <vector>
+
+static const unsigned long SCAN_MS = 5;           // KEYPAD_SCAN_MS
+static const unsigned long BOUNCE_MS = 8;         // contact chatter after each edge
+static const unsigned long MAX_DELAY_MS = BOUNCE_MS + KEY_DEBOUNCE_MS + 2 * SCAN_MS;
+
+static uint8_t key(uint8_t row, uint8_t col) {
+    return row * KEY_COLS + col;
+}
+
+// Keys held over time intervals, read the way scanMatrix() reads the pins
+class SimMatrix {
+  public:
+    struct Press {
+        uint8_t key;
+        unsigned long down, up;
+    };
+    std::vector<Press> presses;
+
+    void press(uint8_t k, unsigned long down, unsigned long up) { presses.push_back({ k, down, up }); }
+
+    uint16_t scan(unsigned long ms) {
+        // Contacts first: closed while held, chattering just after either edge
+        uint16_t contacts = 0;
+        for (const Press &p : presses) {
+            bool closed = ms >= p.down && ms < p.up;
+            if ((ms >= p.down && ms < p.down + BOUNCE_MS) || (ms >= p.up && ms < p.up + BOUNCE_MS))
+                closed = noise() & 1;
+            if (closed)
+                contacts |= 1 << p.key;
+        }
+        // Then the wiring: rows and columns joined through closed keys, as one net each
+        uint8_t net[KEY_ROWS + KEY_COLS];
+        for (uint8_t n = 0; n < KEY_ROWS + KEY_COLS; n++)
+            net[n] = n;
+        for (uint8_t k = 0; k < KEY_ROWS * KEY_COLS; k++) {
+            if (contacts & (1 << k))
+                join(net, k / KEY_COLS, KEY_ROWS + k % KEY_COLS);
+        }
+        uint16_t raw = 0;
+        for (uint8_t r = 0; r < KEY_ROWS; r++) {
+            for (uint8_t c = 0; c < KEY_COLS; c++) {
+                if (find(net, r) == find(net, KEY_ROWS + c))
+                    raw |= 1 << key(r, c);
+            }
+        }
+        return raw;
+    }
+
+  private:
+    uint32_t seed = 12345;
+
+    uint32_t noise() {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 16;
+    }
+    static uint8_t find(uint8_t *net, uint8_t n) {
+        while (net[n] != n)
+            n = net[n];
+        return n;
+    }
+    static void join(uint8_t *net, uint8_t a, uint8_t b) { net[find(net, a)] = find(net, b); }
+};
+
+struct Reported {
+    uint8_t key;
+    unsigned long at;
+};
+
+// Scans from 0 to until and collects what the debouncer reports
+static std::vector<Reported> run(SimMatrix &matrix, unsigned long until) {
+    KeyDebouncer debouncer;
+    std::vector<Reported> reported;
+    for (unsigned long ms = 0; ms < until; ms += SCAN_MS) {
+        uint16_t pressed = debouncer.update(matrix.scan(ms), ms);
+        for (uint8_t k = 0; k < KEY_ROWS * KEY_COLS; k++) {
+            if (pressed & (1 << k))
+                reported.push_back({ k, ms });
+        }
+    }
+    TEST_ASSERT_TRUE(debouncer.settled());
+    return reported;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_bouncing_key_is_one_press(void) {
+    SimMatrix matrix;
+    matrix.press(key(1, 1), 100, 220);
+    std::vector<Reported> reported = run(matrix, 400);
+    TEST_ASSERT_EQUAL(1, reported.size());
+    TEST_ASSERT_EQUAL_UINT8(key(1, 1), reported[0].key);
+    TEST_ASSERT_LESS_OR_EQUAL(100 + MAX_DELAY_MS, reported[0].at);
+}
+
+void test_glitch_shorter_than_debounce_is_ignored(void) {
+    SimMatrix matrix;
+    matrix.press(key(2, 3), 100, 100 + KEY_DEBOUNCE_MS / 2);
+    TEST_ASSERT_EQUAL(0, run(matrix, 300).size());
+}
+
+void test_rollover_keeps_order(void) {
+    // "42#" typed fast: each key goes down before the last comes up
+    SimMatrix matrix;
+    const uint8_t typed[] = { key(1, 0), key(0, 1), key(3, 2) };
+    for (uint8_t i = 0; i < 3; i++)
+        matrix.press(typed[i], 100 + i * 80, 100 + i * 80 + 120);
+    std::vector<Reported> reported = run(matrix, 600);
+    TEST_ASSERT_EQUAL(3, reported.size());
+    for (uint8_t i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_UINT8(typed[i], reported[i].key);
+        TEST_ASSERT_LESS_OR_EQUAL(100 + i * 80 + MAX_DELAY_MS, reported[i].at);
+    }
+}
+
+void test_ghost_key_is_never_reported(void) {
+    // Three corners of a rectangle held together: the wiring closes the fourth
+    SimMatrix matrix;
+    matrix.press(key(0, 0), 100, 500);
+    matrix.press(key(0, 2), 150, 500);
+    matrix.press(key(2, 0), 200, 500);
+    TEST_ASSERT_TRUE(KeyDebouncer::ghosted(matrix.scan(300)));
+    TEST_ASSERT_TRUE(matrix.scan(300) & (1 << key(2, 2)));        // the phantom is on the pins
+    std::vector<Reported> reported = run(matrix, 800);
+    for (const Reported &r : reported)
+        TEST_ASSERT_TRUE(r.key != key(2, 2));
+    TEST_ASSERT_EQUAL(2, reported.size());        // the third key is lost with the trust in the scan
+    TEST_ASSERT_EQUAL_UINT8(key(0, 0), reported[0].key);
+    TEST_ASSERT_EQUAL_UINT8(key(0, 2), reported[1].key);
+}
+
+void test_two_keys_in_a_row_or_column_are_not_ghosts(void) {
+    TEST_ASSERT_FALSE(KeyDebouncer::ghosted(1 << key(0, 0) | 1 << key(0, 3)));
+    TEST_ASSERT_FALSE(KeyDebouncer::ghosted(1 << key(0, 1) | 1 << key(3, 1)));
+    TEST_ASSERT_FALSE(KeyDebouncer::ghosted(1 << key(0, 0) | 1 << key(1, 1) | 1 << key(2, 2)));
+    TEST_ASSERT_TRUE(KeyDebouncer::ghosted(1 << key(1, 1) | 1 << key(1, 2) | 1 << key(3, 1) | 1 << key(3, 2)));
+}
+
+void test_a_morning_of_keypresses(void) {
+    // One key at a time, held and spaced like real typing, every edge chattering
+    SimMatrix matrix;
+    uint32_t seed = 7;
+    auto next = [&seed](uint32_t range) {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) % range;
+    };
+    std::vector<uint8_t> typed;
+    unsigned long ms = 50;
+    for (int i = 0; i < 5000; i++) {
+        uint8_t k = next(KEY_ROWS * KEY_COLS);
+        unsigned long held = 40 + next(120);
+        matrix.press(k, ms, ms + held);
+        typed.push_back(k);
+        ms += held + 30 + next(270);
+    }
+    std::vector<Reported> reported = run(matrix, ms + 100);
+    TEST_ASSERT_EQUAL(typed.size(), reported.size());
+    for (size_t i = 0; i < typed.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT8(typed[i], reported[i].key);
+        TEST_ASSERT_LESS_OR_EQUAL(matrix.presses[i].down + MAX_DELAY_MS, reported[i].at);
+    }
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bouncing_key_is_one_press);
+    RUN_TEST(test_glitch_shorter_than_debounce_is_ignored);
+    RUN_TEST(test_rollover_keeps_order);
+    RUN_TEST(test_ghost_key_is_never_reported);
+    RUN_TEST(test_two_keys_in_a_row_or_column_are_not_ghosts);
+    RUN_TEST(test_a_morning_of_keypresses);
+    return UNITY_END();
+}
@@ -0,0 +1,256 @@
+// Keystroke to durable record, end to end, faster than real time. The firmware's CheckinUi runs on
+// the simulated keypad, display and clock (hal_sim.h) against the real presence check, storage
+// queue, storage task and journal (on the host's file system and FreeRTOS threads). A scripted
+// morning is replayed on a virtual clock that skips ahead instead of waiting; the storage task
+// sees the same time through millis().
+//
+// Each check-in is timed in stages:
+//   type    first key to #, virtual: how long the student took
+//   mark    # to the check-in queued for storage, wall clock: roster, presence and the hand-off
+//   commit  # to the record on flash, wall clock, for the check-ins that close a batch
+//   wait    # to the record on flash, virtual: how long batching kept it in RAM
+// and each stage is held to a budget below, so a change that slows the path down fails here
+// before it reaches a device. Batching may keep a record in RAM only while fewer than
+// JOURNAL_FLUSH_THRESHOLD check-ins are pending and the keypad has not been idle for the idle flush.
+
+#include "checkin_ui.h"
+#include "hal_sim.h"
+#include "journal.h"
+#include "presence.h"
+#include "rtc.h"
+#include "storage.h"
+#include <FS.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+static const uint32_t MARK_P99_BUDGET_US = 2000;
+static const uint32_t COMMIT_P99_BUDGET_US = 20000;
+static const uint32_t IDLE_BUDGET_MS = JOURNAL_IDLE_FLUSH_MS + 2 * STORAGE_POLL_MS;
+
+static const unsigned long STEP_MS = 100;        // granularity of the virtual clock
+static const unsigned long KEY_MS = 300;         // per keypress
+static const unsigned long NEXT_MS = 1000;       // the next student stepping up
+
+struct Checkin {
+    uint32_t seq;
+    unsigned long firstKeyAt, confirmedAt;        // virtual ms
+    double markUs;
+    double commitUs = -1;                         // only for check-ins that closed a batch
+    long waitMs = -1;
+    uint32_t behind;                              // check-ins confirmed after it while it waited
+    unsigned long quietMs;                        // keypad idle when it reached flash
+};
+
+static std::vector<Checkin> checkins;
+static uint32_t submitted = 0;
+
+static double wallUs() {
+    using namespace std::chrono;
+    return duration<double, std::micro>(steady_clock::now().time_since_epoch()).count();
+}
+
+static bool lookup(uint16_t rollNum, char *name, size_t len) {
+    snprintf(name, len, "Student %u", rollNum);
+    return rollNum >= 1 && rollNum <= 90;
+}
+
+// Esp32Store without the boot stages: presence, then the storage task
+class PipelineStore : public AttendanceStore {
+  public:
+    MarkResult markAttendance(uint16_t rollNum, uint32_t timestamp) override { return mark(rollNum, EVENT_ARRIVAL, timestamp); }
+    MarkResult markDeparture(uint16_t rollNum, uint32_t timestamp) override { return mark(rollNum, EVENT_DEPARTURE, timestamp); }
+    void markArrivals(BatchEntry *entries, uint8_t count) override {
+        for (uint8_t i = 0; i < count; i++)
+            entries[i].result = presenceMark(entries[i].rollNum, EVENT_ARRIVAL, entries[i].timestamp, storageSubmitGrouped);
+        storageCommitGroup();
+    }
+    bool checkedIn(uint16_t rollNum) override { return presenceIsIn(rollNum); }
+
+  private:
+    MarkResult mark(uint16_t rollNum, uint8_t event, uint32_t timestamp) {
+        MarkResult result = presenceMark(rollNum, event, timestamp, storageSubmit);
+        if (result == MARK_SAVED)
+            submitted++;
+        return result;
+    }
+};
+
+struct Door {
+    SimClock clock;
+    SimKeypad keypad;
+    SimDisplay lcd;
+    PipelineStore store;
+    SimNetwork network;
+    CheckinUi ui{ keypad, lcd, clock, store, network, lookup };
+    unsigned long lastConfirm = 0;
+
+    Door() {
+        clock.start = clockNow();
+        ui.begin();
+    }
+
+    // Waits (for real) until the storage task has committed everything up to end
+    bool committed(uint32_t end) {
+        for (double until = wallUs() + 2e6; wallUs() < until;) {
+            if (journalSnapshot().endSeq >= end)
+                return true;
+            std::this_thread::yield();
+        }
+        return false;
+    }
+
+    // Notes the virtual time at which waiting check-ins reached flash
+    void settle() {
+        uint32_t end = journalSnapshot().endSeq;
+        for (Checkin &c : checkins) {
+            if (c.waitMs < 0 && c.seq < end) {
+                c.waitMs = clock.ms - c.confirmedAt;
+                c.behind = submitted - 1 - c.seq;
+                c.quietMs = clock.ms - lastConfirm;
+            }
+        }
+    }
+
+    // Lets virtual time pass; once the keypad has been idle long enough for the journal's idle
+    // flush, gives the storage task the (real) moment it needs to wake up and do it
+    void pass(unsigned long ms) {
+        for (unsigned long until = clock.ms + ms; clock.ms < until;) {
+            clock.ms += STEP_MS;
+            hostAdvanceMillis(STEP_MS);
+            ui.poll();
+            if (journalSnapshot().endSeq < submitted && clock.ms - lastConfirm >= JOURNAL_IDLE_FLUSH_MS)
+                TEST_ASSERT_TRUE_MESSAGE(committed(submitted), "idle flush never came");
+            settle();
+        }
+    }
+
+    void press(char key) {
+        pass(KEY_MS);
+        keypad.keys.push_back(key);
+        ui.poll();
+    }
+
+    void checkIn(char mode, uint16_t rollNum) {
+        pass(NEXT_MS);
+        unsigned long firstKeyAt = clock.ms + KEY_MS;
+        press(mode);
+        char digits[8];
+        snprintf(digits, sizeof(digits), "%0*u", ROLL_DIGITS, rollNum);
+        for (const char *d = digits; *d; d++)
+            press(*d);
+
+        pass(KEY_MS);
+        uint32_t before = submitted;
+        uint32_t flushed = journalSnapshot().endSeq;
+        keypad.keys.push_back('#');
+        double started = wallUs();
+        ui.poll();
+        double marked = wallUs();
+        lastConfirm = clock.ms;
+        if (submitted == before)
+            return;        // turned away, nothing to store
+        // On the device the storage task takes it on the other core straight away; here it first
+        // has to be scheduled, and must be before virtual time moves on
+        while (storageQueued() > 0)
+            std::this_thread::yield();
+        delay(1);
+
+        Checkin c;
+        c.seq = before;
+        c.firstKeyAt = firstKeyAt;
+        c.confirmedAt = clock.ms;
+        c.markUs = marked - started;
+        if (submitted - flushed >= JOURNAL_FLUSH_THRESHOLD) {
+            TEST_ASSERT_TRUE_MESSAGE(committed(submitted), "batch never committed");
+            c.commitUs = wallUs() - started;
+        }
+        checkins.push_back(c);
+        settle();
+    }
+};
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(p * values.size()))];
+}
+
+static void report(const char *stage, const std::vector<double> &values, const char *unit) {
+    char line[120];
+    snprintf(line, sizeof(line), "%-6s n=%-4zu p50 %8.1f  p99 %8.1f  max %8.1f %s", stage, values.size(), percentile(values, 0.5),
+             percentile(values, 0.99), percentile(values, 1.0), unit);
+    TEST_MESSAGE(line);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_keystroke_to_commit(void) {
+    static fs::FS fs(hostScratchDir());        // outlives the test: the storage task keeps using it
+    Wire.regs[DS3231_SECONDS] = toBcd(0);
+    Wire.regs[DS3231_MINUTES] = toBcd(30);
+    Wire.regs[DS3231_HOURS] = toBcd(7);
+    Wire.regs[DS3231_DATE] = toBcd(2);
+    Wire.regs[DS3231_CEN_MONTH] = toBcd(9);
+    Wire.regs[DS3231_DEC_YEAR] = toBcd(24);
+    clockBegin(Wire);
+    journalBegin(fs);
+    presenceBegin(fs, dayOf(clockNow()));
+    storageBegin(fs);
+
+    Door door;
+    double started = wallUs();
+    // The morning queue, a few trying twice, a lull, then some leave early
+    for (uint16_t roll = 1; roll <= 80; roll++) {
+        door.checkIn('*', roll);
+        if (roll % 16 == 0)
+            door.checkIn('*', roll - 3);
+    }
+    door.pass(10000);
+    for (uint16_t roll = 5; roll <= 80; roll += 7) {
+        door.checkIn('D', roll);
+        door.pass(roll * 100);
+    }
+    door.pass(JOURNAL_IDLE_FLUSH_MS + STEP_MS);
+    double realMs = (wallUs() - started) / 1000;
+
+    std::vector<double> type, mark, commit, wait;
+    for (const Checkin &c : checkins) {
+        type.push_back(c.confirmedAt - c.firstKeyAt);
+        mark.push_back(c.markUs);
+        if (c.commitUs >= 0)
+            commit.push_back(c.commitUs);
+        TEST_ASSERT_TRUE_MESSAGE(c.waitMs >= 0, "check-in never reached flash");
+        TEST_ASSERT_TRUE_MESSAGE(c.behind < JOURNAL_FLUSH_THRESHOLD, "a check-in waited past a full batch");
+        TEST_ASSERT_TRUE_MESSAGE(c.quietMs <= IDLE_BUDGET_MS, "a check-in waited past the idle flush");
+        wait.push_back(c.waitMs);
+    }
+    report("type", type, "ms");
+    report("mark", mark, "us");
+    report("commit", commit, "us");
+    report("wait", wait, "ms");
+    char line[120];
+    snprintf(line, sizeof(line), "%zu check-ins, %.0f s of door time replayed in %.1f s", checkins.size(), door.clock.ms / 1000.0,
+             realMs / 1000);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL_UINT32(80 + 11, checkins.size());
+    TEST_ASSERT_EQUAL_UINT32(submitted, journalSnapshot().endSeq);
+    // The morning queue never leaves the keypad idle long enough for an idle flush; the presence
+    // checkpoint flushes first and closes some batches early
+    TEST_ASSERT_TRUE(commit.size() >= (80 + 5) / JOURNAL_FLUSH_THRESHOLD / 2);
+    TEST_ASSERT_TRUE_MESSAGE(percentile(mark, 0.99) <= MARK_P99_BUDGET_US, "mark stage over budget");
+    TEST_ASSERT_TRUE_MESSAGE(percentile(commit, 0.99) <= COMMIT_P99_BUDGET_US, "commit stage over budget");
+    TEST_ASSERT_TRUE_MESSAGE(realMs * 5 < door.clock.ms, "replay not much faster than real time");
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_keystroke_to_commit);
+    return UNITY_END();
+}
@@ -0,0 +1,130 @@
+// I2C traffic of the LCD back buffer (lcd_frame.h). The host's LiquidCrystal_I2C sends what the
+// real library sends over the host's Wire, which counts every byte, and keeps what would be on the
+// glass. Each flush may only send the cells that changed, plus a cursor move per run of them, and
+// the glass must end up showing exactly what was drawn. The check-in UI is driven through the
+// firmware's own Esp32Display for a realistic mix of frames.
+
+#include "checkin_ui.h"
+#include "hal_esp32.h"
+#include "hal_sim.h"
+#include <unity.h>
+
+// One byte to the HD44780 is two nibbles, each three expander writes of address plus data
+static const uint32_t I2C_BYTES_PER_LCD_BYTE = 2 * 3 * 2;
+
+static LiquidCrystal_I2C glass(0x27, 16, 2);
+static LcdFrame frame(glass);
+
+static bool lookup(uint16_t rollNum, char *name, size_t len) {
+    snprintf(name, len, "Student %u", rollNum);
+    return rollNum != 0;
+}
+
+class NullStore : public AttendanceStore {
+  public:
+    MarkResult markAttendance(uint16_t, uint32_t) override { return MARK_SAVED; }
+    MarkResult markDeparture(uint16_t, uint32_t) override { return MARK_SAVED; }
+    void markArrivals(BatchEntry *entries, uint8_t count) override {
+        for (uint8_t i = 0; i < count; i++)
+            entries[i].result = MARK_SAVED;
+    }
+    bool checkedIn(uint16_t) override { return false; }
+};
+
+static uint32_t changedCells(const char before[2][17], const char after[2][17]) {
+    uint32_t n = 0;
+    for (uint8_t r = 0; r < 2; r++) {
+        for (uint8_t c = 0; c < 16; c++)
+            n += before[r][c] != after[r][c];
+    }
+    return n;
+}
+
+// Runs draw, which ends in a flush, and checks the traffic against the cells that changed on the glass
+template <typename Draw> static uint32_t drawAndCheck(Draw draw) {
+    char before[2][17];
+    memcpy(before, glass.screen, sizeof(before));
+    Wire.bytes = 0;
+    draw();
+    uint32_t changed = changedCells(before, glass.screen);
+    // Every run of changed cells costs a cursor move; cells inside a run that did not change are
+    // only rewritten where that is no dearer than moving the cursor past them
+    TEST_ASSERT_LESS_OR_EQUAL(2 * changed * I2C_BYTES_PER_LCD_BYTE, Wire.bytes);
+    TEST_ASSERT_EQUAL_UINT32(0, Wire.bytes % I2C_BYTES_PER_LCD_BYTE);
+    return Wire.bytes;
+}
+
+static uint32_t flushAndCheck() {
+    return drawAndCheck([] { frame.flush(); });
+}
+
+void setUp(void) {
+    frame.begin();
+}
+
+void tearDown(void) {}
+
+void test_unchanged_frame_sends_nothing(void) {
+    frame.print("Mon 2/9/24");
+    frame.setCursor(0, 1);
+    frame.print("* Arr | D Depart");
+    flushAndCheck();
+    frame.clear();
+    frame.print("Mon 2/9/24");
+    frame.setCursor(0, 1);
+    frame.print("* Arr | D Depart");
+    TEST_ASSERT_EQUAL_UINT32(0, flushAndCheck());
+}
+
+void test_one_cell_is_one_move_and_one_write(void) {
+    frame.print("Enter Your RNum");
+    flushAndCheck();
+    frame.setCursor(0, 1);
+    frame.print('4');
+    TEST_ASSERT_EQUAL_UINT32(2 * I2C_BYTES_PER_LCD_BYTE, flushAndCheck());
+    frame.print('2');        // straight after the last cell: no cursor move
+    TEST_ASSERT_EQUAL_UINT32(1 * I2C_BYTES_PER_LCD_BYTE, flushAndCheck());
+    TEST_ASSERT_EQUAL_STRING("42              ", glass.screen[1]);
+}
+
+void test_checkin_frames_against_full_redraws(void) {
+    SimClock clock;
+    SimKeypad keypad;
+    Esp32Display lcd(frame);
+    SimDisplay drawn;
+    NullStore store;
+    SimNetwork network;
+    CheckinUi ui(keypad, lcd, clock, store, network, lookup);
+    CheckinUi mirror(keypad, drawn, clock, store, network, lookup);        // the same frames as text
+    drawAndCheck([&] { ui.begin(); });
+    mirror.begin();
+
+    const char *script = "*42#D42#*0#A12#13#14#A*C";
+    uint32_t frames = 0, bytes = 0;
+    for (const char *key = script; *key; key++) {
+        clock.ms += 300;
+        keypad.keys.push_back(*key);
+        bytes += drawAndCheck([&] { ui.poll(); });
+        keypad.keys.push_back(*key);
+        mirror.poll();
+        frames++;
+        TEST_ASSERT_EQUAL_STRING(drawn.rows[0], glass.screen[0]);
+        TEST_ASSERT_EQUAL_STRING(drawn.rows[1], glass.screen[1]);
+    }
+
+    // The old firmware cleared and rewrote both lines for every change
+    uint32_t fullRedraw = (1 + 16 + 1 + 16) * I2C_BYTES_PER_LCD_BYTE;
+    char summary[120];
+    snprintf(summary, sizeof(summary), "%u frames, %.0f I2C bytes per frame against %u for a full redraw", frames,
+             (double)bytes / frames, fullRedraw);
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_TRUE(bytes * 2 < frames * fullRedraw);
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_unchanged_frame_sends_nothing);
+    RUN_TEST(test_one_cell_is_one_move_and_one_write);
+    RUN_TEST(test_checkin_frames_against_full_redraws);
+    return UNITY_END();
+}
@@ -0,0 +1,104 @@
+// Presence checkpoints (presence.h) against the journal they summarise. Check-ins are handed
+// straight to the journal the way the storage task would, and a power cut is a reboot that loses
+// the batch still in RAM. A checkpoint may only be taken once everything it reflects is committed,
+// so after any cut the rebuilt presence matches the records on flash: nothing lost counted, nothing
+// committed counted twice.
+
+#include "epoch.h"
+#include "journal.h"
+#include "presence.h"
+#include <FS.h>
+#include <unity.h>
+
+static fs::FS *journalFs;
+static uint32_t today;
+
+static bool toJournal(uint32_t timestamp, uint16_t rollNum, uint8_t event) {
+    return journalAppend(*journalFs, timestamp, rollNum, event);
+}
+
+static bool settled() {
+    return journalPending() == 0;
+}
+
+static void arrive(uint16_t first, uint16_t count) {
+    for (uint16_t roll = first; roll < first + count; roll++)
+        TEST_ASSERT_EQUAL(MARK_SAVED, presenceMark(roll, EVENT_ARRIVAL, today * 86400UL + 8 * 3600UL + roll, toJournal));
+}
+
+// A power cut: the pending batch is gone, and both are rebuilt from flash
+static void reboot() {
+    journalBegin(*journalFs);
+    presenceBegin(*journalFs, today);
+}
+
+void setUp(void) {
+    today = dayOf(toEpoch(2024, 9, 2, 0, 0, 0));
+    journalFs = new fs::FS(hostScratchDir());
+    reboot();
+    hostAdvanceMillis(PRESENCE_CHECKPOINT_MS);
+}
+
+void tearDown(void) {
+    delete journalFs;
+}
+
+void test_no_checkpoint_over_pending_records(void) {
+    arrive(1, 3);
+    TEST_ASSERT_TRUE(journalPending() > 0);
+    TEST_ASSERT_TRUE(presenceCheckpointDue());
+    presenceCheckpoint(*journalFs, settled);
+    TEST_ASSERT_FALSE(journalFs->exists(PRESENCE_PATH));
+    TEST_ASSERT_TRUE(presenceCheckpointDue());        // still owed
+
+    reboot();
+    TEST_ASSERT_EQUAL_UINT16(0, presenceCount());
+    TEST_ASSERT_FALSE(presenceIsIn(1));
+}
+
+void test_checkpoint_after_flush_survives_a_cut(void) {
+    arrive(1, 3);
+    TEST_ASSERT_TRUE(journalFlush(*journalFs));
+    presenceCheckpoint(*journalFs, settled);
+    TEST_ASSERT_TRUE(journalFs->exists(PRESENCE_PATH));
+    TEST_ASSERT_FALSE(presenceCheckpointDue());
+
+    arrive(10, 2);        // still in RAM when the power goes
+    reboot();
+    TEST_ASSERT_EQUAL_UINT16(3, presenceCount());
+    TEST_ASSERT_TRUE(presenceIsIn(3));
+    TEST_ASSERT_FALSE(presenceIsIn(10));
+}
+
+void test_records_after_checkpoint_replay_once(void) {
+    arrive(1, 3);
+    TEST_ASSERT_TRUE(journalFlush(*journalFs));
+    presenceCheckpoint(*journalFs, settled);
+    arrive(20, 4);
+    TEST_ASSERT_EQUAL(MARK_SAVED, presenceMark(2, EVENT_DEPARTURE, today * 86400UL + 9 * 3600UL, toJournal));
+    TEST_ASSERT_TRUE(journalFlush(*journalFs));
+
+    reboot();
+    TEST_ASSERT_EQUAL_UINT16(3 + 4 - 1, presenceCount());
+    TEST_ASSERT_FALSE(presenceIsIn(2));
+    TEST_ASSERT_TRUE(presenceIsIn(23));
+}
+
+void test_roll_beyond_capacity_is_turned_away(void) {
+    uint32_t at = today * 86400UL + 8 * 3600UL;
+    TEST_ASSERT_EQUAL(MARK_SAVED, presenceMark(PRESENCE_CAPACITY - 1, EVENT_ARRIVAL, at, toJournal));
+    TEST_ASSERT_EQUAL(MARK_NOT_SAVED, presenceMark(PRESENCE_CAPACITY, EVENT_ARRIVAL, at, toJournal));
+    TEST_ASSERT_EQUAL(MARK_NOT_SAVED, presenceMark(PRESENCE_CAPACITY, EVENT_ARRIVAL, at + 1, toJournal));        // not let through twice either
+    TEST_ASSERT_EQUAL(MARK_NOT_SAVED, presenceMark(65535, EVENT_DEPARTURE, at, toJournal));
+    TEST_ASSERT_EQUAL_UINT32(1, journalPending());
+    TEST_ASSERT_EQUAL_UINT16(1, presenceCount());
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_no_checkpoint_over_pending_records);
+    RUN_TEST(test_checkpoint_after_flush_survives_a_cut);
+    RUN_TEST(test_records_after_checkpoint_replay_once);
+    RUN_TEST(test_roll_beyond_capacity_is_turned_away);
+    return UNITY_END();
+}
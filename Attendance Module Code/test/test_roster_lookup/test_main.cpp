@@ -0,0 +1,318 @@
+// Roster lookups (roster.h) at 30, 1000 and 10000 students against a std::map baseline. The
+// compiled table is built at each size both gapless (indexed directly) and with gaps (binary
+// searched); the uploaded roster goes through POST /roster's parser and is searched through the
+// page cache. Every form must give the same answer as the map for the same roll numbers, one in
+// ten of them unknown. The compiled table is held to the map's speed; the uploaded roster reads
+// flash, so it is held to a bound on the bytes read per lookup instead.
+//
+// A roster of 25000 students is uploaded in TCP segment sized pieces with operator new counting:
+// the upload must allocate no more than one of 1000 students does and the lookups not at all, so
+// RAM stays at the page cache whatever the roster's size. An upload cut off halfway, one that fails
+// on a bad line and a request that sends no body must all leave the roster in use as it was, across
+// a reboot as well, and report failure rather than an earlier upload's success.
+
+#include "roster.h"
+#include <FS.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <new>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+static const uint32_t LOOKUPS = 200000;
+static const int RUNS = 5;
+
+static volatile uint32_t sink;        // keeps results alive
+
+static bool counting = false;
+static uint64_t allocations = 0;
+
+void *operator new(size_t size) {
+    if (counting)
+        allocations++;
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    free(p);
+}
+
+struct Table {
+    std::vector<uint16_t> ids;
+    std::vector<uint32_t> offsets;
+    std::string names;
+    bool dense;
+};
+
+static std::string studentName(uint16_t rollNum) {
+    return "Student Number " + std::to_string(rollNum);
+}
+
+// size students, roll numbers from 1 either gapless or two in three left out
+static Table makeTable(uint32_t size, bool dense) {
+    Table table;
+    table.dense = dense;
+    for (uint32_t i = 0; i < size; i++) {
+        uint16_t rollNum = dense ? i + 1 : i * 3 + 1;
+        table.ids.push_back(rollNum);
+        table.offsets.push_back(table.names.size());
+        table.names += studentName(rollNum);
+        table.names += '\0';
+    }
+    return table;
+}
+
+// Roll numbers to look up: the roster's own, one in ten of them swapped for one nobody has
+static std::vector<uint16_t> makeKeys(const Table &table) {
+    std::vector<uint16_t> keys;
+    uint32_t rng = 1;
+    for (uint32_t i = 0; i < LOOKUPS; i++) {
+        rng = rng * 1103515245 + 12345;
+        uint32_t pick = (rng >> 8) % table.ids.size();
+        keys.push_back(i % 10 == 9 ? table.ids.back() + 1 + pick % 50 : table.ids[pick]);
+    }
+    return keys;
+}
+
+// Best time per lookup out of RUNS passes over the keys
+static double measure(const std::vector<uint16_t> &keys, const std::function<bool(uint16_t, char *, size_t)> &lookup) {
+    double best = 1e300;
+    for (int run = 0; run < RUNS; run++) {
+        auto started = std::chrono::steady_clock::now();
+        char name[ROSTER_NAME_LEN];
+        for (uint16_t key : keys)
+            sink += lookup(key, name, sizeof(name));
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+        best = std::min(best, ns / keys.size());
+    }
+    return best;
+}
+
+static bool copyName(const char *found, char *name, size_t len) {
+    strncpy(name, found ? found : "", len - 1);
+    name[len - 1] = '\0';
+    return found != nullptr;
+}
+
+static std::string rosterCsv(const Table &table) {
+    std::string csv = "roll,name\n";
+    for (size_t i = 0; i < table.ids.size(); i++)
+        csv += std::to_string(table.ids[i]) + "," + (table.names.c_str() + table.offsets[i]) + "\n";
+    return csv;
+}
+
+// Sends the first stop bytes of csv the way POST /roster does, one TCP segment per chunk, and
+// returns the upload's name; the final chunk only goes if stop reaches the end
+static uint32_t sendRoster(const std::string &csv, size_t stop) {
+    uint32_t upload = rosterUploadBegin();
+    for (size_t at = 0; at < stop; at += 1436)
+        rosterUploadChunk(upload, (const uint8_t *)csv.data() + at, std::min<size_t>(1436, stop - at), at + 1436 >= csv.size());
+    return upload;
+}
+
+static bool uploadRoster(const Table &table) {
+    std::string csv = rosterCsv(table);
+    char message[80];
+    return rosterUploadResult(sendRoster(csv, csv.size()), message, sizeof(message)) && rosterSize() == table.ids.size();
+}
+
+// Every student of the table is found under their name
+static void checkRoster(const Table &table) {
+    char name[ROSTER_NAME_LEN];
+    for (size_t i = 0; i < table.ids.size(); i++) {
+        TEST_ASSERT_TRUE(rosterLookup(table.ids[i], name, sizeof(name)));
+        TEST_ASSERT_EQUAL_STRING(table.names.c_str() + table.offsets[i], name);
+    }
+}
+
+static void compareAt(uint32_t size) {
+    Table dense = makeTable(size, true);
+    Table sparse = makeTable(size, false);
+    for (const Table *table : { &dense, &sparse }) {
+        std::map<uint16_t, std::string> baseline;
+        for (size_t i = 0; i < table->ids.size(); i++)
+            baseline[table->ids[i]] = table->names.c_str() + table->offsets[i];
+        std::vector<uint16_t> keys = makeKeys(*table);
+
+        auto mapLookup = [&](uint16_t rollNum, char *name, size_t len) {
+            auto it = baseline.find(rollNum);
+            return copyName(it == baseline.end() ? nullptr : it->second.c_str(), name, len);
+        };
+        auto tableLookup = [&](uint16_t rollNum, char *name, size_t len) {
+            return copyName(rosterTableFind(table->ids.data(), table->offsets.data(), table->names.data(), table->ids.size(),
+                                            table->dense, rollNum),
+                            name, len);
+        };
+
+        fs::FS fs(hostScratchDir());
+        rosterBegin(fs);
+        TEST_ASSERT_TRUE(uploadRoster(*table));
+
+        // Same answers from all three
+        for (uint16_t key : keys) {
+            char want[ROSTER_NAME_LEN], got[ROSTER_NAME_LEN];
+            bool found = mapLookup(key, want, sizeof(want));
+            TEST_ASSERT_EQUAL(found, tableLookup(key, got, sizeof(got)));
+            TEST_ASSERT_EQUAL_STRING(want, got);
+            TEST_ASSERT_EQUAL(found, rosterLookup(key, got, sizeof(got)));
+            TEST_ASSERT_EQUAL_STRING(want, got);
+        }
+
+        double mapNs = measure(keys, mapLookup);
+        double tableNs = measure(keys, tableLookup);
+        fs.stats.reset();
+        double pagedNs = measure(keys, rosterLookup);
+        double pagedBytes = (double)fs.stats.bytesRead / (RUNS * keys.size());
+
+        char summary[160];
+        snprintf(summary, sizeof(summary), "%5u %s: std::map %.1f ns, compiled table %.1f ns, uploaded %.1f ns and %.0f B read per lookup",
+                 size, table->dense ? "gapless" : "gaps   ", mapNs, tableNs, pagedNs, pagedBytes);
+        TEST_MESSAGE(summary);
+
+        // Indexing beats the map outright; a binary search does the map's comparisons without its
+        // pointer chasing but also without its luck with the branch predictor on tiny rosters
+        TEST_ASSERT_TRUE_MESSAGE(tableNs <= mapNs * (table->dense ? 1.0 : 1.5), "compiled table slower than std::map");
+        // A lookup loads at most one page per step of the binary search over the pages
+        uint32_t pages = (size + ROSTER_PAGE_ENTRIES - 1) / ROSTER_PAGE_ENTRIES, steps = 1;
+        while ((1u << steps) < pages)
+            steps++;
+        TEST_ASSERT_TRUE_MESSAGE(pagedBytes <= steps * ROSTER_PAGE_ENTRIES * sizeof(RosterEntry), "uploaded roster reads too much flash per lookup");
+    }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_roster_of_30(void) {
+    compareAt(30);
+}
+
+void test_roster_of_1000(void) {
+    compareAt(1000);
+}
+
+void test_roster_of_10000(void) {
+    compareAt(10000);
+}
+
+void test_upload_of_25000_stays_in_bounded_ram(void) {
+    fs::FS fs(hostScratchDir());
+    rosterBegin(fs);
+    Table small = makeTable(1000, false);
+    Table large = makeTable(25000, true);
+    std::string smallCsv = rosterCsv(small), largeCsv = rosterCsv(large);
+    char message[80];
+
+    allocations = 0;
+    counting = true;
+    uint32_t upload = sendRoster(smallCsv, smallCsv.size());
+    counting = false;
+    uint64_t smallAllocations = allocations;
+    TEST_ASSERT_TRUE(rosterUploadResult(upload, message, sizeof(message)));
+
+    allocations = 0;
+    counting = true;
+    upload = sendRoster(largeCsv, largeCsv.size());
+    counting = false;
+    uint64_t largeAllocations = allocations;
+    TEST_ASSERT_TRUE(rosterUploadResult(upload, message, sizeof(message)));
+    TEST_ASSERT_EQUAL(large.ids.size(), rosterSize());
+
+    // Every student once, then keys at random with misses among them
+    std::vector<uint16_t> keys = makeKeys(large);
+    checkRoster(large);
+    fs.stats.reset();
+    allocations = 0;
+    counting = true;
+    char name[ROSTER_NAME_LEN];
+    for (uint16_t key : keys)
+        sink += rosterLookup(key, name, sizeof(name));
+    counting = false;
+    double bytesPerLookup = (double)fs.stats.bytesRead / keys.size();
+
+    char summary[160];
+    snprintf(summary, sizeof(summary), "%u students: %zu B of CSV, %llu allocations uploading (%llu for 1000), %llu in %u lookups, %.0f B read per lookup",
+             25000u, largeCsv.size(), (unsigned long long)largeAllocations, (unsigned long long)smallAllocations, (unsigned long long)allocations,
+             LOOKUPS, bytesPerLookup);
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_TRUE_MESSAGE(largeAllocations <= smallAllocations, "upload allocates with the roster's size");
+    TEST_ASSERT_TRUE_MESSAGE(allocations == 0, "lookups allocate");
+    // A page per step of the binary search at most, as for the smaller rosters
+    uint32_t pages = (large.ids.size() + ROSTER_PAGE_ENTRIES - 1) / ROSTER_PAGE_ENTRIES, steps = 1;
+    while ((1u << steps) < pages)
+        steps++;
+    TEST_ASSERT_TRUE_MESSAGE(bytesPerLookup <= steps * ROSTER_PAGE_ENTRIES * sizeof(RosterEntry), "uploaded roster reads too much flash per lookup");
+}
+
+void test_cut_off_upload_leaves_old_roster(void) {
+    fs::FS fs(hostScratchDir());
+    rosterBegin(fs);
+    Table old = makeTable(100, true);
+    TEST_ASSERT_TRUE(uploadRoster(old));
+    uint32_t checksum = rosterChecksum();
+    char message[80];
+
+    // The connection drops halfway through a 25000 student roster
+    std::string csv = rosterCsv(makeTable(25000, true));
+    uint32_t cutOff = sendRoster(csv, csv.size() / 2);
+    TEST_ASSERT_FALSE(rosterUploadResult(cutOff, message, sizeof(message)));
+    TEST_ASSERT_EQUAL_STRING("Upload incomplete", message);
+    TEST_ASSERT_EQUAL(old.ids.size(), rosterSize());
+    TEST_ASSERT_EQUAL(checksum, rosterChecksum());
+    checkRoster(old);
+
+    // A later upload replaces it; its pieces arriving after that are ignored
+    std::string bad = "roll,name\n5,Five\n3,Three\n";
+    uint32_t failed = sendRoster(bad, bad.size());
+    rosterUploadChunk(cutOff, (const uint8_t *)csv.data(), csv.size(), true);
+    TEST_ASSERT_FALSE(rosterUploadResult(cutOff, message, sizeof(message)));
+    TEST_ASSERT_EQUAL_STRING("Replaced by a later upload", message);
+    TEST_ASSERT_FALSE(rosterUploadResult(failed, message, sizeof(message)));
+    TEST_ASSERT_EQUAL_STRING("Line 3: roll numbers must be unique and in ascending order", message);
+    TEST_ASSERT_EQUAL(checksum, rosterChecksum());
+
+    // A request without a body is not told about the last upload
+    TEST_ASSERT_TRUE(uploadRoster(old));
+    TEST_ASSERT_FALSE(rosterUploadResult(0, message, sizeof(message)));
+    TEST_ASSERT_EQUAL_STRING("No roster data received", message);
+
+    // Cut off again, then reboot: the half-written file is not taken for a roster
+    checksum = rosterChecksum();
+    sendRoster(csv, csv.size() / 2);
+    rosterBegin(fs);
+    TEST_ASSERT_EQUAL(old.ids.size(), rosterSize());
+    TEST_ASSERT_EQUAL(checksum, rosterChecksum());
+    checkRoster(old);
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_roster_of_30);
+    RUN_TEST(test_roster_of_1000);
+    RUN_TEST(test_roster_of_10000);
+    RUN_TEST(test_upload_of_25000_stays_in_bounded_ram);
+    RUN_TEST(test_cut_off_upload_leaves_old_roster);
+    return UNITY_END();
+}
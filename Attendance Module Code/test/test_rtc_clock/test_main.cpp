@@ -0,0 +1,125 @@
+// The clock service (rtc.h) against the host's TwoWire, which answers for a DS3231 from a register
+// file and counts every transaction on the bus. Between resyncs the time must come from millis()
+// alone; each resync must be one burst read of the seven time registers; and however many tasks
+// ask for the time at once, a resync happens once. The temperature register pair reads MSB first.
+
+#include "rtc.h"
+#include <atomic>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+// A burst read: the register pointer written, then seven bytes read back
+static const uint32_t BURST_TRANSACTIONS = 2;
+static const uint32_t BURST_BYTES = 2 + 1 + 7;        // address and pointer, address and data
+
+static TwoWire bus;
+
+static void setRtc(uint16_t year, uint8_t month, uint8_t date, uint8_t hours, uint8_t minutes, uint8_t seconds) {
+    bus.regs[DS3231_SECONDS] = toBcd(seconds);
+    bus.regs[DS3231_MINUTES] = toBcd(minutes);
+    bus.regs[DS3231_HOURS] = toBcd(hours);
+    bus.regs[DS3231_DATE] = toBcd(date);
+    bus.regs[DS3231_CEN_MONTH] = toBcd(month);
+    bus.regs[DS3231_DEC_YEAR] = toBcd(year % 100);
+}
+
+static void resetCounters() {
+    bus.transactions = 0;
+    bus.bytes = 0;
+}
+
+void setUp(void) {
+    setRtc(2024, 9, 2, 8, 0, 0);
+    clockBegin(bus);
+    resetCounters();
+}
+
+void tearDown(void) {}
+
+void test_begin_is_one_burst_read(void) {
+    setRtc(2024, 9, 2, 8, 0, 0);
+    clockBegin(bus);
+    TEST_ASSERT_EQUAL_UINT32(BURST_TRANSACTIONS, bus.transactions);
+    TEST_ASSERT_EQUAL_UINT32(BURST_BYTES, bus.bytes);
+    TEST_ASSERT_EQUAL_UINT32(toEpoch(2024, 9, 2, 8, 0, 0), clockNow());
+}
+
+void test_interpolates_between_resyncs(void) {
+    uint32_t synced = toEpoch(2024, 9, 2, 8, 0, 0);
+    hostAdvanceMillis(500);        // off the second boundary, so the test's own run time never tips it
+    for (uint32_t s = 0; s + 1 < CLOCK_RESYNC_MS / 1000; s++) {
+        for (int i = 0; i < 100; i++)
+            TEST_ASSERT_EQUAL_UINT32(synced + s, clockNow());
+        DateTime dt;
+        clockFields(dt);
+        TEST_ASSERT_EQUAL(s % 60, dt.seconds);
+        hostAdvanceMillis(1000);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, bus.transactions);
+}
+
+void test_resync_is_one_burst_read_and_corrects_drift(void) {
+    // The millis() clock runs two seconds slow against the RTC over the interval
+    hostAdvanceMillis(CLOCK_RESYNC_MS - 2000 + 500);
+    setRtc(2024, 9, 2, 8, 1, 0);
+    TEST_ASSERT_EQUAL_UINT32(0, bus.transactions);
+    hostAdvanceMillis(2000);
+    TEST_ASSERT_EQUAL_UINT32(toEpoch(2024, 9, 2, 8, 1, 0), clockNow());
+    TEST_ASSERT_EQUAL_UINT32(BURST_TRANSACTIONS, bus.transactions);
+    TEST_ASSERT_EQUAL_UINT32(BURST_BYTES, bus.bytes);
+    hostAdvanceMillis(1000);
+    TEST_ASSERT_EQUAL_UINT32(toEpoch(2024, 9, 2, 8, 1, 1), clockNow());
+    TEST_ASSERT_EQUAL_UINT32(BURST_TRANSACTIONS, bus.transactions);
+}
+
+void test_an_hour_of_polling(void) {
+    // The UI asks ten times a second
+    for (uint32_t tick = 0; tick < 36000; tick++) {
+        clockNow();
+        hostAdvanceMillis(100);
+    }
+    uint32_t resyncs = 3600 * 1000 / CLOCK_RESYNC_MS;
+    TEST_ASSERT_TRUE(bus.transactions >= (resyncs - 1) * BURST_TRANSACTIONS);
+    TEST_ASSERT_TRUE(bus.transactions <= resyncs * BURST_TRANSACTIONS);
+    TEST_ASSERT_EQUAL_UINT32(bus.transactions / BURST_TRANSACTIONS * BURST_BYTES, bus.bytes);
+}
+
+void test_concurrent_readers_share_a_resync(void) {
+    std::vector<std::thread> readers;
+    std::atomic<bool> done{ false };
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&] {
+            while (!done)
+                clockNow();
+        });
+    }
+    for (int i = 0; i < 20; i++) {
+        hostAdvanceMillis(CLOCK_RESYNC_MS);
+        delay(20);        // long enough for every reader to have asked at least once
+    }
+    done = true;
+    for (auto &reader : readers)
+        reader.join();
+    TEST_ASSERT_EQUAL_UINT32(20 * BURST_TRANSACTIONS, bus.transactions);
+}
+
+void test_temperature_reads_msb_then_lsb(void) {
+    bus.regs[DS3231_TEMP_MSB] = 25;
+    bus.regs[DS3231_TEMP_MSB + 1] = 0x40;        // +0.25
+    TEST_ASSERT_EQUAL_FLOAT(25.25f, clockTemperature());
+    bus.regs[DS3231_TEMP_MSB] = (uint8_t)-11;
+    bus.regs[DS3231_TEMP_MSB + 1] = 0xC0;        // +0.75
+    TEST_ASSERT_EQUAL_FLOAT(-10.25f, clockTemperature());
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_begin_is_one_burst_read);
+    RUN_TEST(test_interpolates_between_resyncs);
+    RUN_TEST(test_resync_is_one_burst_read_and_corrects_drift);
+    RUN_TEST(test_an_hour_of_polling);
+    RUN_TEST(test_concurrent_readers_share_a_resync);
+    RUN_TEST(test_temperature_reads_msb_then_lsb);
+    return UNITY_END();
+}
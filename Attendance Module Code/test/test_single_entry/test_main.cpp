@@ -0,0 +1,130 @@
+// The single-entry flow (checkin_ui.h) driven by scripted keypresses on a virtual clock: a queue of
+// students each steps up, types * or D, the roll number and #. The UI is polled the way loop()
+// polls it, so the result screen stays up until the next student's first key skips it.
+//
+// The firmware before the state machine blocked in delay(MESSAGE_MS) after every check-in and
+// dropped the keys typed meanwhile, so the next student could not start until it ran out. The same
+// queue is run against that rule for the before figure. Check-ins per minute must meet
+// CHECKINS_PER_MIN_BUDGET and beat the blocking loop.
+
+#include "checkin_ui.h"
+#include "hal_sim.h"
+#include <algorithm>
+#include <set>
+#include <unity.h>
+
+static const unsigned long POLL_MS = 10;
+static const unsigned long KEY_MS = 300;           // per keypress
+static const unsigned long STEP_MS = 1000;         // the next student in the queue stepping up
+static const uint16_t STUDENTS = 60;
+static const double CHECKINS_PER_MIN_BUDGET = 25;
+
+static bool lookup(uint16_t rollNum, char *name, size_t len) {
+    if (rollNum == 0 || rollNum > STUDENTS)
+        return false;
+    snprintf(name, len, "Student %u", rollNum);
+    return true;
+}
+
+class MemoryStore : public AttendanceStore {
+  public:
+    std::set<uint16_t> in;
+    uint32_t saved = 0;
+
+    MarkResult markAttendance(uint16_t rollNum, uint32_t) override { return count(in.insert(rollNum).second); }
+    MarkResult markDeparture(uint16_t rollNum, uint32_t) override { return count(in.erase(rollNum) > 0); }
+    void markArrivals(BatchEntry *entries, uint8_t n) override {
+        for (uint8_t i = 0; i < n; i++)
+            entries[i].result = markAttendance(entries[i].rollNum, entries[i].timestamp);
+    }
+    bool checkedIn(uint16_t rollNum) override { return in.count(rollNum) != 0; }
+
+  private:
+    MarkResult count(bool ok) {
+        saved += ok;
+        return ok ? MARK_SAVED : MARK_DUPLICATE;
+    }
+};
+
+struct Door {
+    SimClock clock;
+    SimKeypad keypad;
+    SimDisplay lcd;
+    MemoryStore store;
+    SimNetwork network;
+    CheckinUi ui{ keypad, lcd, clock, store, network, lookup };
+    unsigned long blockedUntil = 0;        // blocking loop only: end of the delay after a check-in
+
+    Door() { ui.begin(); }
+
+    void pass(unsigned long ms) {
+        for (unsigned long until = clock.ms + ms; clock.ms < until;) {
+            clock.ms = std::min(until, clock.ms + POLL_MS);
+            ui.poll();
+        }
+    }
+
+    void press(char key) {
+        pass(KEY_MS);
+        keypad.keys.push_back(key);
+        ui.poll();
+    }
+
+    // One student: steps up, then * or D, the roll number and #
+    void checkIn(char mode, uint16_t rollNum, bool blocking) {
+        pass(STEP_MS);
+        if (blocking && clock.ms < blockedUntil)
+            pass(blockedUntil - clock.ms);
+        press(mode);
+        TEST_ASSERT_TRUE(lcd.shows("Enter Your RNum"));        // the first key skipped the last result
+        char digits[8];
+        snprintf(digits, sizeof(digits), "%0*u", ROLL_DIGITS, rollNum);
+        for (const char *d = digits; *d; d++)
+            press(*d);
+        press('#');
+        TEST_ASSERT_TRUE(lcd.shows(mode == '*' ? "Welcome Back" : "See You Soon"));
+        blockedUntil = clock.ms + MESSAGE_MS;
+    }
+};
+
+// Everyone arrives, then a third of them leave again
+static double checkinsPerMinute(bool blocking) {
+    Door door;
+    uint32_t checkins = 0;
+    for (uint16_t roll = 1; roll <= STUDENTS; roll++, checkins++)
+        door.checkIn('*', roll, blocking);
+    for (uint16_t roll = 1; roll <= STUDENTS; roll += 3, checkins++)
+        door.checkIn('D', roll, blocking);
+    TEST_ASSERT_EQUAL_UINT32(checkins, door.store.saved);
+    return checkins / (door.clock.ms / 60000.0);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_checkins_per_minute(void) {
+    double blocking = checkinsPerMinute(true);
+    double polled = checkinsPerMinute(false);
+    char summary[120];
+    snprintf(summary, sizeof(summary), "blocking loop %.1f check-ins/min, state machine %.1f check-ins/min", blocking, polled);
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_TRUE_MESSAGE(polled >= CHECKINS_PER_MIN_BUDGET, "single entry below its check-ins per minute budget");
+    TEST_ASSERT_TRUE_MESSAGE(polled > blocking * 1.2, "state machine no faster than the blocking loop");
+}
+
+void test_result_screen_times_out(void) {
+    Door door;
+    door.checkIn('*', 7, false);
+    door.pass(MESSAGE_MS - POLL_MS);
+    TEST_ASSERT_TRUE(door.lcd.shows("Welcome Back"));
+    door.pass(2 * POLL_MS);
+    TEST_ASSERT_TRUE(door.lcd.shows("*In D Out A Rush"));
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_checkins_per_minute);
+    RUN_TEST(test_result_screen_times_out);
+    return UNITY_END();
+}
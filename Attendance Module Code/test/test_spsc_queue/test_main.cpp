@@ -0,0 +1,157 @@
+// The storage queue (spsc_queue.h) with a real producer and consumer thread. Millions of items
+// go through queues small enough to wrap around constantly; the consumer checks that they come out
+// in order, none lost, none twice and none torn. A throughput figure is measured against a
+// std::mutex guarded std::deque doing the same job and held to a floor.
+
+#include "spsc_queue.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unity.h>
+
+static const uint32_t ITEMS = 2000000;
+static const double MIN_ITEMS_PER_SEC = 1e6;
+
+// Shaped like a CheckinEvent, with every field derived from seq so a torn copy shows
+struct Item {
+    uint32_t seq;
+    uint16_t rollNum;
+    uint8_t event;
+    uint32_t check;
+};
+
+static Item makeItem(uint32_t seq) {
+    return { seq, (uint16_t)(seq * 7), (uint8_t)(seq & 3), seq ^ 0x5a5a5a5a };
+}
+
+static bool intact(const Item &item) {
+    return item.rollNum == (uint16_t)(item.seq * 7) && item.event == (item.seq & 3) && item.check == (item.seq ^ 0x5a5a5a5a);
+}
+
+// Pushes count items through a queue of N slots from another thread; returns items per second
+template <size_t N> static double pump(uint32_t count) {
+    SpscQueue<Item, N> queue;
+    std::atomic<uint32_t> maxSize{ 0 };
+    auto started = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        for (uint32_t seq = 0; seq < count; seq++) {
+            while (!queue.push(makeItem(seq)))
+                std::this_thread::yield();
+            size_t size = queue.size();
+            if (size > maxSize)
+                maxSize = size;
+        }
+    });
+
+    uint32_t expected = 0, torn = 0, outOfOrder = 0;
+    Item item;
+    while (expected < count) {
+        if (!queue.pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        torn += !intact(item);
+        outOfOrder += item.seq != expected;
+        expected = item.seq + 1;
+    }
+    producer.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);        // covers lost and repeated items too
+    TEST_ASSERT_FALSE(queue.pop(item));
+    TEST_ASSERT_TRUE(queue.empty());
+    TEST_ASSERT_TRUE(maxSize <= queue.capacity());
+    return count / seconds;
+}
+
+// The same hand-over through a locked deque
+static double pumpLocked(uint32_t count) {
+    std::deque<Item> queue;
+    std::mutex lock;
+    auto started = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        for (uint32_t seq = 0; seq < count; seq++) {
+            std::lock_guard<std::mutex> guard(lock);
+            queue.push_back(makeItem(seq));
+        }
+    });
+    uint32_t expected = 0, outOfOrder = 0;
+    while (expected < count) {
+        Item item;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (queue.empty())
+                continue;
+            item = queue.front();
+            queue.pop_front();
+        }
+        outOfOrder += item.seq != expected;
+        expected = item.seq + 1;
+    }
+    producer.join();
+    TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+    return count / std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_smallest_queue(void) {
+    pump<2>(ITEMS / 20);        // one slot: every push waits for the pop before it
+}
+
+void test_small_queue_wraps(void) {
+    pump<4>(ITEMS / 4);
+}
+
+void test_storage_sized_queue(void) {
+    pump<64>(ITEMS);
+}
+
+void test_index_wraparound(void) {
+    // Single threaded, walking the indices round many times at every fill level
+    SpscQueue<Item, 8> queue;
+    uint32_t pushed = 0, popped = 0;
+    for (uint32_t round = 0; round < 10000; round++) {
+        uint32_t fill = round % 8;
+        for (uint32_t i = 0; i < fill; i++) {
+            bool accepted = queue.push(makeItem(pushed));
+            TEST_ASSERT_EQUAL(i < queue.capacity(), accepted);
+            pushed += accepted;
+        }
+        TEST_ASSERT_EQUAL(fill < queue.capacity() ? fill : queue.capacity(), queue.size());
+        Item item;
+        while (queue.pop(item)) {
+            TEST_ASSERT_TRUE(intact(item));
+            TEST_ASSERT_EQUAL_UINT32(popped++, item.seq);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(pushed, popped);
+}
+
+void test_throughput(void) {
+    double lockFree = 0, locked = 0;
+    for (int run = 0; run < 3; run++) {
+        lockFree = std::max(lockFree, pump<64>(ITEMS));
+        locked = std::max(locked, pumpLocked(ITEMS));
+    }
+    char summary[120];
+    snprintf(summary, sizeof(summary), "SpscQueue %.1f M items/s, mutex and deque %.1f M items/s on %u cores", lockFree / 1e6,
+             locked / 1e6, std::thread::hardware_concurrency());
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_TRUE_MESSAGE(lockFree >= MIN_ITEMS_PER_SEC, "SpscQueue below its throughput floor");
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_smallest_queue);
+    RUN_TEST(test_small_queue_wraps);
+    RUN_TEST(test_storage_sized_queue);
+    RUN_TEST(test_index_wraparound);
+    RUN_TEST(test_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,164 @@
+// A million check-ins with the heap watched (fmt.h). operator new is replaced by one that counts,
+// and the hot path runs end to end on the simulated keypad and clock: the check-in UI drawing
+// through LcdFrame to the host's LCD, the compiled roster, the presence check, the hand-off through
+// an SpscQueue shaped like the storage task's, and each record sealed and rendered as its CSV line.
+// Home screens are redrawn between students and a new day starts once everyone has left. Once warmed up, the
+// whole soak must not allocate once.
+//
+// Opening files on flash is left out: the filesystem layer allocates on the ESP32 as well, and the
+// storage task only does it once per batch.
+
+#include "checkin_ui.h"
+#include "hal_esp32.h"
+#include "hal_sim.h"
+#include "journal.h"
+#include "presence.h"
+#include "roster.h"
+#include "spsc_queue.h"
+#include "storage.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <unity.h>
+
+static const uint32_t CHECKINS = 1000000;
+
+static std::atomic<bool> counting{ false };
+static std::atomic<uint64_t> allocations{ 0 };
+
+void *operator new(size_t size) {
+    if (counting)
+        allocations++;
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    free(p);
+}
+
+static SpscQueue<CheckinEvent, STORAGE_QUEUE_SIZE> queue;
+static uint32_t saved = 0;
+static uint64_t csvBytes = 0;
+
+static bool enqueue(uint32_t timestamp, uint16_t rollNum, uint8_t event) {
+    return queue.push({ timestamp, rollNum, event, false });
+}
+
+// What the storage task does with each check-in short of writing it: seal it, and what /csv does: render it
+static void drain() {
+    CheckinEvent ev;
+    while (queue.pop(ev)) {
+        AttendanceRecord rec = { ev.timestamp, ev.rollNum, ev.event, 0, saved++, 0 };
+        rec.crc = crc32((const uint8_t *)&rec, offsetof(AttendanceRecord, crc));
+        char name[64], line[112];
+        rosterLookup(rec.rollNum, name, sizeof(name));
+        csvBytes += formatRecordCsv(rec, name, line, sizeof(line));
+    }
+}
+
+class SoakStore : public AttendanceStore {
+  public:
+    MarkResult markAttendance(uint16_t rollNum, uint32_t timestamp) override { return presenceMark(rollNum, EVENT_ARRIVAL, timestamp, enqueue); }
+    MarkResult markDeparture(uint16_t rollNum, uint32_t timestamp) override { return presenceMark(rollNum, EVENT_DEPARTURE, timestamp, enqueue); }
+    void markArrivals(BatchEntry *entries, uint8_t count) override {
+        for (uint8_t i = 0; i < count; i++)
+            entries[i].result = markAttendance(entries[i].rollNum, entries[i].timestamp);
+    }
+    bool checkedIn(uint16_t rollNum) override { return presenceIsIn(rollNum); }
+};
+
+// One key at a time; SimKeypad's deque would allocate a block every few hundred keys itself
+class OneKey : public KeypadInput {
+  public:
+    char key = NO_KEY;
+    char getKey() override {
+        char pressed = key;
+        key = NO_KEY;
+        return pressed;
+    }
+};
+
+static LiquidCrystal_I2C glass(0x27, 16, 2);
+static LcdFrame frame(glass);
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_million_checkins_allocate_nothing(void) {
+    SimClock clock;
+    OneKey keypad;
+    Esp32Display lcd(frame);
+    SoakStore store;
+    SimNetwork network;
+    CheckinUi ui(keypad, lcd, clock, store, network, rosterLookup);
+    frame.begin();
+    ui.begin();
+    // The roll numbers of the compiled roster that fit the two-digit keypad entry
+    uint16_t rolls[99];
+    uint16_t students = 0;
+    char name[64];
+    for (uint16_t roll = 1; roll <= 99; roll++) {
+        if (rosterLookup(roll, name, sizeof(name)))
+            rolls[students++] = roll;
+    }
+    TEST_ASSERT_TRUE(students > 0);
+
+    auto press = [&](char key) {
+        clock.ms += 300;
+        keypad.key = key;
+        ui.poll();
+    };
+
+    counting = true;
+    for (uint32_t i = 0; i < CHECKINS; i++) {
+        uint16_t roll = rolls[i % students];
+        bool leaving = (i / students) % 2;
+        if (i % (2 * students) == 0) {
+            // Everyone in and out makes a day; the next one starts at 08:00
+            uint32_t now = clock.now();
+            clock.ms += ((dayOf(now) + 1) * 86400UL + 8 * 3600UL - now) * 1000UL;
+        }
+        if (i % students == 0) {
+            clock.ms += MESSAGE_MS;        // nobody at the door: back to the home screen
+            ui.poll();
+        }
+        press(leaving ? 'D' : '*');
+        press('0' + roll / 10);
+        press('0' + roll % 10);
+        press('#');
+        drain();
+    }
+    counting = false;
+
+    char summary[120];
+    snprintf(summary, sizeof(summary), "%u check-ins, %llu CSV bytes rendered, %llu heap allocations", CHECKINS,
+             (unsigned long long)csvBytes, (unsigned long long)allocations.load());
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_EQUAL_UINT32(CHECKINS, saved);        // departures only ever follow arrivals the same day
+    TEST_ASSERT_EQUAL_UINT64(0, allocations.load());
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_million_checkins_allocate_nothing);
+    return UNITY_END();
+}
@@ -0,0 +1,328 @@
+// Pulls new check-ins from one or more attendance modules over their /events route and appends
+// them to one CSV per module. Each module's cursor (the next sequence number wanted) is kept next
+// to its CSV, so a restarted collector carries on where it stopped and every poll only transfers
+// records the collector has not seen yet. Records are the firmware's own (src/journal.h).
+//
+// With no module given it load-tests the protocol on this machine instead. A stand-in module
+// (standin.h) serves /events from the firmware's journal and event reader on a scratch directory,
+// the journal grows by a school day of check-ins between polls, and every poll must move the same
+// bytes however long the log has got. The flash the stand-in read for each poll is shown alongside.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -DATTENDANCE_SERIAL_LOG=0 -I lib/host -I src -o collector
+//             tools/collector.cpp lib/host/host.cpp src/archive.cpp src/epoch.cpp src/fmt.cpp
+//             src/journal.cpp src/live.cpp src/metrics.cpp src/ring_log.cpp src/rtc.cpp
+// Run:    ./collector [-i seconds] [-d dir] [-n limit] [-1] host[:port] ...
+//         ./collector [-n limit] [-t days]
+//   -i  seconds between polls (default 10)
+//   -d  directory for <host>.csv and <host>.cursor (default .)
+//   -n  records asked for per request (default 500, the module caps it at 5000)
+//   -1  poll every module once and exit
+//   -t  load test: school days the journal grows by, one poll after each (default 120)
+
+#include "standin.h"
+
+#include "archive.h"
+#include "epoch.h"
+#include "journal.h"
+#include <FS.h>
+
+#include <netdb.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+static const uint32_t LOAD_PER_DAY = 300;        // check-ins between polls in the load test
+
+struct Module {
+    std::string host;
+    std::string port;
+    std::string csvPath;
+    std::string cursorPath;
+    uint32_t cursor = 0;
+};
+
+struct PollResult {
+    size_t records = 0;
+    size_t requests = 0;
+    size_t wireBytes = 0;
+    bool failed = false;
+};
+
+// Sends one GET and returns the body with any chunked encoding removed, or false on a network or HTTP error
+static bool httpGet(const Module &m, const std::string &path, std::string &body, size_t &wireBytes) {
+    addrinfo hints = {}, *addr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(m.host.c_str(), m.port.c_str(), &hints, &addr) != 0)
+        return false;
+    int fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    bool connected = fd >= 0 && connect(fd, addr->ai_addr, addr->ai_addrlen) == 0;
+    freeaddrinfo(addr);
+    if (!connected) {
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + m.host + "\r\nConnection: close\r\n\r\n";
+    send(fd, request.data(), request.size(), 0);
+    std::string response;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0)
+        response.append(buf, n);
+    close(fd);
+    wireBytes = request.size() + response.size();
+
+    size_t headerEnd = response.find("\r\n\r\n");
+    if (headerEnd == std::string::npos || response.compare(0, 7, "HTTP/1.") != 0 || response.compare(8, 4, " 200") != 0)
+        return false;
+    std::string headers = response.substr(0, headerEnd);
+    for (char &c : headers)
+        c = tolower(c);
+    size_t pos = headerEnd + 4;
+    if (headers.find("transfer-encoding: chunked") == std::string::npos) {
+        body = response.substr(pos);
+        return true;
+    }
+    body.clear();
+    for (;;) {
+        size_t lineEnd = response.find("\r\n", pos);
+        if (lineEnd == std::string::npos)
+            return false;
+        size_t len = strtoul(response.c_str() + pos, nullptr, 16);
+        pos = lineEnd + 2;
+        if (len == 0)
+            return true;
+        if (pos + len > response.size())
+            return false;
+        body.append(response, pos, len);
+        pos += len + 2;
+    }
+}
+
+static void saveCursor(const Module &m) {
+    std::string tmp = m.cursorPath + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "w");
+    if (!f)
+        return;
+    fprintf(f, "%u\n", m.cursor);
+    fclose(f);
+    rename(tmp.c_str(), m.cursorPath.c_str());
+}
+
+// Fetches everything newer than the module's cursor, a page at a time. Records are written to the
+// CSV before the cursor moves past them, so a crash can repeat a record but never lose one.
+static PollResult pollModule(Module &m, uint32_t limit) {
+    PollResult result;
+    for (;;) {
+        char path[96];
+        snprintf(path, sizeof(path), "/events?since=%u&limit=%u&format=bin", m.cursor, limit);
+        std::string body;
+        size_t wireBytes = 0;
+        result.requests++;
+        if (!httpGet(m, path, body, wireBytes)) {
+            fprintf(stderr, "%s: request failed\n", m.host.c_str());
+            result.failed = true;
+            break;
+        }
+        result.wireBytes += wireBytes;
+
+        size_t count = body.size() / sizeof(AttendanceRecord);
+        FILE *csv = fopen(m.csvPath.c_str(), "a");
+        if (!csv) {
+            perror(m.csvPath.c_str());
+            result.failed = true;
+            break;
+        }
+        uint32_t next = m.cursor;
+        for (size_t i = 0; i < count; i++) {
+            AttendanceRecord rec;
+            memcpy(&rec, body.data() + i * sizeof(AttendanceRecord), sizeof(rec));
+            if (rec.crc != crc32((const uint8_t *)&rec, offsetof(AttendanceRecord, crc))) {
+                result.failed = true;
+                fprintf(stderr, "%s: record %zu failed its CRC, stopping this poll\n", m.host.c_str(), i);
+                count = i;
+                break;
+            }
+            time_t t = rec.timestamp;
+            struct tm tm;
+            gmtime_r(&t, &tm);
+            fprintf(csv, "%u,%04d-%02d-%02d %02d:%02d:%02d,%u,%s\n", rec.seq, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+                    tm.tm_min, tm.tm_sec, rec.rollNum, rec.event == EVENT_ARRIVAL ? "Arrival" : "Departure");
+            next = rec.seq + 1;
+        }
+        fclose(csv);
+        if (next != m.cursor) {
+            m.cursor = next;
+            saveCursor(m);
+        }
+        result.records += count;
+        if (count < limit)
+            break;
+    }
+    return result;
+}
+
+//----------------------------------------LOAD TEST---------------------------------------
+static bool standInName(uint16_t rollNum, char *name, size_t len) {
+    snprintf(name, len, "Student %u", rollNum);
+    return true;
+}
+
+// The module's /events route: the same reader, answered in chunks as the web server sends them
+class EventsStandIn : public StandIn {
+  public:
+    explicit EventsStandIn(fs::FS &fs) : fs(fs) {}
+
+  private:
+    void request(Connection &c, const std::string &path) override {
+        c.closing = true;
+        if (path.compare(0, 8, "/events?") != 0) {
+            c.out = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            return;
+        }
+        uint32_t limit = queryValue(path, "limit", EVENTS_DEFAULT_LIMIT);
+        if (limit == 0 || limit > EVENTS_MAX_LIMIT)
+            limit = EVENTS_MAX_LIMIT;
+        bool binary = path.find("format=bin") != std::string::npos;
+        uint32_t endSeq = journalSnapshot().endSeq;
+        JournalEventReader reader(fs, standInName, queryValue(path, "since", 0), limit, binary, endSeq);
+        c.out = std::string("HTTP/1.1 200 OK\r\nContent-Type: ") + (binary ? "application/octet-stream" : "text/csv") +
+                "\r\nTransfer-Encoding: chunked\r\nX-Next-Seq: " + std::to_string(endSeq) + "\r\nConnection: close\r\n\r\n";
+        uint8_t buf[1436];        // what fits in one segment next to the chunk framing
+        size_t n;
+        while ((n = reader.read(buf, sizeof(buf))) > 0) {
+            char size[20];
+            snprintf(size, sizeof(size), "%zx\r\n", n);
+            c.out += size + std::string((const char *)buf, n) + "\r\n";
+        }
+        c.out += "0\r\n\r\n";
+    }
+
+    fs::FS &fs;
+};
+
+// Grows the stand-in's journal a day at a time and polls it after each; the bytes per poll may
+// only move with the digits of the cursor
+static int loadTest(uint32_t limit, uint32_t days) {
+    std::string dir = hostScratchDir();
+    fs::FS fs(dir);
+    journalBegin(fs);
+    EventsStandIn standIn(fs);
+    int port = standIn.start();
+    if (port < 0) {
+        fprintf(stderr, "stand-in server failed to start\n");
+        return 1;
+    }
+    Module m;
+    m.host = "127.0.0.1";
+    m.port = std::to_string(port);
+    m.csvPath = dir + "/collected.csv";
+    m.cursorPath = dir + "/collected.cursor";
+
+    uint32_t firstDay = dayOf(toEpoch(2024, 1, 1, 0, 0, 0));
+    size_t firstBytes = 0, mostBytes = 0;
+    bool failed = false;
+    printf("%6s %10s %8s %8s %12s %12s\n", "day", "log", "records", "requests", "wire_bytes", "flash_read");
+    for (uint32_t d = 0; d < days; d++) {
+        uint32_t day = firstDay + d;
+        for (uint32_t i = 0; i < LOAD_PER_DAY; i++)
+            journalAppend(fs, day * 86400UL + 8 * 3600UL + i * 30, i % 200 + 1, i < 200 ? EVENT_ARRIVAL : EVENT_DEPARTURE);
+        journalFlush(fs);
+        journalService(fs, (day + 1) * 86400UL);
+        archiveService(fs, day + 1);
+
+        fs.stats.reset();
+        fs.stats.reset();
+        PollResult poll = pollModule(m, limit);
+        if (d == 0)
+            firstBytes = poll.wireBytes;
+        mostBytes = std::max(mostBytes, poll.wireBytes);
+        if (poll.failed || poll.records != LOAD_PER_DAY || m.cursor != journalSnapshot().endSeq)
+            failed = true;
+        if (d == 0 || (d + 1) % 10 == 0 || failed)
+            printf("%6u %10u %8zu %8zu %12zu %12llu\n", d + 1, journalSnapshot().endSeq, poll.records, poll.requests, poll.wireBytes,
+                   (unsigned long long)fs.stats.bytesRead);
+    }
+    standIn.stop();
+
+    // A few more digits in the cursor and X-Next-Seq are all a longer log may add
+    bool flat = mostBytes <= firstBytes + 16;
+    printf("\n%u days of %u check-ins: %zu to %zu bytes per poll\n", days, LOAD_PER_DAY, firstBytes, mostBytes);
+    printf("%s\n", failed ? "FAILED: a poll failed or did not bring exactly the new records"
+                    : !flat ? "FAILED: bytes per poll grew with the log" : "ok");
+    return failed || !flat ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    unsigned interval = 10;
+    uint32_t limit = 500;
+    uint32_t days = 120;
+    bool once = false;
+    std::string dir = ".";
+    int opt;
+    while ((opt = getopt(argc, argv, "i:d:n:t:1")) != -1) {
+        switch (opt) {
+        case 'i':
+            interval = strtoul(optarg, nullptr, 10);
+            break;
+        case 'd':
+            dir = optarg;
+            break;
+        case 'n':
+            limit = strtoul(optarg, nullptr, 10);
+            break;
+        case 't':
+            days = strtoul(optarg, nullptr, 10);
+            break;
+        case '1':
+            once = true;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-i seconds] [-d dir] [-n limit] [-t days] [-1] [host[:port] ...]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (limit == 0) {
+        fprintf(stderr, "usage: %s [-i seconds] [-d dir] [-n limit] [-t days] [-1] [host[:port] ...]\n", argv[0]);
+        return 2;
+    }
+    if (optind == argc)
+        return loadTest(limit, days);
+
+    std::vector<Module> modules;
+    for (int i = optind; i < argc; i++) {
+        Module m;
+        std::string arg = argv[i];
+        size_t colon = arg.rfind(':');
+        m.host = arg.substr(0, colon);
+        m.port = colon == std::string::npos ? "80" : arg.substr(colon + 1);
+        m.csvPath = dir + "/" + m.host + ".csv";
+        m.cursorPath = dir + "/" + m.host + ".cursor";
+        if (FILE *f = fopen(m.cursorPath.c_str(), "r")) {
+            if (fscanf(f, "%u", &m.cursor) != 1)
+                m.cursor = 0;
+            fclose(f);
+        }
+        modules.push_back(m);
+    }
+
+    for (;;) {
+        for (Module &m : modules) {
+            PollResult poll = pollModule(m, limit);
+            printf("%s: %zu new records, %zu requests, %zu bytes on the wire, cursor %u\n", m.host.c_str(), poll.records, poll.requests,
+                   poll.wireBytes, m.cursor);
+            fflush(stdout);
+        }
+        if (once)
+            return 0;
+        sleep(interval);
+    }
+}
@@ -0,0 +1,208 @@
+// Runs the journal's ring log (src/ring_log.h) on the host against a simulated NOR flash chip and
+// reports, at a series of fill levels, what the same workload would cost on the module: append
+// latency, write amplification, wear spread and mount time.
+//
+// The simulated chip enforces NOR rules (programming can only clear bits, a sector is erased as a
+// whole) and charges each operation the typical datasheet cost of the 4 MB SPI flash on ESP32
+// boards. The workload follows the journal: batches of JOURNAL_FLUSH_THRESHOLD records plus a
+// commit marker, with the odd short batch from an idle flush. Between batches the storage task is
+// idle and erases the next sector ahead (RingLog::prepare()), which is not counted as append
+// latency. After each fill level a fresh RingLog is mounted on the same flash and must find
+// exactly the tail the writer left.
+//
+// Only the ring log is measured. The SPIFFS and LittleFS backends (storage_backend.h) are the real
+// libraries in the ESP32 core, and lib/host has no port of them: its FS is a directory on the
+// host, with no erase blocks or wear to count. Simulating them here would take their sources
+// running on SimulatedNor. On the module, compare the three by flashing esp32dev,
+// esp32dev_littlefs and esp32dev_rawlog and reading flash_append from /metrics.
+//
+// Build:  g++ -std=c++17 -O2 -I src -o flashbench tools/flashbench.cpp src/ring_log.cpp
+// Run:    ./flashbench [-k kilobytes] [-s seed] [--no-prepare]
+//   -k            size of the journal partition (default 704, as in partitions.csv)
+//   -s            seed for the batch sizes (default 1)
+//   --no-prepare  never erase ahead, so appends that start a sector pay for its erase
+
+#include "ring_log.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Typical costs for a 4 MB quad SPI NOR part behind the ESP32 flash driver, in microseconds
+static const double ERASE_US = 45000.0;           // one 4 KB sector
+static const double PAGE_PROGRAM_US = 700.0;      // one full 256 byte page, scaled by bytes programmed
+static const double OP_OVERHEAD_US = 15.0;        // driver call, cache disable, command
+static const double READ_US_PER_BYTE = 0.05;
+static const uint32_t PAGE_SIZE = 256;
+static const uint32_t SECTOR_SIZE = 4096;
+
+class SimulatedNor : public NorFlash {
+  public:
+    explicit SimulatedNor(uint32_t sectors) : erases(sectors, 0), mem(sectors * SECTOR_SIZE, 0x5a) {}
+
+    uint32_t sectorSize() const override { return SECTOR_SIZE; }
+    uint32_t sectorCount() const override { return erases.size(); }
+
+    bool read(uint32_t addr, void *buf, size_t len) override {
+        if (addr + len > mem.size())
+            return false;
+        memcpy(buf, &mem[addr], len);
+        elapsed += OP_OVERHEAD_US + len * READ_US_PER_BYTE;
+        reads++;
+        return true;
+    }
+
+    bool program(uint32_t addr, const void *buf, size_t len) override {
+        if (addr + len > mem.size())
+            return false;
+        const uint8_t *src = (const uint8_t *)buf;
+        for (size_t i = 0; i < len; i++) {
+            if (src[i] & ~mem[addr + i])
+                violations++;        // would need a 0 bit back to 1
+            mem[addr + i] &= src[i];
+        }
+        // Programming goes a page at a time; a write that spans pages pays for each
+        for (uint32_t at = addr; at < addr + len;) {
+            uint32_t pageEnd = (at / PAGE_SIZE + 1) * PAGE_SIZE;
+            uint32_t n = std::min<uint32_t>(pageEnd, addr + len) - at;
+            elapsed += PAGE_PROGRAM_US * n / PAGE_SIZE;
+            at += n;
+        }
+        elapsed += OP_OVERHEAD_US;
+        programmed += len;
+        return true;
+    }
+
+    bool erase(uint32_t sector) override {
+        if (sector >= erases.size())
+            return false;
+        memset(&mem[sector * SECTOR_SIZE], 0xff, SECTOR_SIZE);
+        erases[sector]++;
+        elapsed += OP_OVERHEAD_US + ERASE_US;
+        return true;
+    }
+
+    double elapsed = 0;           // simulated time spent, microseconds
+    uint64_t programmed = 0;      // bytes
+    uint64_t reads = 0;
+    uint64_t violations = 0;
+    std::vector<uint32_t> erases;
+
+  private:
+    std::vector<uint8_t> mem;
+};
+
+static double percentile(std::vector<double> &v, double p) {
+    if (v.empty())
+        return 0;
+    size_t i = (size_t)(p * (v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + i, v.end());
+    return v[i];
+}
+
+int main(int argc, char **argv) {
+    uint32_t kilobytes = 704;
+    uint32_t seed = 1;
+    bool prepare = true;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-k") && i + 1 < argc) {
+            kilobytes = strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            seed = strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--no-prepare")) {
+            prepare = false;
+        } else {
+            fprintf(stderr, "usage: %s [-k kilobytes] [-s seed] [--no-prepare]\n", argv[0]);
+            return 2;
+        }
+    }
+    uint32_t sectors = kilobytes * 1024 / SECTOR_SIZE;
+
+    SimulatedNor flash(sectors);        // starts out holding foreign data, not blank
+    RingLog ring(flash);
+    if (!ring.mount()) {
+        fprintf(stderr, "mount failed\n");
+        return 1;
+    }
+    printf("partition %u KB, %u sectors, %u records\n", kilobytes, sectors, ring.capacity());
+    printf("costs: erase %.0f us/sector, program %.0f us/page, %.0f us/op, read %.2f us/byte\n\n", ERASE_US, PAGE_PROGRAM_US,
+           OP_OVERHEAD_US, READ_US_PER_BYTE);
+    printf("%8s %10s %9s %9s %9s %9s %8s %8s %7s %10s\n", "fill", "appends", "p50_us", "p99_us", "max_us", "mean_us", "wr_amp",
+           "erase/MB", "wear", "mount_us");
+
+    static const double levels[] = { 0.01, 0.10, 0.25, 0.50, 0.75, 1.00, 2.00, 5.00, 20.00 };
+    uint8_t batch[(8 + 1) * RING_UNIT];
+    uint64_t userBytes = 0;
+    uint64_t written = 0;        // units appended since the start
+    uint64_t programmedBefore = flash.programmed;
+    uint64_t erasesBefore = 0;
+    for (uint32_t e : flash.erases)
+        erasesBefore += e;
+    uint32_t rng = seed;
+    bool failed = false;
+
+    for (double level : levels) {
+        uint64_t target = (uint64_t)(level * ring.capacity());
+        std::vector<double> latency;
+        while (written < target) {
+            // One in eight flushes is an idle flush of 1 to 3 records, the rest hit the threshold
+            rng = rng * 1103515245 + 12345;
+            uint32_t records = (rng >> 16) % 8 == 0 ? 1 + (rng >> 20) % 3 : 8;
+            uint32_t units = records + 1;
+            memset(batch, (uint8_t)written, units * RING_UNIT);
+            double before = flash.elapsed;
+            if (!ring.append(batch, units)) {
+                fprintf(stderr, "append failed\n");
+                return 1;
+            }
+            latency.push_back(flash.elapsed - before);
+            if (prepare && !ring.prepare()) {
+                fprintf(stderr, "erase failed\n");
+                return 1;
+            }
+            userBytes += units * RING_UNIT;
+            written += units;
+        }
+
+        uint64_t erased = 0;
+        uint32_t most = 0, least = UINT32_MAX;
+        for (uint32_t e : flash.erases) {
+            erased += e;
+            most = std::max(most, e);
+            least = std::min(least, e);
+        }
+        erased -= erasesBefore;
+
+        double mean = 0;
+        for (double l : latency)
+            mean += l;
+        mean = latency.empty() ? 0 : mean / latency.size();
+        size_t appends = latency.size();
+        double p50 = percentile(latency, 0.50);
+        double p99 = percentile(latency, 0.99);
+        double worst = latency.empty() ? 0 : *std::max_element(latency.begin(), latency.end());
+
+        // Mount a second instance the way a reboot would and check it agrees with the writer
+        double before = flash.elapsed;
+        RingLog remount(flash);
+        bool mounted = remount.mount();
+        double mountUs = flash.elapsed - before;
+        if (!mounted || remount.end() != ring.end() || remount.begin() != ring.begin()) {
+            fprintf(stderr, "remount at %.0f%% found [%u, %u), writer has [%u, %u)\n", level * 100, remount.begin(), remount.end(),
+                    ring.begin(), ring.end());
+            failed = true;
+        }
+
+        printf("%7.0f%% %10zu %9.0f %9.0f %9.0f %9.0f %8.4f %8.1f %3u-%-3u %10.0f\n", level * 100, appends, p50, p99, worst, mean,
+               (double)(flash.programmed - programmedBefore) / userBytes, erased * 1048576.0 / userBytes, least, most, mountUs);
+    }
+
+    if (flash.violations) {
+        fprintf(stderr, "%llu bytes were programmed without an erase\n", (unsigned long long)flash.violations);
+        failed = true;
+    }
+    printf("\nwr_amp: bytes programmed per byte appended; wear: least-most erases per sector\n");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+"""
+Turns roster.csv ("roll,name" per line) into src/data.h, a table of roll numbers and names that
+the compiler places in flash. Roll numbers are stored sorted so the firmware can binary search
+them, and a roster numbered without gaps is flagged so lookups become a direct index.
+
+Runs automatically before every PlatformIO build (see extra_scripts in platformio.ini) and can
+also be run by hand:  python tools/gen_roster.py [roster.csv] [src/data.h]
+"""
+
+import csv
+import os
+import sys
+
+MAX_ROLL = 65535
+MAX_NAME = 63
+
+
+def c_string(text):
+    out = []
+    for byte in text.encode("utf-8"):
+        ch = chr(byte)
+        if ch in '"\\':
+            out.append("\\" + ch)
+        elif 0x20 <= byte < 0x7F:
+            out.append(ch)
+        else:
+            out.append("\\%03o" % byte)
+    return '"' + "".join(out) + '\\0"'
+
+
+def load_roster(path):
+    roster = {}
+    with open(path, newline="", encoding="utf-8") as f:
+        for lineno, row in enumerate(csv.reader(f), 1):
+            if not row or row[0].strip().startswith("#"):
+                continue
+            if lineno == 1 and not row[0].strip().isdigit():
+                continue        # header
+            if len(row) < 2:
+                sys.exit("%s:%d: expected 'roll,name'" % (path, lineno))
+            roll = int(row[0])
+            name = row[1].strip()
+            if not 0 <= roll <= MAX_ROLL:
+                sys.exit("%s:%d: roll number %d out of range" % (path, lineno, roll))
+            if roll in roster:
+                sys.exit("%s:%d: duplicate roll number %d" % (path, lineno, roll))
+            if len(name.encode("utf-8")) > MAX_NAME:
+                sys.exit("%s:%d: name longer than %d bytes" % (path, lineno, MAX_NAME))
+            roster[roll] = name
+    if not roster:
+        sys.exit("%s: roster is empty" % path)
+    return sorted(roster.items())
+
+
+def generate(csv_path, header_path):
+    roster = load_roster(csv_path)
+    ids = [roll for roll, _ in roster]
+    offsets = []
+    pos = 0
+    for _, name in roster:
+        offsets.append(pos)
+        pos += len(name.encode("utf-8")) + 1
+    dense = ids[-1] - ids[0] + 1 == len(ids)
+
+    lines = [
+        "// Generated by tools/gen_roster.py from roster.csv - edit the CSV, not this file",
+        "#pragma once",
+        "",
+        "#include <stdint.h>",
+        "",
+        "#define ROSTER_SIZE %d" % len(ids),
+        "#define ROSTER_DENSE %d        // roll numbers run from ROSTER_IDS[0] without gaps" % int(dense),
+        "",
+        "constexpr uint16_t ROSTER_IDS[ROSTER_SIZE] = {",
+    ]
+    for i in range(0, len(ids), 16):
+        lines.append("    " + ", ".join(str(x) for x in ids[i:i + 16]) + ",")
+    lines += ["};", "", "constexpr uint32_t ROSTER_NAME_OFFSETS[ROSTER_SIZE] = {"]
+    for i in range(0, len(offsets), 16):
+        lines.append("    " + ", ".join(str(x) for x in offsets[i:i + 16]) + ",")
+    lines += ["};", "", "constexpr char ROSTER_NAMES[] ="]
+    for _, name in roster:
+        lines.append("    " + c_string(name))
+    lines[-1] += ";"
+    lines.append("")
+    text = "\n".join(lines)
+
+    if os.path.exists(header_path):
+        with open(header_path, encoding="utf-8") as f:
+            if f.read() == text:
+                return
+    with open(header_path, "w", encoding="utf-8", newline="\n") as f:
+        f.write(text)
+    print("gen_roster: wrote %s (%d students)" % (header_path, len(ids)))
+
+
+try:
+    Import("env")        # noqa: F821 - provided by PlatformIO when run as an extra script
+    project_dir = env["PROJECT_DIR"]        # noqa: F821
+    generate(os.path.join(project_dir, "roster.csv"), os.path.join(project_dir, "src", "data.h"))
+except NameError:
+    if __name__ == "__main__":
+        here = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        csv_arg = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, "roster.csv")
+        out_arg = sys.argv[2] if len(sys.argv) > 2 else os.path.join(here, "src", "data.h")
+        generate(csv_arg, out_arg)
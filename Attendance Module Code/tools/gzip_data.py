@@ -0,0 +1,56 @@
+"""
+Stages data/ for the SPIFFS image with the web assets gzipped. Each text asset is stored only as
+"<name>.gz"; ESPAsyncWebServer's static handler serves it for "<name>" with Content-Encoding: gzip,
+so the soft AP link and the flash both carry the compressed copy. Everything else is copied as is.
+All of it goes under www/, the only directory the web server serves, so the journal, roster and
+presence files next to it are never reachable by URL.
+
+Runs automatically before every PlatformIO build (see extra_scripts in platformio.ini) and points
+the filesystem image at the staged copy. Can also be run by hand:
+    python tools/gzip_data.py [data] [staged-dir]
+"""
+
+import gzip
+import os
+import shutil
+import sys
+
+COMPRESS = (".html", ".htm", ".css", ".js", ".json", ".svg")
+WEB_DIR = "www"        # served as / by main.cpp
+
+
+def stage(src, dst):
+    if os.path.isdir(dst):
+        shutil.rmtree(dst)
+    saved = 0
+    for root, _, files in os.walk(src):
+        out_dir = os.path.normpath(os.path.join(dst, WEB_DIR, os.path.relpath(root, src)))
+        os.makedirs(out_dir, exist_ok=True)
+        for name in files:
+            path = os.path.join(root, name)
+            if not name.lower().endswith(COMPRESS):
+                shutil.copy2(path, out_dir)
+                continue
+            with open(path, "rb") as f:
+                raw = f.read()
+            # mtime=0 keeps the output identical between builds
+            packed = gzip.compress(raw, compresslevel=9, mtime=0)
+            with open(os.path.join(out_dir, name + ".gz"), "wb") as f:
+                f.write(packed)
+            saved += len(raw) - len(packed)
+    print("gzip_data: staged %s in %s (%d bytes saved)" % (src, dst, saved))
+
+
+try:
+    Import("env")        # noqa: F821 - provided by PlatformIO when run as an extra script
+    data_dir = env.subst("$PROJECT_DATA_DIR")        # noqa: F821
+    staged_dir = os.path.join(env.subst("$BUILD_DIR"), "data")        # noqa: F821
+    if os.path.isdir(data_dir):
+        stage(data_dir, staged_dir)
+        env.Replace(PROJECT_DATA_DIR=staged_dir)        # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        here = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        src_arg = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, "data")
+        dst_arg = sys.argv[2] if len(sys.argv) > 2 else os.path.join(here, ".pio", "data")
+        stage(src_arg, dst_arg)
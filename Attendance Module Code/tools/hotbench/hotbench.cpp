@@ -0,0 +1,72 @@
+// Microbenchmarks for the firmware's hot paths, built on the host from the same sources as the
+// firmware (src/) against lib/host, the stand-in for the Arduino core the native env uses: the I2C
+// bus answers with a DS3231 register file in RAM and the file system is a directory on the host.
+//
+// Covered: BCD conversion, decoding a burst read of the RTC registers, the clock between reads,
+// roster lookups in the compiled table and in uploaded rosters of realistic sizes (through the
+// page cache), building a check-in record (CRC seal and CSV line) and journal append throughput,
+// batches and flushes included.
+//
+// Each benchmark prints one JSON object per line with its best time per operation out of a few
+// runs. tools/hotbench/budget.txt holds a budget per benchmark; going over one fails the run, so a
+// change that slows one of these paths down shows up. The budgets leave room for slower machines;
+// tighten one only together with the change that earned it. The benchmarks live in hotbench.h;
+// test/test_hotbench runs them against the same budgets under pio test -e native.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I lib/host -I src -o hotbench tools/hotbench/hotbench.cpp
+//             lib/host/host.cpp src/epoch.cpp src/fmt.cpp src/journal.cpp src/ring_log.cpp
+//             src/roster.cpp src/rtc.cpp src/archive.cpp
+// Run:    ./hotbench [-b budget] [-d dir] [name ...]
+//   -b    budget file (default tools/hotbench/budget.txt)
+//   -d    scratch directory for the file system, made if missing (default a new one under /tmp)
+//   name  only run benchmarks whose name starts with one of these
+
+#include "hotbench.h"
+#include "live.h"
+#include "metrics.h"
+
+#include <cerrno>
+#include <sys/stat.h>
+
+// The benchmarks leave out the web server and /metrics
+void liveFeedPublish(const AttendanceRecord *, uint8_t) {}
+void metricsObserve(MetricStage, uint32_t) {}
+
+int main(int argc, char **argv) {
+    const char *budgetPath = "tools/hotbench/budget.txt";
+    std::string dir;
+    std::vector<std::string> only;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            budgetPath = argv[++i];
+        } else if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (argv[i][0] != '-') {
+            only.push_back(argv[i]);
+        } else {
+            fprintf(stderr, "usage: %s [-b budget] [-d dir] [name ...]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (dir.empty()) {
+        char scratch[] = "/tmp/hotbench.XXXXXX";
+        if (!mkdtemp(scratch)) {
+            perror("mkdtemp");
+            return 1;
+        }
+        dir = scratch;
+    } else if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        perror(dir.c_str());
+        return 1;
+    }
+    fs::FS files(dir);
+    std::map<std::string, double> budget = readBudget(budgetPath);
+    if (budget.empty())
+        fprintf(stderr, "no budgets read from %s, nothing will fail\n", budgetPath);
+
+    if (!runBenches(files, budget, only)) {
+        fprintf(stderr, "over budget or failed, see the entries with \"ok\":false\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "epoch.h"
+#include "journal.h"
+#include "roster.h"
+#include "rtc.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+//----------------------------------------HOT PATH BENCHMARKS-----------------------------------
+// The benchmarks of tools/hotbench, kept in a header so test/test_hotbench runs the same ones
+// against budget.txt under pio test -e native. runBenches() prints one JSON object per benchmark
+// and returns false if one could not run or went over its budget.
+
+static const int RUNS = 5;
+static const double RUN_MS = 100;        // each run repeats the benchmark for about this long
+
+static volatile uint32_t sink;        // keeps results alive
+static uint32_t rng = 1;
+
+inline uint32_t random32() {
+    rng = rng * 1103515245 + 12345;
+    return rng >> 8;
+}
+
+inline double nowNs() {
+    using namespace std::chrono;
+    return duration<double, std::nano>(steady_clock::now().time_since_epoch()).count();
+}
+
+struct Result {
+    std::string name;
+    double nsPerOp;
+    uint64_t ops;
+};
+
+// Runs op in batches until a run has taken RUN_MS, RUNS times over; keeps the fastest run
+inline Result measure(const std::string &name, uint32_t batch, const std::function<void()> &op) {
+    double best = 1e300;
+    uint64_t total = 0;
+    for (int run = 0; run < RUNS; run++) {
+        uint64_t ops = 0;
+        double started = nowNs(), elapsed;
+        do {
+            for (uint32_t i = 0; i < batch; i++)
+                op();
+            ops += batch;
+            elapsed = nowNs() - started;
+        } while (elapsed < RUN_MS * 1e6);
+        best = std::min(best, elapsed / ops);
+        total += ops;
+    }
+    return { name, best, total };
+}
+
+inline void writeRtc(TwoWire &wire, const DateTime &dt) {
+    wire.regs[DS3231_SECONDS] = toBcd(dt.seconds);
+    wire.regs[DS3231_MINUTES] = toBcd(dt.minutes);
+    wire.regs[DS3231_HOURS] = toBcd(dt.hours);
+    wire.regs[DS3231_DAY] = toBcd(dt.weekday);
+    wire.regs[DS3231_DATE] = toBcd(dt.date);
+    wire.regs[DS3231_CEN_MONTH] = toBcd(dt.month);
+    wire.regs[DS3231_DEC_YEAR] = toBcd(dt.year % 100);
+}
+
+// Uploads a roster of count students with roll numbers from 1, the way POST /roster does
+inline bool uploadRoster(uint32_t count) {
+    std::string csv = "roll,name\n";
+    char line[64];
+    for (uint32_t roll = 1; roll <= count; roll++) {
+        snprintf(line, sizeof(line), "%u,Student Number %u\n", roll, roll);
+        csv += line;
+    }
+    uint32_t upload = rosterUploadBegin();
+    for (size_t at = 0; at < csv.size(); at += 1436)        // one TCP segment per chunk
+        rosterUploadChunk(upload, (const uint8_t *)csv.data() + at, std::min<size_t>(1436, csv.size() - at), at + 1436 >= csv.size());
+    char message[80];
+    return rosterUploadResult(upload, message, sizeof(message)) && rosterSize() == count;
+}
+
+inline std::map<std::string, double> readBudget(const char *path) {
+    std::map<std::string, double> budget;
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return budget;
+    char line[256], name[128];
+    double ns;
+    while (fgets(line, sizeof(line), f))
+        if (line[0] != '#' && sscanf(line, "%127s %lf", name, &ns) == 2)
+            budget[name] = ns;
+    fclose(f);
+    return budget;
+}
+
+// Runs the benchmarks whose names start with one of only (all if only is empty) on files
+inline bool runBenches(fs::FS &files, const std::map<std::string, double> &budget, const std::vector<std::string> &only) {
+    std::vector<std::pair<std::string, std::function<Result()>>> benches;
+    auto add = [&](const std::string &name, uint32_t batch, std::function<void()> op) {
+        benches.push_back({ name, [=] { return measure(name, batch, op); } });
+    };
+
+    // Clock
+    add("bcd_roundtrip", 100, [] {
+        static uint8_t n = 0;
+        sink += fromBcd(toBcd(n));
+        n = n == 99 ? 0 : n + 1;
+    });
+    static TwoWire wire;
+    DateTime start = { 2024, 2, 29, 23, 59, 58, 4 };
+    writeRtc(wire, start);
+    clockBegin(wire);
+    if (clockNow() != toEpoch(start.year, start.month, start.date, start.hours, start.minutes, start.seconds)) {
+        fprintf(stderr, "the clock did not decode the RTC registers it was given\n");
+        return false;
+    }
+    add("rtc_burst_decode", 100, [] {
+        clockSync();
+        sink += clockNow();
+    });
+    add("clock_now", 1000, [] { sink += clockNow(); });
+    add("clock_fields", 1000, [] {
+        DateTime dt;
+        clockFields(dt);
+        sink += dt.seconds;
+    });
+
+    // Roster: the compiled table first, then uploaded rosters of growing size
+    rosterBegin(files);
+    add("roster_compiled_lookup", 1000, [] {
+        char name[ROSTER_NAME_LEN];
+        sink += rosterLookup(1 + random32() % 40, name, sizeof(name));        // some misses
+    });
+    for (uint32_t size : { 100u, 1000u, 5000u }) {
+        std::string name = "roster_paged_lookup_" + std::to_string(size);
+        benches.push_back({ name, [=] {
+            if (!uploadRoster(size)) {
+                fprintf(stderr, "%s: roster upload failed\n", name.c_str());
+                return Result{ name, 0, 0 };
+            }
+            return measure(name, 100, [=] {
+                char found[ROSTER_NAME_LEN];
+                sink += rosterLookup(1 + random32() % (size + size / 10), found, sizeof(found));
+            });
+        } });
+    }
+
+    // Records
+    AttendanceRecord rec = { toEpoch(2024, 2, 29, 8, 3, 0), 17, EVENT_ARRIVAL, 0, 123456, 0 };
+    rec.crc = crc32((const uint8_t *)&rec, offsetof(AttendanceRecord, crc));
+    add("record_seal_crc", 1000, [rec]() mutable {
+        rec.seq++;
+        rec.crc = crc32((const uint8_t *)&rec, offsetof(AttendanceRecord, crc));
+        sink += rec.crc;
+    });
+    add("record_format_csv", 1000, [rec]() mutable {
+        char line[112];
+        rec.timestamp += 7;
+        sink += formatRecordCsv(rec, "Alfred Pennyworth", line, sizeof(line));
+    });
+    add("journal_append", 1000, [&files] {
+        static bool begun = false;
+        static uint32_t timestamp = toEpoch(2024, 2, 29, 8, 0, 0);
+        if (!begun) {
+            journalBegin(files);
+            begun = true;
+        }
+        sink += journalAppend(files, timestamp++, 1 + random32() % 500, EVENT_ARRIVAL);
+    });
+
+    bool failed = false;
+    for (auto &bench : benches) {
+        if (!only.empty() && std::none_of(only.begin(), only.end(), [&](const std::string &p) { return bench.first.compare(0, p.size(), p) == 0; }))
+            continue;
+        Result r = bench.second();
+        auto limit = budget.find(r.name);
+        bool over = r.ops == 0 || (limit != budget.end() && r.nsPerOp > limit->second);
+        failed |= over;
+        printf("{\"bench\":\"%s\",\"ns_per_op\":%.2f,\"ops\":%llu", r.name.c_str(), r.nsPerOp, (unsigned long long)r.ops);
+        if (limit != budget.end())
+            printf(",\"budget_ns\":%.0f", limit->second);
+        printf(",\"ok\":%s}\n", over ? "false" : "true");
+        fflush(stdout);
+    }
+    return !failed;
+}
@@ -0,0 +1,177 @@
+#include "csv_scan.h"
+
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+static bool forceScalar = false;
+
+// Delimiter positions of one row, relative to its first byte
+struct Fields {
+    uint32_t comma[3];        // first three commas
+    uint32_t lastComma;
+    uint32_t lineEnd;         // the newline, or the end of the chunk
+    uint32_t commas;
+};
+
+void setScalarScan(bool scalar) {
+    forceScalar = scalar;
+}
+
+const char *scanKind() {
+#if defined(__AVX2__)
+    return forceScalar ? "scalar" : "avx2";
+#elif defined(__SSE2__)
+    return forceScalar ? "scalar" : "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+// Byte by byte; used for the last row or two of a chunk, where a 64 byte load would run past the end
+static void fieldsScalar(const char *p, const char *end, Fields &f) {
+    const char *q = p;
+    f.commas = 0;
+    f.lastComma = 0;
+    for (; q < end && *q != '\n'; q++) {
+        if (*q != ',')
+            continue;
+        if (f.commas < 3)
+            f.comma[f.commas] = q - p;
+        f.commas++;
+        f.lastComma = q - p;
+    }
+    f.lineEnd = q - p;
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+struct Masks {
+    uint64_t comma;
+    uint64_t newline;
+};
+
+// Bit i of each mask is set when p[i] is that delimiter
+static inline Masks scan64(const char *p) {
+    Masks m;
+#if defined(__AVX2__)
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    __m256i lo = _mm256_loadu_si256((const __m256i *)p);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+    m.comma = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, comma)) | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, comma)) << 32;
+    m.newline = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline)) | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline)) << 32;
+#else
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    m.comma = m.newline = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+        m.comma |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, comma)) << (16 * i);
+        m.newline |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)) << (16 * i);
+    }
+#endif
+    return m;
+}
+
+// 64 bytes per step; a typical row fits in one. Returns false if it would have to read past end.
+static bool fieldsSimd(const char *p, const char *end, Fields &f) {
+    f.commas = 0;
+    f.lastComma = 0;
+    for (uint32_t offset = 0;; offset += 64) {
+        if (end - (p + offset) < 64)
+            return false;
+        Masks m = scan64(p + offset);
+        uint64_t commas = m.comma;
+        if (m.newline)
+            commas &= (m.newline & (0 - m.newline)) - 1;        // only those before the newline
+        if (commas) {
+            f.lastComma = offset + 63 - __builtin_clzll(commas);
+            while (f.commas < 3 && commas) {
+                f.comma[f.commas++] = offset + __builtin_ctzll(commas);
+                commas &= commas - 1;
+            }
+            f.commas += __builtin_popcountll(commas);
+        }
+        if (m.newline) {
+            f.lineEnd = offset + __builtin_ctzll(m.newline);
+            return true;
+        }
+    }
+}
+#endif
+
+// Reads an unpadded decimal number of up to five digits
+static inline bool number(const char *&q, const char *stop, unsigned &value) {
+    const char *start = q;
+    value = 0;
+    while (q < stop && (unsigned)(*q - '0') < 10 && q - start < 5)
+        value = value * 10 + (*q++ - '0');
+    return q > start;
+}
+
+// Reads "a<sep>b<sep>c" filling exactly [q, stop)
+static inline bool triple(const char *q, const char *stop, char sep, unsigned v[3]) {
+    return number(q, stop, v[0]) && q < stop && *q++ == sep && number(q, stop, v[1]) && q < stop && *q++ == sep && number(q, stop, v[2]) && q == stop;
+}
+
+void parseChunk(const char *begin, const char *end, uint16_t source, AttendanceTable &out, ParseStats &stats) {
+    // Names nearly always repeat for a roll number, so the last id seen per roll is tried before
+    // the dictionary's hash table
+    std::vector<uint32_t> nameOfRoll(65536, UINT32_MAX);
+    stats.bytes += end - begin;
+
+    const char *p = begin;
+    while (p < end) {
+        Fields f;
+#if defined(__AVX2__) || defined(__SSE2__)
+        if (forceScalar || !fieldsSimd(p, end, f))
+            fieldsScalar(p, end, f);
+#else
+        fieldsScalar(p, end, f);
+#endif
+        const char *next = p + f.lineEnd < end ? p + f.lineEnd + 1 : end;
+        uint32_t len = f.lineEnd;
+        if (len > 0 && p[len - 1] == '\r')
+            len--;
+        if (len == 0) {
+            p = next;
+            continue;
+        }
+
+        unsigned date[3], time[3], roll;
+        const char *q = p + f.comma[1] + 1;
+        const char *eventText = p + f.lastComma + 1;
+        const char *lineEnd = p + len;
+        bool ok = f.commas >= 4 && triple(p, p + f.comma[0], '/', date) && triple(p + f.comma[0] + 1, p + f.comma[1], ':', time) &&
+                  number(q, p + f.comma[2], roll) && q == p + f.comma[2] && roll <= 65535 && date[0] >= 1 && date[0] <= 31 &&
+                  date[1] >= 1 && date[1] <= 12 && time[0] < 24 && time[1] < 60 && time[2] < 60;
+        uint8_t event = 0;
+        if (ok && lineEnd - eventText == 7 && memcmp(eventText, "Arrival", 7) == 0)
+            event = EVENT_ARRIVAL;
+        else if (ok && lineEnd - eventText == 9 && memcmp(eventText, "Departure", 9) == 0)
+            event = EVENT_DEPARTURE;
+        if (!event) {
+            stats.badRows++;
+            p = next;
+            continue;
+        }
+
+        std::string_view name(p + f.comma[2] + 1, f.lastComma - f.comma[2] - 1);
+        uint32_t id = nameOfRoll[roll];
+        if (id == UINT32_MAX || out.names.name(id) != name) {
+            id = out.names.intern(name);
+            nameOfRoll[roll] = id;
+        }
+        int year = date[2] < 100 ? 2000 + date[2] : date[2];
+        out.timestamp.push_back(toEpoch(year, date[1], date[0], time[0], time[1], time[2]));
+        out.roll.push_back(roll);
+        out.event.push_back(event);
+        out.nameId.push_back(id);
+        out.source.push_back(source);
+        stats.rows++;
+        p = next;
+    }
+}
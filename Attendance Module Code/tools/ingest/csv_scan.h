@@ -0,0 +1,28 @@
+#pragma once
+
+// Parser for the attendance CSV the firmware writes, one row per check-in:
+//   d/m/y,h:m:s,roll,name,Arrival|Departure
+// Date and time fields are not zero padded ("5/3/23,8:1:0") and the year has two digits. Names
+// are not quoted, so the name is taken as everything between the third and the last comma.
+//
+// Delimiters are found 64 bytes at a time with SIMD compares (AVX2 or SSE2, whichever the build
+// targets) turned into bitmasks; the small numeric fields are then read with plain scalar code.
+
+#include "table.h"
+
+#include <cstddef>
+#include <cstdint>
+
+struct ParseStats {
+    uint64_t rows = 0;
+    uint64_t badRows = 0;        // rows that did not match the layout, skipped
+    uint64_t bytes = 0;
+};
+
+// Appends every row in [begin, end) to out, tagging it with source. end must fall just after a
+// newline or at the end of the file.
+void parseChunk(const char *begin, const char *end, uint16_t source, AttendanceTable &out, ParseStats &stats);
+
+// Uses the scalar delimiter scan even when SIMD is available, for comparison runs
+void setScalarScan(bool scalar);
+const char *scanKind();
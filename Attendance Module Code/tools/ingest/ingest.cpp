@@ -0,0 +1,132 @@
+#include "ingest.h"
+#include "parallel.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct MappedFile {
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
+// A run of whole rows from one file, parsed by one thread into its own table
+struct Chunk {
+    const char *begin;
+    const char *end;
+    uint16_t source;
+    AttendanceTable table;
+    ParseStats stats;
+};
+
+// Maps path read-only; empty files get no mapping
+static bool mapFile(const std::string &path, MappedFile &file, std::string &error) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        error = path + ": " + strerror(errno);
+        close(fd);
+        return false;
+    }
+    file.size = st.st_size;
+    if (file.size) {
+        void *p = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            error = path + ": " + strerror(errno);
+            close(fd);
+            return false;
+        }
+        madvise(p, file.size, MADV_SEQUENTIAL);
+        file.data = (const char *)p;
+    }
+    close(fd);
+    return true;
+}
+
+// Cuts a file into chunks of about chunkBytes, each ending just after a newline
+static void splitFile(const MappedFile &file, uint16_t source, size_t chunkBytes, std::vector<Chunk> &chunks) {
+    const char *p = file.data;
+    const char *end = file.data + file.size;
+    while (p < end) {
+        const char *cut = end;
+        if ((size_t)(end - p) > chunkBytes) {
+            const char *newline = (const char *)memchr(p + chunkBytes, '\n', end - p - chunkBytes);
+            cut = newline ? newline + 1 : end;
+        }
+        Chunk chunk;
+        chunk.begin = p;
+        chunk.end = cut;
+        chunk.source = source;
+        chunks.push_back(std::move(chunk));
+        p = cut;
+    }
+}
+
+bool ingestFiles(const std::vector<std::string> &paths, const IngestOptions &options, AttendanceTable &out, ParseStats &stats, std::string &error) {
+    if (paths.size() > 65536) {
+        error = "too many files";
+        return false;
+    }
+    std::vector<MappedFile> files(paths.size());
+    bool ok = true;
+    for (size_t i = 0; i < paths.size() && ok; i++)
+        ok = mapFile(paths[i], files[i], error);
+
+    std::vector<Chunk> chunks;
+    for (size_t i = 0; i < files.size() && ok; i++)
+        splitFile(files[i], out.sources.size() + i, options.chunkBytes, chunks);
+
+    if (ok) {
+        parallelFor(chunks.size(), options.threads, [&](size_t i) {
+            parseChunk(chunks[i].begin, chunks[i].end, chunks[i].source, chunks[i].table, chunks[i].stats);
+        });
+
+        // Each chunk's name ids are local to it; map them onto out.names, serially since the
+        // dictionary is shared, and work out where each chunk's rows land
+        std::vector<std::vector<uint32_t>> remap(chunks.size());
+        std::vector<size_t> offset(chunks.size());
+        size_t rows = out.rows();
+        for (size_t i = 0; i < chunks.size(); i++) {
+            const NameDictionary &local = chunks[i].table.names;
+            remap[i].resize(local.size());
+            for (uint32_t id = 0; id < local.size(); id++)
+                remap[i][id] = out.names.intern(local.name(id));
+            offset[i] = rows;
+            rows += chunks[i].table.rows();
+            stats.rows += chunks[i].stats.rows;
+            stats.badRows += chunks[i].stats.badRows;
+            stats.bytes += chunks[i].stats.bytes;
+        }
+
+        // Copy columns into place in parallel; every chunk writes its own disjoint range
+        out.timestamp.resize(rows);
+        out.roll.resize(rows);
+        out.event.resize(rows);
+        out.nameId.resize(rows);
+        out.source.resize(rows);
+        parallelFor(chunks.size(), options.threads, [&](size_t i) {
+            AttendanceTable &part = chunks[i].table;
+            size_t at = offset[i];
+            std::copy(part.timestamp.begin(), part.timestamp.end(), out.timestamp.begin() + at);
+            std::copy(part.roll.begin(), part.roll.end(), out.roll.begin() + at);
+            std::copy(part.event.begin(), part.event.end(), out.event.begin() + at);
+            std::copy(part.source.begin(), part.source.end(), out.source.begin() + at);
+            for (size_t r = 0; r < part.nameId.size(); r++)
+                out.nameId[at + r] = remap[i][part.nameId[r]];
+            part = AttendanceTable();
+        });
+        out.sources.insert(out.sources.end(), paths.begin(), paths.end());
+    }
+
+    for (MappedFile &file : files)
+        if (file.data)
+            munmap((void *)file.data, file.size);
+    return ok;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// Loads many module CSVs into one AttendanceTable. Files are memory-mapped and cut into chunks at
+// row boundaries; worker threads parse chunks into tables of their own, which are then merged in
+// file order, again in parallel.
+
+#include "csv_scan.h"
+#include "table.h"
+
+#include <string>
+#include <vector>
+
+struct IngestOptions {
+    unsigned threads = 0;                  // 0 uses every hardware thread
+    size_t chunkBytes = 8u << 20;
+};
+
+// Returns false and sets error if a file cannot be opened or mapped
+bool ingestFiles(const std::vector<std::string> &paths, const IngestOptions &options, AttendanceTable &out, ParseStats &stats, std::string &error);
@@ -0,0 +1,336 @@
+// Loads attendance CSVs pulled from many modules (the RTR_Attendance.csv the firmware writes, or
+// the per-module files from tools/collector.cpp) into one columnar table, optionally keeps it as a
+// binary store, and prints reports from it as CSV.
+//
+// Build:  g++ -std=c++17 -O3 -march=native -pthread -o attendance_ingest tools/ingest/*.cpp
+// Run:    ./attendance_ingest [-t threads] [--scalar] [-o store] [-r report ...] file ...
+//         ./attendance_ingest --load store [-t threads] [-r report ...]
+//         ./attendance_ingest --synth rows [-m modules] dir
+//         ./attendance_ingest --bench rows [-m modules] [-t threads] [--scalar]
+//   -t        worker threads (default: all hardware threads)
+//   --scalar  find delimiters byte by byte instead of with SIMD
+//   -o        save the table as a binary store for --load
+//   -r        hours (per student per week), late or missing; may be repeated
+//   --late    cutoff for the late report as h:mm (default 9:00)
+//   --synth   write rows synthetic check-ins spread over modules files (default 32) into dir
+//   --bench   synthesize into a temporary directory, ingest it three times and report the best
+//             throughput in GB/s and rows/s, then time the store and every report
+
+#include "csv_scan.h"
+#include "ingest.h"
+#include "parallel.h"
+#include "query.h"
+#include "store.h"
+
+#include <unistd.h>
+
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const char *SYNTH_NAMES[] = {"Aarav Shah", "Priya Nair", "Rohan Gupta", "Ananya Iyer", "Kabir Singh", "Meera Joshi", "Vivaan Rao", "Isha Kulkarni"};
+
+// xorshift64, so every run writes the same files
+struct Random {
+    uint64_t state;
+    uint32_t next(uint32_t bound) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return (uint32_t)((state >> 32) * bound >> 32);
+    }
+};
+
+static char *put(char *p, unsigned value) {
+    return std::to_chars(p, p + 10, value).ptr;
+}
+
+// Writes rows as the firmware does: unpadded date and time, two digit year, one row per event
+static bool synthesize(const std::string &dir, uint64_t rows, unsigned modules, std::vector<std::string> &paths) {
+    paths.clear();
+    for (unsigned m = 0; m < modules; m++)
+        paths.push_back(dir + "/module" + std::to_string(m) + ".csv");
+    bool ok = true;
+    parallelFor(modules, 0, [&](size_t m) {
+        FILE *f = fopen(paths[m].c_str(), "w");
+        if (!f) {
+            ok = false;
+            return;
+        }
+        Random random{0x9e3779b97f4a7c15ull ^ (m + 1)};
+        uint64_t count = rows / modules + (m < rows % modules);
+        std::vector<char> buffer(1 << 16);
+        size_t used = 0;
+        unsigned day = 1, month = 1, year = 23, seconds = 8 * 3600;
+        for (uint64_t i = 0; i < count; i++) {
+            seconds += random.next(20);
+            if (seconds >= 18 * 3600) {
+                seconds = 8 * 3600;
+                if (++day > 28) {
+                    day = 1;
+                    if (++month > 12) {
+                        month = 1;
+                        year++;
+                    }
+                }
+            }
+            if (buffer.size() - used < 96) {
+                fwrite(buffer.data(), 1, used, f);
+                used = 0;
+            }
+            unsigned roll = random.next(2000);
+            const char *name = SYNTH_NAMES[roll % 8];
+            char *p = buffer.data() + used;
+            p = put(p, day);
+            *p++ = '/';
+            p = put(p, month);
+            *p++ = '/';
+            p = put(p, year);
+            *p++ = ',';
+            p = put(p, seconds / 3600);
+            *p++ = ':';
+            p = put(p, seconds / 60 % 60);
+            *p++ = ':';
+            p = put(p, seconds % 60);
+            *p++ = ',';
+            p = put(p, roll);
+            *p++ = ',';
+            size_t len = strlen(name);
+            memcpy(p, name, len);
+            p += len;
+            const char *event = random.next(2) ? ",Arrival\n" : ",Departure\n";
+            len = strlen(event);
+            memcpy(p, event, len);
+            p += len;
+            used = p - buffer.data();
+        }
+        fwrite(buffer.data(), 1, used, f);
+        if (fclose(f) != 0)
+            ok = false;
+    });
+    return ok;
+}
+
+static double seconds(std::chrono::steady_clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+}
+
+static void printSummary(FILE *out, const AttendanceTable &table, const ParseStats &stats, double elapsed) {
+    uint64_t arrivals = 0;
+    for (uint8_t e : table.event)
+        arrivals += e == EVENT_ARRIVAL;
+    fprintf(out, "files      %zu\n", table.sources.size());
+    fprintf(out, "rows       %zu (%llu arrivals, %llu departures)\n", table.rows(), (unsigned long long)arrivals, (unsigned long long)(table.rows() - arrivals));
+    fprintf(out, "names      %zu\n", table.names.size());
+    if (stats.bytes) {
+        fprintf(out, "bad rows   %llu\n", (unsigned long long)stats.badRows);
+        fprintf(out, "bytes      %llu\n", (unsigned long long)stats.bytes);
+        fprintf(out, "scan       %s\n", scanKind());
+        fprintf(out, "time       %.3f s, %.2f GB/s, %.1f M rows/s\n", elapsed, stats.bytes / elapsed / 1e9, stats.rows / elapsed / 1e6);
+    } else {
+        fprintf(out, "time       %.3f s\n", elapsed);
+    }
+}
+
+static void printDate(FILE *out, uint32_t days) {
+    int year;
+    unsigned month, day;
+    civilDate(days, year, month, day);
+    fprintf(out, "%04d-%02u-%02u", year, month, day);
+}
+
+// Builds and prints one report; out is null when only timing it
+static bool runReport(FILE *out, const std::string &name, const AttendanceTable &table, const std::vector<Visit> &visits, uint32_t cutoff) {
+    if (name == "hours") {
+        std::vector<WeekHours> rows = reportHours(table, visits);
+        if (!out)
+            return true;
+        fprintf(out, "roll,name,week,hours,visits\n");
+        for (const WeekHours &r : rows) {
+            std::string_view studentName = table.names.name(r.nameId);
+            fprintf(out, "%u,%.*s,", r.roll, (int)studentName.size(), studentName.data());
+            printDate(out, r.weekStart);
+            fprintf(out, ",%.2f,%u\n", r.seconds / 3600.0, r.visits);
+        }
+    } else if (name == "late") {
+        std::vector<LateSummary> rows = reportLate(table, visits, cutoff);
+        if (!out)
+            return true;
+        fprintf(out, "roll,name,days_present,days_late,minutes_late\n");
+        for (const LateSummary &r : rows) {
+            std::string_view studentName = table.names.name(r.nameId);
+            fprintf(out, "%u,%.*s,%u,%u,%u\n", r.roll, (int)studentName.size(), studentName.data(), r.daysPresent, r.daysLate, r.minutesLate);
+        }
+    } else if (name == "missing") {
+        std::vector<MissingSummary> rows = reportMissing(table, visits);
+        if (!out)
+            return true;
+        fprintf(out, "roll,name,missing_departures,last_missing,departures_without_arrival\n");
+        for (const MissingSummary &r : rows) {
+            std::string_view studentName = table.names.name(r.nameId);
+            fprintf(out, "%u,%.*s,%u,", r.roll, (int)studentName.size(), studentName.data(), r.count);
+            if (r.count)
+                printDate(out, r.lastDay);
+            fprintf(out, ",%u\n", r.orphans);
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static int usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [-t threads] [--scalar] [-o store] [-r hours|late|missing] [--late h:mm] file ...\n", argv0);
+    fprintf(stderr, "       %s --load store [-t threads] [-r hours|late|missing] [--late h:mm]\n", argv0);
+    fprintf(stderr, "       %s --synth rows [-m modules] dir\n", argv0);
+    fprintf(stderr, "       %s --bench rows [-m modules] [-t threads] [--scalar]\n", argv0);
+    return 2;
+}
+
+// Synthesizes benchRows rows, then times ingestion (best of three), the store and the reports
+static int bench(uint64_t benchRows, unsigned modules, const IngestOptions &options, uint32_t cutoff) {
+    char dir[] = "/tmp/attendance_ingestXXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::vector<std::string> paths;
+    bool ok = synthesize(dir, benchRows, modules, paths);
+    AttendanceTable best;
+    ParseStats bestStats;
+    double bestTime = 0;
+    std::string error;
+    for (int run = 0; run < 3 && ok; run++) {
+        AttendanceTable table;
+        ParseStats stats;
+        auto start = std::chrono::steady_clock::now();
+        ok = ingestFiles(paths, options, table, stats, error);
+        double elapsed = seconds(std::chrono::steady_clock::now() - start);
+        if (ok && (run == 0 || elapsed < bestTime)) {
+            best = std::move(table);
+            bestStats = stats;
+            bestTime = elapsed;
+        }
+    }
+    for (const std::string &path : paths)
+        unlink(path.c_str());
+    if (!ok) {
+        rmdir(dir);
+        fprintf(stderr, "%s\n", error.empty() ? "cannot write synthetic logs" : error.c_str());
+        return 1;
+    }
+    printf("threads    %u\n", options.threads ? options.threads : defaultThreads());
+    printSummary(stdout, best, bestStats, bestTime);
+
+    std::string storePath = std::string(dir) + "/store.bin";
+    auto start = std::chrono::steady_clock::now();
+    ok = storeSave(storePath, best, error);
+    printf("save       %.3f s\n", seconds(std::chrono::steady_clock::now() - start));
+    start = std::chrono::steady_clock::now();
+    ok = ok && storeLoad(storePath, best, error);
+    printf("load       %.3f s\n", seconds(std::chrono::steady_clock::now() - start));
+    unlink(storePath.c_str());
+    rmdir(dir);
+    if (!ok) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    auto reportStart = std::chrono::steady_clock::now();
+    SortedRows sorted = sortByRollTime(best, options.threads);
+    printf("sort       %.3f s\n", seconds(std::chrono::steady_clock::now() - reportStart));
+    start = std::chrono::steady_clock::now();
+    std::vector<Visit> visits = pairVisits(sorted, options.threads);
+    printf("pair       %.3f s (%zu visits)\n", seconds(std::chrono::steady_clock::now() - start), visits.size());
+    for (const char *name : {"hours", "late", "missing"}) {
+        start = std::chrono::steady_clock::now();
+        runReport(nullptr, name, best, visits, cutoff);
+        printf("%-10s %.3f s\n", name, seconds(std::chrono::steady_clock::now() - start));
+    }
+    printf("reports    %.3f s in total\n", seconds(std::chrono::steady_clock::now() - reportStart));
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    IngestOptions options;
+    uint64_t synthRows = 0, benchRows = 0;
+    unsigned modules = 32;
+    uint32_t cutoff = 9 * 3600;
+    std::string loadPath, savePath;
+    std::vector<std::string> paths, reports;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        unsigned h, m;
+        if (arg == "-t" && i + 1 < argc)
+            options.threads = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "-m" && i + 1 < argc)
+            modules = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "-o" && i + 1 < argc)
+            savePath = argv[++i];
+        else if (arg == "-r" && i + 1 < argc)
+            reports.push_back(argv[++i]);
+        else if (arg == "--late" && i + 1 < argc && sscanf(argv[i + 1], "%u:%u", &h, &m) == 2 && h < 24 && m < 60 && ++i)
+            cutoff = h * 3600 + m * 60;
+        else if (arg == "--load" && i + 1 < argc)
+            loadPath = argv[++i];
+        else if (arg == "--synth" && i + 1 < argc)
+            synthRows = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--bench" && i + 1 < argc)
+            benchRows = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--scalar")
+            setScalarScan(true);
+        else if (arg[0] == '-')
+            return usage(argv[0]);
+        else
+            paths.push_back(arg);
+    }
+    if (modules == 0 || modules > 65536)
+        return usage(argv[0]);
+    for (const std::string &report : reports)
+        if (report != "hours" && report != "late" && report != "missing")
+            return usage(argv[0]);
+
+    if (synthRows) {
+        if (paths.size() != 1)
+            return usage(argv[0]);
+        std::vector<std::string> written;
+        if (!synthesize(paths[0], synthRows, modules, written)) {
+            fprintf(stderr, "cannot write to %s\n", paths[0].c_str());
+            return 1;
+        }
+        return 0;
+    }
+
+    if (benchRows)
+        return paths.empty() ? bench(benchRows, modules, options, cutoff) : usage(argv[0]);
+
+    if (paths.empty() == loadPath.empty())
+        return usage(argv[0]);
+    AttendanceTable table;
+    ParseStats stats;
+    std::string error;
+    auto start = std::chrono::steady_clock::now();
+    bool ok = loadPath.empty() ? ingestFiles(paths, options, table, stats, error) : storeLoad(loadPath, table, error);
+    if (ok && !savePath.empty())
+        ok = storeSave(savePath, table, error);
+    if (!ok) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    // Reports own stdout when there are any
+    printSummary(reports.empty() ? stdout : stderr, table, stats, seconds(std::chrono::steady_clock::now() - start));
+
+    if (!reports.empty()) {
+        std::vector<Visit> visits = pairVisits(sortByRollTime(table, options.threads), options.threads);
+        for (size_t i = 0; i < reports.size(); i++) {
+            if (i)
+                printf("\n");
+            runReport(stdout, reports[i], table, visits, cutoff);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Hardware threads, or 1 if the count is unknown
+inline unsigned defaultThreads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+// Runs fn(i) for every i in [0, count) on up to threads threads. Indices are handed out from a
+// shared counter, so uneven items still keep every thread busy.
+template <typename Fn>
+void parallelFor(size_t count, unsigned threads, Fn fn) {
+    if (threads == 0)
+        threads = defaultThreads();
+    threads = (unsigned)std::min<size_t>(threads, count);
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; i++)
+            fn(i);
+        return;
+    }
+    std::atomic<size_t> nextIndex{0};
+    auto worker = [&] {
+        for (size_t i; (i = nextIndex.fetch_add(1, std::memory_order_relaxed)) < count;)
+            fn(i);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++)
+        pool.emplace_back(worker);
+    worker();
+    for (std::thread &t : pool)
+        t.join();
+}
@@ -0,0 +1,166 @@
+#include "query.h"
+#include "parallel.h"
+
+#include <algorithm>
+
+static inline uint32_t dayOf(uint32_t timestamp) {
+    return timestamp / 86400;
+}
+
+SortedRows sortByRollTime(const AttendanceTable &table, unsigned threads) {
+    if (threads == 0)
+        threads = defaultThreads();
+    size_t rows = table.rows();
+    size_t runs = std::max<size_t>(1, std::min<size_t>(threads, rows / 65536));
+    std::vector<size_t> bounds(runs + 1);
+    for (size_t i = 0; i <= runs; i++)
+        bounds[i] = rows * i / runs;
+
+    // Partition by roll number: every thread counts the rolls in its slice of rows, and the
+    // prefix sums over (roll, slice) give each slice its own place inside every roll's bucket,
+    // so the scatter needs no locking and keeps rows of a roll in table order
+    std::vector<std::vector<uint32_t>> counts(runs, std::vector<uint32_t>(65536));
+    parallelFor(runs, threads, [&](size_t run) {
+        for (size_t i = bounds[run]; i < bounds[run + 1]; i++)
+            counts[run][table.roll[i]]++;
+    });
+    SortedRows sorted;
+    std::vector<size_t> &rollStart = sorted.rollStart;
+    rollStart.resize(65537);
+    size_t at = 0;
+    for (size_t roll = 0; roll < 65536; roll++) {
+        rollStart[roll] = at;
+        for (size_t run = 0; run < runs; run++) {
+            uint32_t n = counts[run][roll];
+            counts[run][roll] = at;
+            at += n;
+        }
+    }
+    rollStart[65536] = at;
+
+    // The event rides in the key so pairing never has to go back to the table
+    std::vector<uint64_t> &keys = sorted.keys;
+    keys.resize(rows);
+    parallelFor(runs, threads, [&](size_t run) {
+        std::vector<uint32_t> &next = counts[run];
+        for (size_t i = bounds[run]; i < bounds[run + 1]; i++)
+            keys[next[table.roll[i]]++] = (uint64_t)table.timestamp[i] << 32 | i << 1 | (table.event[i] == EVENT_DEPARTURE);
+    });
+    counts.clear();
+
+    // Then sort each roll's bucket by time. Rows arrive from each module file already in time
+    // order, so buckets are a few presorted runs and sort quickly.
+    parallelFor(256, threads, [&](size_t group) {
+        for (size_t roll = group * 256; roll < group * 256 + 256; roll++)
+            std::sort(keys.begin() + rollStart[roll], keys.begin() + rollStart[roll + 1]);
+    });
+    return sorted;
+}
+
+// Pairs one student's keys, walking them in time order
+static void pairRoll(const uint64_t *key, const uint64_t *end, uint16_t roll, std::vector<Visit> &out) {
+    Visit open;
+    bool isOpen = false;
+    for (; key < end; key++) {
+        uint32_t timestamp = *key >> 32;
+        uint32_t row = (uint32_t)*key >> 1;
+        if (isOpen && dayOf(timestamp) != dayOf(open.arrive)) {
+            out.push_back(open);        // left without checking out
+            isOpen = false;
+        }
+        if (!(*key & 1)) {
+            if (isOpen)
+                out.push_back(open);    // checked in twice
+            open = {timestamp, 0, row, roll};
+            isOpen = true;
+        } else if (isOpen) {
+            open.depart = timestamp;
+            out.push_back(open);
+            isOpen = false;
+        } else {
+            out.push_back({0, timestamp, row, roll});
+        }
+    }
+    if (isOpen)
+        out.push_back(open);
+}
+
+std::vector<Visit> pairVisits(const SortedRows &sorted, unsigned threads) {
+    // Rolls are independent, so blocks of 256 of them are paired in parallel and joined in order
+    std::vector<std::vector<Visit>> pieces(256);
+    parallelFor(pieces.size(), threads, [&](size_t group) {
+        size_t first = group * 256;
+        pieces[group].reserve((sorted.rollStart[first + 256] - sorted.rollStart[first]) * 3 / 4);
+        for (size_t roll = first; roll < first + 256; roll++)
+            pairRoll(sorted.keys.data() + sorted.rollStart[roll], sorted.keys.data() + sorted.rollStart[roll + 1], roll, pieces[group]);
+    });
+    size_t total = 0;
+    for (const std::vector<Visit> &piece : pieces)
+        total += piece.size();
+    std::vector<Visit> visits;
+    visits.reserve(total);
+    for (std::vector<Visit> &piece : pieces) {
+        visits.insert(visits.end(), piece.begin(), piece.end());
+        piece = std::vector<Visit>();
+    }
+    return visits;
+}
+
+std::vector<WeekHours> reportHours(const AttendanceTable &table, const std::vector<Visit> &visits) {
+    std::vector<WeekHours> out;
+    for (const Visit &v : visits) {
+        if (!v.arrive || !v.depart)
+            continue;
+        uint32_t day = dayOf(v.arrive);
+        uint32_t monday = day - (day + 3) % 7;        // 1970-01-01 was a Thursday
+        if (out.empty() || out.back().roll != v.roll || out.back().weekStart != monday)
+            out.push_back({v.roll, table.nameId[v.row], monday, 0, 0});
+        WeekHours &week = out.back();
+        week.seconds += v.depart - v.arrive;
+        week.visits++;
+    }
+    return out;
+}
+
+std::vector<LateSummary> reportLate(const AttendanceTable &table, const std::vector<Visit> &visits, uint32_t cutoff) {
+    std::vector<LateSummary> out;
+    uint32_t lastDay = 0;
+    for (const Visit &v : visits) {
+        if (!v.arrive)
+            continue;
+        if (out.empty() || out.back().roll != v.roll) {
+            out.push_back({v.roll, table.nameId[v.row], 0, 0, 0});
+            lastDay = UINT32_MAX;
+        }
+        LateSummary &student = out.back();
+        uint32_t day = dayOf(v.arrive);
+        if (day == lastDay)
+            continue;        // only the day's first arrival counts
+        lastDay = day;
+        student.daysPresent++;
+        uint32_t timeOfDay = v.arrive % 86400;
+        if (timeOfDay > cutoff) {
+            student.daysLate++;
+            student.minutesLate += (timeOfDay - cutoff) / 60;
+        }
+    }
+    return out;
+}
+
+std::vector<MissingSummary> reportMissing(const AttendanceTable &table, const std::vector<Visit> &visits) {
+    std::vector<MissingSummary> out;
+    for (const Visit &v : visits) {
+        if (v.arrive && v.depart)
+            continue;
+        if (out.empty() || out.back().roll != v.roll)
+            out.push_back({v.roll, table.nameId[v.row], 0, 0, 0});
+        MissingSummary &student = out.back();
+        if (v.depart) {
+            student.orphans++;
+        } else {
+            student.count++;
+            student.lastDay = dayOf(v.arrive);
+        }
+    }
+    return out;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+// Reports over an AttendanceTable. Rows are first put in (roll, time) order by a parallel
+// partition on roll and sort within each roll; a merge pass over that order then pairs each
+// arrival with the departure that follows it on the same day, and the reports are single passes
+// over those visits.
+
+#include "table.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One stay on site. depart is 0 when no departure followed the arrival that day; arrive is 0
+// for a departure with no arrival before it.
+struct Visit {
+    uint32_t arrive;
+    uint32_t depart;
+    uint32_t row;        // the arrival's row, or the departure's when arrive is 0
+    uint16_t roll;
+};
+
+// Every row of a table in (roll, time, row) order
+struct SortedRows {
+    std::vector<uint64_t> keys;            // timestamp << 32 | row << 1 | 1 for a departure (so at most 2^31 rows)
+    std::vector<size_t> rollStart;         // roll r's keys are [rollStart[r], rollStart[r + 1])
+};
+
+SortedRows sortByRollTime(const AttendanceTable &table, unsigned threads);
+
+// Visits in (roll, time) order
+std::vector<Visit> pairVisits(const SortedRows &sorted, unsigned threads);
+
+struct WeekHours {
+    uint16_t roll;
+    uint32_t nameId;
+    uint32_t weekStart;        // day number (days since 1970-01-01) of the Monday
+    uint32_t seconds;          // on site, summed over complete visits
+    uint32_t visits;
+};
+
+struct LateSummary {
+    uint16_t roll;
+    uint32_t nameId;
+    uint32_t daysPresent;
+    uint32_t daysLate;         // days whose first arrival was after the cutoff
+    uint32_t minutesLate;      // summed over the late days
+};
+
+struct MissingSummary {
+    uint16_t roll;
+    uint32_t nameId;
+    uint32_t count;            // arrivals with no departure the same day
+    uint32_t orphans;          // departures with no arrival before them
+    uint32_t lastDay;          // day number of the latest arrival without a departure
+};
+
+// Hours on site per student per week
+std::vector<WeekHours> reportHours(const AttendanceTable &table, const std::vector<Visit> &visits);
+
+// First arrival per student per day against cutoff, given as seconds after midnight
+std::vector<LateSummary> reportLate(const AttendanceTable &table, const std::vector<Visit> &visits, uint32_t cutoff);
+
+// Students with unmatched arrivals or departures
+std::vector<MissingSummary> reportMissing(const AttendanceTable &table, const std::vector<Visit> &visits);
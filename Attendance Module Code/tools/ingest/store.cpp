@@ -0,0 +1,111 @@
+#include "store.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+struct __attribute__((packed)) StoreHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t rows;
+    uint32_t names;
+    uint32_t sources;
+};
+
+static const char STORE_MAGIC[4] = {'A', 'T', 'T', 'S'};
+static const char STORE_END[4] = {'A', 'T', 'T', 'E'};
+
+template <typename T>
+static bool writeColumn(FILE *f, const std::vector<T> &column) {
+    return fwrite(column.data(), sizeof(T), column.size(), f) == column.size();
+}
+
+template <typename T>
+static bool readColumn(FILE *f, std::vector<T> &column, size_t rows) {
+    column.resize(rows);
+    return fread(column.data(), sizeof(T), rows, f) == rows;
+}
+
+static bool writeString(FILE *f, std::string_view s) {
+    uint32_t len = s.size();
+    return fwrite(&len, sizeof(len), 1, f) == 1 && fwrite(s.data(), 1, len, f) == len;
+}
+
+static bool readString(FILE *f, std::string &s) {
+    uint32_t len;
+    if (fread(&len, sizeof(len), 1, f) != 1 || len > 65536)
+        return false;
+    s.resize(len);
+    return fread(&s[0], 1, len, f) == len;
+}
+
+bool storeSave(const std::string &path, const AttendanceTable &table, std::string &error) {
+    // Written under a temporary name and renamed, so an interrupted save keeps the previous store
+    std::string tmpPath = path + ".tmp";
+    FILE *f = fopen(tmpPath.c_str(), "wb");
+    if (!f) {
+        error = tmpPath + ": " + strerror(errno);
+        return false;
+    }
+    std::vector<char> buffer(1 << 20);
+    setvbuf(f, buffer.data(), _IOFBF, buffer.size());
+
+    StoreHeader header;
+    memcpy(header.magic, STORE_MAGIC, 4);
+    header.version = STORE_VERSION;
+    header.rows = table.rows();
+    header.names = table.names.size();
+    header.sources = table.sources.size();
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 && writeColumn(f, table.timestamp) && writeColumn(f, table.roll) &&
+              writeColumn(f, table.event) && writeColumn(f, table.nameId) && writeColumn(f, table.source);
+    for (uint32_t i = 0; ok && i < header.names; i++)
+        ok = writeString(f, table.names.name(i));
+    for (uint32_t i = 0; ok && i < header.sources; i++)
+        ok = writeString(f, table.sources[i]);
+    ok = ok && fwrite(STORE_END, 1, 4, f) == 4;
+    if (fclose(f) != 0)
+        ok = false;
+    if (ok && rename(tmpPath.c_str(), path.c_str()) == 0)
+        return true;
+    error = path + ": " + strerror(errno);
+    remove(tmpPath.c_str());
+    return false;
+}
+
+bool storeLoad(const std::string &path, AttendanceTable &table, std::string &error) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    StoreHeader header;
+    long size = fseek(f, 0, SEEK_END) == 0 ? ftell(f) : -1;
+    rewind(f);
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 && memcmp(header.magic, STORE_MAGIC, 4) == 0 && header.version == STORE_VERSION &&
+              size >= 0 && header.rows <= (uint64_t)size / 13;        // 13 bytes per row across the columns
+    if (ok) {
+        table = AttendanceTable();
+        ok = readColumn(f, table.timestamp, header.rows) && readColumn(f, table.roll, header.rows) && readColumn(f, table.event, header.rows) &&
+             readColumn(f, table.nameId, header.rows) && readColumn(f, table.source, header.rows);
+    }
+    std::string s;
+    for (uint32_t i = 0; ok && i < header.names; i++) {
+        ok = readString(f, s);
+        if (ok && table.names.intern(s) != i)        // a repeated name would shift every later id
+            ok = false;
+    }
+    for (uint32_t i = 0; ok && i < header.sources; i++) {
+        ok = readString(f, s);
+        table.sources.push_back(s);
+    }
+    char end[4];
+    ok = ok && fread(end, 1, 4, f) == 4 && memcmp(end, STORE_END, 4) == 0;
+    fclose(f);
+    for (size_t i = 0; ok && i < table.rows(); i++)
+        ok = table.nameId[i] < header.names && table.source[i] < header.sources && (table.event[i] == EVENT_ARRIVAL || table.event[i] == EVENT_DEPARTURE);
+    if (!ok) {
+        error = path + ": not a valid attendance store";
+        table = AttendanceTable();
+    }
+    return ok;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// On-disk form of an AttendanceTable: a header, each column as one raw array, then the name and
+// source strings. Loading is a handful of large reads straight into the column vectors.
+//
+//   "ATTS" u32 version u64 rows u32 names u32 sources
+//   u32 timestamp[rows] u16 roll[rows] u8 event[rows] u32 nameId[rows] u16 source[rows]
+//   names, then sources, each as u32 length + bytes
+//   "ATTE"
+
+#include "table.h"
+
+#include <string>
+
+#define STORE_VERSION 1
+
+// Both return false and set error on any I/O failure or, for loads, a malformed file
+bool storeSave(const std::string &path, const AttendanceTable &table, std::string &error);
+bool storeLoad(const std::string &path, AttendanceTable &table, std::string &error);
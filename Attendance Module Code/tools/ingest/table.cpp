@@ -0,0 +1,41 @@
+#include "table.h"
+
+uint32_t NameDictionary::intern(std::string_view name) {
+    auto it = ids.find(name);
+    if (it != ids.end())
+        return it->second;
+    uint32_t id = names.size();
+    names.emplace_back(name);
+    ids.emplace(names.back(), id);
+    return id;
+}
+
+void AttendanceTable::reserve(size_t n) {
+    timestamp.reserve(n);
+    roll.reserve(n);
+    event.reserve(n);
+    nameId.reserve(n);
+    source.reserve(n);
+}
+
+uint32_t toEpoch(int year, unsigned month, unsigned day, unsigned hours, unsigned minutes, unsigned seconds) {
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    unsigned yoe = (unsigned)(year - era * 400);
+    unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int32_t days = era * 146097 + (int32_t)doe - 719468;
+    return (uint32_t)days * 86400u + hours * 3600u + minutes * 60u + seconds;
+}
+
+void civilDate(uint32_t days, int &year, unsigned &month, unsigned &day) {
+    int32_t z = (int32_t)days + 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = (int)yoe + era * 400 + (month <= 2);
+}
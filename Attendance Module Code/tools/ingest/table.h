@@ -0,0 +1,48 @@
+#pragma once
+
+// Columnar in-memory table of check-ins pulled from any number of modules. One entry per row in
+// each column vector; names are interned so a row only carries a 32 bit id.
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+enum : uint8_t {
+    EVENT_ARRIVAL = 1,
+    EVENT_DEPARTURE = 2,
+};
+
+// Interned student names. Ids are dense and stable; views handed out stay valid for the
+// dictionary's lifetime.
+class NameDictionary {
+  public:
+    uint32_t intern(std::string_view name);
+    std::string_view name(uint32_t id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+
+  private:
+    std::deque<std::string> names;        // deque: growing it never moves existing strings
+    std::unordered_map<std::string_view, uint32_t> ids;
+};
+
+struct AttendanceTable {
+    std::vector<uint32_t> timestamp;        // seconds since 1970-01-01, module local time
+    std::vector<uint16_t> roll;
+    std::vector<uint8_t> event;             // EVENT_ARRIVAL or EVENT_DEPARTURE
+    std::vector<uint32_t> nameId;           // into names
+    std::vector<uint16_t> source;           // index of the file the row came from
+    NameDictionary names;
+    std::vector<std::string> sources;       // file paths, by source index
+
+    size_t rows() const { return timestamp.size(); }
+    void reserve(size_t n);
+};
+
+// Seconds since 1970-01-01 for a civil date and time (proleptic Gregorian), as the firmware's toEpoch()
+uint32_t toEpoch(int year, unsigned month, unsigned day, unsigned hours, unsigned minutes, unsigned seconds);
+
+// The civil date of a day number (days since 1970-01-01), the inverse of toEpoch's date part
+void civilDate(uint32_t days, int &year, unsigned &month, unsigned &day);
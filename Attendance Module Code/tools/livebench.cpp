@@ -0,0 +1,517 @@
+// Load test for the /live feed (src/live.h): opens hundreds of Server-Sent Events subscribers,
+// some of them deliberately slow, and checks what each one got. Fast subscribers must see every
+// record exactly once and in order; slow ones may lose events to backpressure but must be able to
+// tell (the first sequence number of an event jumps) and fill the hole from /events. Subscribers
+// also drop their connection now and then and come back with Last-Event-ID, which must replay
+// what they missed.
+//
+// With no host given it runs against a stand-in server in the same process (standin.h) that
+// follows the module's rules: batches of JOURNAL_FLUSH_THRESHOLD commits, a LIVE_HISTORY record
+// replay buffer, a send every LIVE_BATCH_MS held back while clients are backed up, and at most
+// SSE_QUEUE_LIMIT events queued per client (the web server library's limit), the rest dropped.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -o livebench tools/livebench.cpp
+// Run:    ./livebench [-n subscribers] [-s slow] [-t seconds] [-r rate] [-c seconds] [host[:port]]
+//   -n  subscribers (default 200)
+//   -s  how many of them read slowly, a few hundred bytes a second (default 20)
+//   -t  how long to run (default 10)
+//   -r  check-ins per second made by the stand-in server (default 20)
+//   -c  seconds between reconnects of each fast subscriber, 0 for never (default 3)
+
+#include "standin.h"
+
+#include <netdb.h>
+#include <signal.h>
+#include <sys/resource.h>
+
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+
+// As in src/journal.h and src/live.h
+static const uint32_t FLUSH_THRESHOLD = 8;
+static const uint32_t IDLE_FLUSH_MS = 3000;
+static const uint32_t HISTORY = 64;
+static const uint32_t EVENT_RECORDS = 16;
+static const uint32_t BATCH_MS = 250;
+static const uint32_t MAX_HOLD_MS = 2000;
+static const uint32_t BACKLOG = 4;
+static const uint32_t RECONNECT_MS = 3000;
+static const size_t SSE_QUEUE_LIMIT = 32;        // SSE_MAX_QUEUED_MESSAGES in ESPAsyncWebServer
+
+static const int SLOW_READ_BYTES = 512;
+static const int SLOW_READ_MS = 250;
+
+//----------------------------------------STAND-IN MODULE---------------------------------------
+struct Record {
+    uint32_t seq;
+    uint32_t timestamp;
+    uint16_t rollNum;
+    bool arrival;
+};
+
+class LiveStandIn : public StandIn {
+  public:
+    explicit LiveStandIn(uint32_t rate) : rate(rate) {}
+
+    // When a record was committed, for latency
+    double commitTime(uint32_t seq) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return seq < committedAt.size() ? committedAt[seq] : 0;
+    }
+
+    uint64_t committed() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return log.size();
+    }
+
+    std::atomic<uint64_t> eventsSent{ 0 };
+    std::atomic<uint64_t> eventsDropped{ 0 };
+
+  private:
+    void tick(double now) override {
+        if (started == 0)
+            started = lastTick = lastAppend = lastSend = now;
+
+        // The keypad: check-ins at the given rate, flushed as the journal does
+        uint64_t due = (uint64_t)((now - started) * rate / 1000);
+        for (; made < due; made++) {
+            rng = rng * 1103515245 + 12345;
+            pending.push_back({ 0, (uint32_t)time(nullptr), (uint16_t)(1 + (rng >> 16) % 500), ((rng >> 8) & 1) != 0 });
+            lastAppend = now;
+        }
+        if (pending.size() >= FLUSH_THRESHOLD || (!pending.empty() && now - lastAppend >= IDLE_FLUSH_MS)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (Record &r : pending) {
+                r.seq = log.size();
+                log.push_back(r);
+                committedAt.push_back(now);
+            }
+            pending.clear();
+        }
+
+        // The live task
+        if (now - lastTick >= BATCH_MS) {
+            lastTick = now;
+            uint32_t end = log.size();
+            size_t live = 0, waiting = 0;
+            for (Connection &c : conns) {
+                if (c.live) {
+                    live++;
+                    waiting += c.queue.size() + !c.out.empty();
+                }
+            }
+            if (end == sentSeq || live == 0) {
+                sentSeq = end;
+                lastSend = now;
+            } else if (waiting / live < BACKLOG || end - sentSeq >= EVENT_RECORDS || now - lastSend >= MAX_HOLD_MS) {
+                sentSeq = sendRange(nullptr, sentSeq, end);
+                lastSend = now;
+            }
+        }
+    }
+
+    void request(Connection &c, const std::string &path) override {
+        uint32_t lastId = 0;
+        size_t at = c.in.find("Last-Event-ID: ");
+        if (at != std::string::npos)
+            lastId = strtoul(c.in.c_str() + at + 15, nullptr, 10);
+
+        if (path == "/live") {
+            c.live = true;
+            c.out = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                    "Connection: keep-alive\r\n\r\n";
+            if (lastId == 0 || lastId > sentSeq) {
+                char hello[64];
+                snprintf(hello, sizeof(hello), "retry: %u\nid: %u\nevent: hello\ndata: %u\n\n", RECONNECT_MS, sentSeq, sentSeq);
+                c.queue.push_back(hello);
+            } else {
+                sendRange(&c, lastId, sentSeq);
+            }
+        } else if (path.compare(0, 8, "/events?") == 0) {
+            std::string body;
+            std::lock_guard<std::mutex> lock(mutex);
+            uint32_t since = queryValue(path, "since", 0);
+            uint32_t limit = std::min<uint32_t>(queryValue(path, "limit", 500), 5000);
+            for (uint32_t seq = since; seq < log.size() && seq < since + limit; seq++)
+                body += line(log[seq]) + "\n";
+            c.out = "HTTP/1.1 200 OK\r\nContent-Type: text/csv\r\nConnection: close\r\nContent-Length: " +
+                    std::to_string(body.size()) + "\r\n\r\n" + body;
+            c.closing = true;
+        } else {
+            c.out = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            c.closing = true;
+        }
+    }
+
+    static std::string line(const Record &r) {
+        time_t t = r.timestamp;
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        char buf[96];
+        snprintf(buf, sizeof(buf), "%u,%d/%d/%d,%d:%d:%d,%u,Student %u,%s", r.seq, tm.tm_mday, tm.tm_mon + 1, tm.tm_year % 100, tm.tm_hour,
+                 tm.tm_min, tm.tm_sec, r.rollNum, r.rollNum, r.arrival ? "Arrival" : "Departure");
+        return buf;
+    }
+
+    // Queues an event for one client, or every live one, dropping it where the queue is full
+    void post(Connection *to, const std::string &event) {
+        for (Connection &c : conns) {
+            if (!c.live || c.fd < 0 || (to && to != &c))
+                continue;
+            if (c.queue.size() >= SSE_QUEUE_LIMIT) {
+                eventsDropped++;
+                continue;
+            }
+            c.queue.push_back(event);
+            eventsSent++;
+            flush(c);
+        }
+    }
+
+    // Every record is kept, but only the last HISTORY are served from /live, as on the module
+    uint32_t sendRange(Connection *to, uint32_t from, uint32_t end) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (log.size() > HISTORY && from < log.size() - HISTORY)
+            from = log.size() - HISTORY;
+        while (from < end) {
+            uint32_t stop = std::min(end, from + EVENT_RECORDS);
+            std::string event = "id: " + std::to_string(stop) + "\nevent: checkin\n";
+            for (uint32_t seq = from; seq < stop; seq++)
+                event += "data: " + line(log[seq]) + "\n";
+            post(to, event + "\n");
+            from = stop;
+        }
+        return std::max(from, end);
+    }
+
+    uint32_t rate;
+    double started = 0, lastTick = 0, lastAppend = 0, lastSend = 0;
+    uint64_t made = 0;
+    std::vector<Record> pending;
+    uint32_t rng = 1;
+    std::mutex mutex;        // guards log and committedAt
+    std::vector<Record> log;
+    std::vector<double> committedAt;
+    uint32_t sentSeq = 0;
+};
+
+//----------------------------------------SUBSCRIBERS---------------------------------------
+struct Gap {
+    uint32_t from;
+    uint32_t to;
+};
+
+struct Subscriber {
+    int fd = -1;
+    bool slow = false;
+    std::string buf;
+    bool headerDone = false;
+    uint32_t lastId = 0;
+    int64_t next = -1;                // sequence number expected next
+    double nextRead = 0;              // slow subscribers only read this often
+    double reconnectAt = 0;
+    uint64_t records = 0;
+    uint64_t events = 0;
+    uint64_t missed = 0;
+    uint64_t outOfOrder = 0;          // a record at or before one already seen
+    uint64_t reconnects = 0;
+    std::vector<Gap> gaps;
+};
+
+static sockaddr_in target;
+
+static int connectTo(bool slow) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (slow) {
+        int small = 2048;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+    }
+    if (connect(fd, (sockaddr *)&target, sizeof(target)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool subscribe(Subscriber &s) {
+    s.fd = connectTo(s.slow);
+    if (s.fd < 0)
+        return false;
+    std::string req = "GET /live HTTP/1.1\r\nHost: module\r\nAccept: text/event-stream\r\n";
+    if (s.lastId)
+        req += "Last-Event-ID: " + std::to_string(s.lastId) + "\r\n";
+    req += "\r\n";
+    send(s.fd, req.data(), req.size(), MSG_NOSIGNAL);
+    setNonBlocking(s.fd);
+    s.buf.clear();
+    s.headerDone = false;
+    return true;
+}
+
+// Blocking GET, returns the body
+static std::string fetch(const std::string &path) {
+    int fd = connectTo(false);
+    if (fd < 0)
+        return "";
+    std::string req = "GET " + path + " HTTP/1.1\r\nHost: module\r\nConnection: close\r\n\r\n";
+    send(fd, req.data(), req.size(), MSG_NOSIGNAL);
+    std::string reply;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+        reply.append(buf, n);
+    close(fd);
+    size_t body = reply.find("\r\n\r\n");
+    return body == std::string::npos ? "" : reply.substr(body + 4);
+}
+
+class Latency {
+  public:
+    void add(double ms) { samples.push_back(ms); }
+    double at(double p) {
+        if (samples.empty())
+            return 0;
+        size_t i = (size_t)(p * (samples.size() - 1));
+        std::nth_element(samples.begin(), samples.begin() + i, samples.end());
+        return samples[i];
+    }
+
+  private:
+    std::vector<double> samples;
+};
+
+static LiveStandIn *standIn = nullptr;
+static std::vector<double> firstSeen;        // against a real module: when any subscriber first got a record
+
+static double lagMs(uint32_t seq, double now) {
+    if (standIn)
+        return now - standIn->commitTime(seq);
+    if (firstSeen.size() <= seq)
+        firstSeen.resize(seq + 1, 0);
+    if (firstSeen[seq] == 0)
+        firstSeen[seq] = now;
+    return now - firstSeen[seq];
+}
+
+static void handleEvent(Subscriber &s, const std::string &text, Latency &lag, double now) {
+    std::string event, data;
+    uint32_t id = 0;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        std::string field = text.substr(pos, end - pos);
+        pos = end + 1;
+        if (field.compare(0, 4, "id: ") == 0)
+            id = strtoul(field.c_str() + 4, nullptr, 10);
+        else if (field.compare(0, 7, "event: ") == 0)
+            event = field.substr(7);
+        else if (field.compare(0, 6, "data: ") == 0)
+            data += field.substr(6) + "\n";
+    }
+    if (id)
+        s.lastId = id;
+    s.events++;
+    if (event == "hello") {
+        if (s.next < 0)
+            s.next = strtoul(data.c_str(), nullptr, 10);
+        return;
+    }
+    bool first = true;
+    for (size_t at = 0; at < data.size(); at = data.find('\n', at) + 1) {
+        uint32_t seq = strtoul(data.c_str() + at, nullptr, 10);
+        if (first && s.next >= 0 && seq > s.next) {
+            s.gaps.push_back({ (uint32_t)s.next, seq });
+            s.missed += seq - s.next;
+        }
+        first = false;
+        if (s.next >= 0 && seq < s.next) {
+            s.outOfOrder++;
+            continue;
+        }
+        s.next = seq + 1;
+        s.records++;
+        lag.add(lagMs(seq, now));
+    }
+}
+
+static void receive(Subscriber &s, Latency &lag, double now) {
+    char buf[8192];
+    ssize_t n = read(s.fd, buf, s.slow ? SLOW_READ_BYTES : sizeof(buf));
+    if (n <= 0) {
+        if (n < 0 && errno == EAGAIN)
+            return;
+        close(s.fd);        // the server hung up; come back the way a browser would
+        s.reconnects++;
+        subscribe(s);
+        return;
+    }
+    s.buf.append(buf, n);
+    if (!s.headerDone) {
+        size_t end = s.buf.find("\r\n\r\n");
+        if (end == std::string::npos)
+            return;
+        s.buf.erase(0, end + 4);
+        s.headerDone = true;
+    }
+    size_t end;
+    while ((end = s.buf.find("\n\n")) != std::string::npos) {
+        handleEvent(s, s.buf.substr(0, end + 1), lag, now);
+        s.buf.erase(0, end + 2);
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = 200, slow = 20, seconds = 10, rate = 20, churn = 3;
+    const char *host = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && argv[i][1] && !argv[i][2] && strchr("nstrc", argv[i][1]) && i + 1 < argc) {
+            uint32_t v = strtoul(argv[i + 1], nullptr, 10);
+            switch (argv[i][1]) {
+            case 'n': count = v; break;
+            case 's': slow = v; break;
+            case 't': seconds = v; break;
+            case 'r': rate = v; break;
+            case 'c': churn = v; break;
+            }
+            i++;
+        } else if (argv[i][0] != '-' && !host) {
+            host = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s [-n subscribers] [-s slow] [-t seconds] [-r rate] [-c seconds] [host[:port]]\n", argv[0]);
+            return 2;
+        }
+    }
+    slow = std::min(slow, count);
+    signal(SIGPIPE, SIG_IGN);
+    rlimit files;
+    getrlimit(RLIMIT_NOFILE, &files);
+    files.rlim_cur = files.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &files);
+
+    target.sin_family = AF_INET;
+    if (host) {
+        std::string name = host;
+        uint16_t port = 80;
+        size_t colon = name.find(':');
+        if (colon != std::string::npos) {
+            port = atoi(name.c_str() + colon + 1);
+            name.resize(colon);
+        }
+        hostent *he = gethostbyname(name.c_str());
+        if (!he) {
+            fprintf(stderr, "unknown host %s\n", name.c_str());
+            return 1;
+        }
+        memcpy(&target.sin_addr, he->h_addr, sizeof(target.sin_addr));
+        target.sin_port = htons(port);
+    } else {
+        standIn = new LiveStandIn(rate);
+        int port = standIn->start();
+        if (port < 0) {
+            fprintf(stderr, "stand-in server failed to start\n");
+            return 1;
+        }
+        target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        target.sin_port = htons(port);
+    }
+
+    std::vector<Subscriber> subs(count);
+    double started = nowMs();
+    for (uint32_t i = 0; i < count; i++) {
+        subs[i].slow = i < slow;
+        // Spread the reconnects out so they do not all land on the same tick
+        subs[i].reconnectAt = started + churn * 1000.0 * (i + 1) / count;
+        if (!subscribe(subs[i])) {
+            fprintf(stderr, "subscriber %u could not connect\n", i);
+            return 1;
+        }
+    }
+
+    Latency fastLag, slowLag;
+    double stopAt = started + seconds * 1000.0;
+    for (double now = started; now < stopAt; now = nowMs()) {
+        std::vector<pollfd> fds;
+        std::vector<Subscriber *> who;
+        for (Subscriber &s : subs) {
+            if (s.slow && now < s.nextRead)
+                continue;
+            fds.push_back({ s.fd, POLLIN, 0 });
+            who.push_back(&s);
+        }
+        poll(fds.data(), fds.size(), 10);
+        now = nowMs();
+        for (size_t i = 0; i < fds.size(); i++) {
+            Subscriber &s = *who[i];
+            if (fds[i].revents) {
+                receive(s, s.slow ? slowLag : fastLag, now);
+                if (s.slow)
+                    s.nextRead = now + SLOW_READ_MS;
+            }
+            // Only once it has an id to resume from; until then a browser would be sent "hello" again
+            if (!s.slow && churn && now >= s.reconnectAt && s.lastId) {
+                close(s.fd);
+                s.reconnects++;
+                s.reconnectAt = now + churn * 1000.0;
+                subscribe(s);
+            }
+        }
+    }
+    for (Subscriber &s : subs)
+        close(s.fd);
+
+    // Check that what went missing can be had from /events, as the live page does
+    uint32_t refills = 0, refillsOk = 0;
+    for (Subscriber &s : subs) {
+        for (const Gap &g : s.gaps) {
+            if (refills == 20)
+                break;
+            refills++;
+            std::string body = fetch("/events?since=" + std::to_string(g.from) + "&limit=" + std::to_string(g.to - g.from));
+            uint32_t want = g.from;
+            bool ok = true;
+            for (size_t at = 0; at < body.size(); at = body.find('\n', at) + 1)
+                ok = ok && strtoul(body.c_str() + at, nullptr, 10) == want++;
+            refillsOk += ok && want == g.to;
+        }
+    }
+
+    double elapsed = (nowMs() - started) / 1000;
+    if (standIn) {
+        standIn->stop();
+        printf("stand-in: %llu records committed in %.1f s, %llu events queued, %llu dropped for slow clients\n",
+               (unsigned long long)standIn->committed(), elapsed, (unsigned long long)standIn->eventsSent,
+               (unsigned long long)standIn->eventsDropped);
+    }
+    printf("%u subscribers, %u slow (%d bytes every %d ms), fast ones reconnect every %u s\n\n", count, slow, SLOW_READ_BYTES,
+           SLOW_READ_MS, churn);
+    printf("%-5s %6s %10s %8s %6s %8s %8s %10s %8s %8s %8s\n", "", "subs", "records", "events", "gaps", "missed", "reorder", "reconnects",
+           "p50_ms", "p99_ms", "max_ms");
+
+    bool failed = false;
+    for (int kind = 0; kind < 2; kind++) {
+        uint64_t n = 0, records = 0, events = 0, gaps = 0, missed = 0, reorder = 0, reconnects = 0;
+        for (Subscriber &s : subs) {
+            if (s.slow != (kind == 1))
+                continue;
+            n++;
+            records += s.records;
+            events += s.events;
+            gaps += s.gaps.size();
+            missed += s.missed;
+            reorder += s.outOfOrder;
+            reconnects += s.reconnects;
+        }
+        Latency &lag = kind ? slowLag : fastLag;
+        printf("%-5s %6llu %10llu %8llu %6llu %8llu %8llu %10llu %8.0f %8.0f %8.0f\n", kind ? "slow" : "fast", (unsigned long long)n,
+               (unsigned long long)records, (unsigned long long)events, (unsigned long long)gaps, (unsigned long long)missed,
+               (unsigned long long)reorder, (unsigned long long)reconnects, lag.at(0.50), lag.at(0.99), lag.at(1.0));
+        if (reorder || (kind == 0 && gaps))
+            failed = true;
+    }
+    printf("\ngaps refilled from /events: %u of %u checked\n", refillsOk, refills);
+    if (refillsOk != refills)
+        failed = true;
+    printf("%s\n", failed ? "FAILED: a fast subscriber lost records, or records came twice or out of order" : "ok");
+    return failed ? 1 : 0;
+}
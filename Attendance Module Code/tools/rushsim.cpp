@@ -0,0 +1,256 @@
+// Check-in throughput at the door, single mode against rush mode (src/checkin_ui.h). Drives the
+// firmware's own CheckinUi with scripted keypresses on a virtual clock (src/hal_sim.h) and counts
+// people per minute for a burst of arrivals: every student of a 200 roster, in random order, plus a
+// few who are not on it and a few who try to check in twice.
+//
+// Single mode: each student steps up to the keypad and types * roll # themselves.
+// Rush mode:   one person at the keypad types the roll numbers called out by the queue, roll #
+//              each, with A to start the batch and A to end it. Batches that fill up are marked
+//              by themselves and the next roll number is typed straight over the summary.
+//
+// The timing model is deliberately simple and on the command line, so it can be argued with: a
+// keypress takes -k ms, a student stepping up to the keypad and reading the screen -s ms, a roll
+// number called out -c ms. Duplicates are turned away by the firmware's presence module
+// (src/presence.h); what it accepts goes to a stand-in for storage that counts journal flushes the
+// way the storage task would cause them (JOURNAL_FLUSH_THRESHOLD records, JOURNAL_IDLE_FLUSH_MS
+// idle, or a group). Roll numbers are three digits here, as a 200 roster needs.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -DROLL_DIGITS=3 -DATTENDANCE_SERIAL_LOG=0 -I lib/host -I src -o rushsim
+//             tools/rushsim.cpp lib/host/host.cpp src/archive.cpp src/checkin_ui.cpp src/epoch.cpp src/fmt.cpp
+//             src/journal.cpp src/live.cpp src/metrics.cpp src/presence.cpp src/ring_log.cpp src/rtc.cpp
+// Run:    ./rushsim [-n students] [-k ms] [-s ms] [-c ms] [-r seed] [-v]
+//   -n  roster size, all of whom arrive (default 200)
+//   -k  time per keypress (default 300)
+//   -s  single mode: a student stepping up and reading the result (default 2000)
+//   -c  rush mode: a roll number called out to the keypad (default 700)
+//   -r  seed for the arrival order (default 1)
+//   -v  print the LCD after every keypress
+
+#include "checkin_ui.h"
+#include "epoch.h"
+#include "hal_sim.h"
+#include "journal.h"
+#include "presence.h"
+
+#include <FS.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+static const unsigned long POLL_MS = 50;        // step of the virtual clock between keys
+static uint16_t rosterCount = 200;
+
+static bool simLookup(uint16_t rollNum, char *name, size_t len) {
+    if (rollNum == 0 || rollNum > rosterCount)
+        return false;
+    snprintf(name, len, "Student %03u", rollNum);
+    return true;
+}
+
+// What presenceMark() hands on; nothing is written, the store only counts
+static bool toStorage(uint32_t, uint16_t, uint8_t) {
+    return true;
+}
+
+// Marks through the firmware's presence checks and counts the journal flushes the storage task would make for them
+class SimStore : public AttendanceStore {
+  public:
+    SimClock &clock;
+    uint32_t saved = 0, duplicates = 0, flushes = 0, groups = 0;
+    unsigned long lastSaved = 0;        // when the last arrival was marked
+    SimStore(SimClock &clock) : clock(clock) {}
+
+    MarkResult markAttendance(uint16_t rollNum, uint32_t timestamp) override {
+        if (!mark(rollNum, EVENT_ARRIVAL, timestamp))
+            return MARK_DUPLICATE;
+        settle();
+        if (++pending == JOURNAL_FLUSH_THRESHOLD)
+            flush();
+        lastSaved = clock.ms;
+        return MARK_SAVED;
+    }
+    MarkResult markDeparture(uint16_t rollNum, uint32_t timestamp) override {
+        return presenceMark(rollNum, EVENT_DEPARTURE, timestamp, toStorage);
+    }
+    void markArrivals(BatchEntry *entries, uint8_t count) override {
+        settle();
+        for (uint8_t i = 0; i < count; i++) {
+            entries[i].result = mark(entries[i].rollNum, EVENT_ARRIVAL, entries[i].timestamp) ? MARK_SAVED : MARK_DUPLICATE;
+            if (entries[i].result == MARK_SAVED)
+                pending++;
+        }
+        groups++;
+        flush();
+        lastSaved = clock.ms;
+    }
+    bool checkedIn(uint16_t rollNum) override { return presenceIsIn(rollNum); }
+
+    // Records still pending at the end are flushed once the keypad goes idle
+    void finish() {
+        if (pending)
+            flush();
+    }
+
+  private:
+    uint32_t pending = 0;
+    unsigned long lastAppend = 0;
+
+    bool mark(uint16_t rollNum, uint8_t event, uint32_t timestamp) {
+        if (presenceMark(rollNum, event, timestamp, toStorage) != MARK_SAVED) {
+            duplicates++;
+            return false;
+        }
+        saved++;
+        return true;
+    }
+    void flush() {
+        flushes++;
+        pending = 0;
+    }
+    // The idle flush that would have happened since the last record
+    void settle() {
+        if (pending && clock.ms - lastAppend >= JOURNAL_IDLE_FLUSH_MS)
+            flush();
+        lastAppend = clock.ms;
+    }
+};
+
+struct Outcome {
+    double minutes;
+    uint32_t keys, saved, duplicates, flushes, groups;
+};
+
+struct Sim {
+    fs::FS fs{ hostScratchDir() };
+    SimClock clock;
+    SimKeypad keypad;
+    SimDisplay lcd;
+    SimStore store{ clock };
+    SimNetwork network;
+    CheckinUi ui{ keypad, lcd, clock, store, network, simLookup };
+    uint32_t keys = 0;
+    bool verbose = false;
+
+    // Each run starts the day with nobody in
+    Sim(bool verbose) : verbose(verbose) {
+        journalBegin(fs);
+        presenceBegin(fs, dayOf(clock.now()));
+        ui.begin();
+    }
+
+    // Lets ms pass, running the screen timers on the way as the firmware's loop would
+    void pass(unsigned long ms) {
+        for (unsigned long until = clock.ms + ms; clock.ms < until;) {
+            clock.ms = std::min(until, clock.ms + POLL_MS);
+            ui.poll();
+        }
+    }
+
+    void press(char key, unsigned long keyMs) {
+        pass(keyMs);
+        keypad.keys.push_back(key);
+        ui.poll();
+        keys++;
+        if (verbose)
+            printf("%8.1fs %c  |%s|%s|\n", clock.ms / 1000.0, key, lcd.rows[0], lcd.rows[1]);
+    }
+
+    void type(uint16_t rollNum, unsigned long keyMs) {
+        char digits[8];
+        snprintf(digits, sizeof(digits), "%0*u", ROLL_DIGITS, rollNum);
+        for (const char *d = digits; *d; d++)
+            press(*d, keyMs);
+    }
+
+    Outcome result() {
+        store.finish();
+        double minutes = store.lastSaved / 60000.0;
+        return { minutes, keys, store.saved, store.duplicates, store.flushes, store.groups };
+    }
+};
+
+static Outcome runSingle(const std::vector<uint16_t> &queue, unsigned long keyMs, unsigned long stepMs, bool verbose) {
+    Sim sim(verbose);
+    for (uint16_t rollNum : queue) {
+        sim.pass(stepMs);
+        sim.press('*', keyMs);
+        sim.type(rollNum, keyMs);
+        sim.press('#', keyMs);
+    }
+    return sim.result();
+}
+
+static Outcome runRush(const std::vector<uint16_t> &queue, unsigned long keyMs, unsigned long callMs, bool verbose) {
+    Sim sim(verbose);
+    sim.press('A', keyMs);
+    for (uint16_t rollNum : queue) {
+        sim.pass(callMs);
+        sim.type(rollNum, keyMs);
+        sim.press('#', keyMs);
+    }
+    sim.press('A', keyMs);
+    return sim.result();
+}
+
+static void report(const char *mode, const Outcome &o, size_t people) {
+    printf("{\"mode\":\"%s\",\"people\":%zu,\"saved\":%u,\"turned_away\":%zu,\"seconds\":%.1f,"
+           "\"people_per_min\":%.1f,\"keys_per_person\":%.2f,\"journal_flushes\":%u,\"groups\":%u}\n",
+           mode, people, o.saved, people - o.saved, o.minutes * 60, o.saved / o.minutes, (double)o.keys / people,
+           o.flushes, o.groups);
+}
+
+int main(int argc, char **argv) {
+    unsigned long keyMs = 300, stepMs = 2000, callMs = 700;
+    unsigned seed = 1;
+    bool verbose = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            rosterCount = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-k") && i + 1 < argc) {
+            keyMs = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            stepMs = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            callMs = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            seed = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-v")) {
+            verbose = true;
+        } else {
+            fprintf(stderr, "usage: %s [-n students] [-k ms] [-s ms] [-c ms] [-r seed] [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (rosterCount == 0 || rosterCount + 10u >= ROLL_LIMIT) {
+        fprintf(stderr, "roster size must leave room for unknown roll numbers in %d digits\n", ROLL_DIGITS);
+        return 2;
+    }
+
+    // Everyone once, a few strangers and a few second tries, in random order
+    std::mt19937 rng(seed);
+    std::vector<uint16_t> queue;
+    for (uint16_t roll = 1; roll <= rosterCount; roll++)
+        queue.push_back(roll);
+    for (int i = 0; i < 4; i++)
+        queue.push_back(rosterCount + 1 + i * 2);
+    std::shuffle(queue.begin(), queue.end(), rng);
+    for (int i = 0; i < 6; i++) {
+        size_t at = queue.size() / 2 + rng() % (queue.size() / 2);
+        queue.insert(queue.begin() + at, queue[rng() % (at - 1)]);
+    }
+
+    Outcome single = runSingle(queue, keyMs, stepMs, verbose);
+    Outcome rush = runRush(queue, keyMs, callMs, verbose);
+    report("single", single, queue.size());
+    report("rush", rush, queue.size());
+    if (single.saved != rosterCount || rush.saved != rosterCount) {
+        fprintf(stderr, "not everyone on the roster was marked exactly once\n");
+        return 1;
+    }
+    printf("rush mode: %.1fx the people per minute\n", (rush.saved / rush.minutes) / (single.saved / single.minutes));
+    return 0;
+}
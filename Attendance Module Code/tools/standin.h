@@ -0,0 +1,177 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+//----------------------------------------STAND-IN SERVER---------------------------------------
+// A stand-in for the module's web server on the loopback interface, shared by the load tests under
+// tools/. One thread polls every socket, hands each request to request() once its header is in and
+// calls tick() on every pass, so a subclass can make check-ins and push events between requests.
+// Its sockets get a send buffer about the size of the ESP32's TCP window.
+
+static const int MODULE_SNDBUF = 5744;        // TCP_SND_BUF of the ESP32 Arduino core
+
+inline double nowMs() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+inline void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+inline uint32_t queryValue(const std::string &path, const char *key, uint32_t fallback) {
+    size_t at = path.find(std::string(key) + "=");
+    if (at == std::string::npos || (at > 0 && path[at - 1] != '?' && path[at - 1] != '&'))
+        return fallback;
+    return strtoul(path.c_str() + at + strlen(key) + 1, nullptr, 10);
+}
+
+struct Connection {
+    explicit Connection(int fd) : fd(fd) {}
+
+    int fd;
+    std::string in;                   // the request as far as it has come
+    std::string out;                  // bytes of the current message not yet taken by the socket
+    std::deque<std::string> queue;    // messages waiting behind it
+    bool answered = false;            // request() has run; anything the client sends now is ignored
+    bool live = false;                // held open for server-sent events
+    bool closing = false;             // close once out and queue are empty
+};
+
+class StandIn {
+  public:
+    virtual ~StandIn() {}
+
+    // Listens on a free loopback port and returns it, or -1
+    int start() {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(listener, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listener, 1024) < 0)
+            return -1;
+        socklen_t len = sizeof(addr);
+        getsockname(listener, (sockaddr *)&addr, &len);
+        setNonBlocking(listener);
+        thread = std::thread([this] { run(); });
+        return ntohs(addr.sin_port);
+    }
+
+    void stop() {
+        stopping = true;
+        thread.join();
+        for (Connection &c : conns)
+            close(c.fd);
+        close(listener);
+    }
+
+  protected:
+    // Answers a request by filling c.out or c.queue; c.in holds the request line and headers
+    virtual void request(Connection &c, const std::string &path) = 0;
+    virtual void tick(double /*now*/) {}
+
+    void drop(Connection &c) {
+        close(c.fd);
+        c.fd = -1;
+    }
+
+    // Hands the socket as much as it takes
+    void flush(Connection &c) {
+        while (c.fd >= 0) {
+            if (c.out.empty()) {
+                if (c.queue.empty()) {
+                    if (c.closing)
+                        drop(c);
+                    return;
+                }
+                c.out = std::move(c.queue.front());
+                c.queue.pop_front();
+            }
+            ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno != EAGAIN)
+                    drop(c);
+                return;
+            }
+            c.out.erase(0, n);
+        }
+    }
+
+    std::vector<Connection> conns;
+
+  private:
+    void run() {
+        while (!stopping) {
+            std::vector<pollfd> fds;
+            fds.push_back({ listener, POLLIN, 0 });
+            for (Connection &c : conns)
+                fds.push_back({ c.fd, (short)(POLLIN | (c.out.empty() && c.queue.empty() ? 0 : POLLOUT)), 0 });
+            poll(fds.data(), fds.size(), 5);
+
+            for (size_t i = 0; i < conns.size(); i++) {
+                short ev = fds[i + 1].revents;
+                if (ev & (POLLIN | POLLHUP | POLLERR))
+                    receive(conns[i]);
+                if (ev & POLLOUT)
+                    flush(conns[i]);
+            }
+            conns.erase(std::remove_if(conns.begin(), conns.end(), [](const Connection &c) { return c.fd < 0; }), conns.end());
+            if (fds[0].revents & POLLIN)
+                accept();
+            tick(nowMs());
+        }
+    }
+
+    void accept() {
+        for (;;) {
+            int fd = ::accept(listener, nullptr, nullptr);
+            if (fd < 0)
+                return;
+            setNonBlocking(fd);
+            setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &MODULE_SNDBUF, sizeof(MODULE_SNDBUF));
+            conns.emplace_back(fd);
+        }
+    }
+
+    void receive(Connection &c) {
+        char buf[2048];
+        ssize_t n = read(c.fd, buf, sizeof(buf));
+        if (n <= 0) {
+            if (n == 0 || errno != EAGAIN)
+                drop(c);
+            return;
+        }
+        if (c.answered)
+            return;
+        c.in.append(buf, n);
+        if (c.in.find("\r\n\r\n") == std::string::npos)
+            return;
+        size_t sp = c.in.find(' ');
+        c.answered = true;
+        request(c, c.in.substr(sp + 1, c.in.find(' ', sp + 1) - sp - 1));
+        flush(c);
+    }
+
+    int listener = -1;
+    std::thread thread;
+    std::atomic<bool> stopping{ false };
+};